@@ -111,15 +111,39 @@ public:
      */
     virtual const char* getKey() const = 0;
 
+    /**
+     * Load the value from the persistent storage into the cache.
+     * The persistent storage must be opened.
+     */
+    virtual void load() = 0;
+
+    /**
+     * Save the cached value to the persistent storage, if it was modified.
+     * The persistent storage must be opened read/write.
+     */
+    virtual void save() = 0;
+
+    /**
+     * Is the cached value modified and not saved yet?
+     *
+     * @return If modified, it will return true otherwise false.
+     */
+    bool isModified() const
+    {
+        return m_isModified;
+    }
+
 protected:
 
     Preferences*    m_preferences;  /**< Persistent storage */
+    bool            m_isModified;   /**< Is the cached value modified? */
 
     /**
      * Constructs a key value pair.
      */
     KeyValue() :
-        m_preferences(nullptr)
+        m_preferences(nullptr),
+        m_isModified(false)
     {
     }
 
@@ -129,7 +153,8 @@ protected:
      * @param[in] pref  Persistent storage
      */
     KeyValue(Preferences& pref) :
-        m_preferences(&pref)
+        m_preferences(&pref),
+        m_isModified(false)
     {
     }
 
@@ -160,7 +185,8 @@ public:
         m_name(name),
         m_defValue(defValue),
         m_min(min),
-        m_max(max)
+        m_max(max),
+        m_value(defValue)
     {
     }
 
@@ -180,7 +206,8 @@ public:
         m_name(name),
         m_defValue(defValue),
         m_min(min),
-        m_max(max)
+        m_max(max),
+        m_value(defValue)
     {
     }
 
@@ -232,18 +259,28 @@ public:
     }
 
     /**
-     * Get value.
+     * Get cached value.
      *
      * @return Value
      */
-    virtual T getValue() const = 0;
+    T getValue() const
+    {
+        return m_value;
+    }
 
     /**
-     * Set value.
+     * Set value. It is saved to the persistent storage on the next save().
      *
      * @param[in] value Value
      */
-    virtual void setValue(T value) = 0;
+    void setValue(T value)
+    {
+        if (m_value != value)
+        {
+            m_value      = value;
+            m_isModified = true;
+        }
+    }
 
     /**
      * Get default value.
@@ -262,6 +299,7 @@ protected:
     T               m_defValue; /**< Default value */
     T               m_min;      /**< Min. length */
     T               m_max;      /**< Max. length */
+    T               m_value;    /**< Cached value */
 
 private:
 
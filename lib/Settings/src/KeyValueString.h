@@ -44,6 +44,8 @@
 /******************************************************************************
  * Includes
  *****************************************************************************/
+#include <string.h>
+
 #include "KeyValue.h"
 
 /******************************************************************************
@@ -78,7 +80,11 @@ public:
         m_defValue(defValue),
         m_min(min),
         m_max(max),
-        m_isSecret(isSecret)
+        m_isSecret(isSecret),
+        m_isStored(false),
+        m_uniqueId(),
+        m_defValueUnique(defValue),
+        m_value()
     {
     }
 
@@ -100,7 +106,11 @@ public:
         m_defValue(defValue),
         m_min(min),
         m_max(max),
-        m_isSecret(isSecret)
+        m_isSecret(isSecret),
+        m_isStored(false),
+        m_uniqueId(),
+        m_defValueUnique(defValue),
+        m_value()
     {
     }
 
@@ -162,37 +172,88 @@ public:
     }
 
     /**
-     * Get value.
+     * Get cached value. If the value is not stored, the default value is returned.
+     * The reference is valid until the value is set again.
      *
      * @return Value
      */
-    String getValue() const
+    const String& getValue() const
+    {
+        return (true == m_isStored) ? m_value : m_defValueUnique;
+    }
+
+    /**
+     * Copy the cached value into a buffer. If the value is not stored, the
+     * default value is copied. A buffer of getMaxLength() + 1 bytes holds
+     * every valid value. A longer value is truncated.
+     *
+     * @param[out]  buffer  Buffer, which is always null terminated.
+     * @param[in]   size    Buffer size in byte.
+     *
+     * @return Length of the value, which may be greater than the copied length.
+     */
+    size_t getValue(char* buffer, size_t size) const
     {
-        return m_preferences->getString(m_key, getDefault());
+        return strlcpy(buffer, getValue().c_str(), size);
     }
 
     /**
-     * Set value.
+     * Set value. It is saved to the persistent storage on the next save().
      *
      * @param[in] value Value
      */
     void setValue(const String& value)
     {
-        m_preferences->putString(m_key, value);
+        setValue(value.c_str());
     }
 
     /**
-     * Get default value.
+     * Set value. It is saved to the persistent storage on the next save().
+     * No temporary string is created.
      *
-     * @return Default value
+     * @param[in] value Value
      */
-    String getDefault() const
+    void setValue(const char* value)
     {
-        String defValue = m_defValue;
+        if ((false == m_isStored) || (0 != strcmp(m_value.c_str(), value)))
+        {
+            m_value      = value;
+            m_isStored   = true;
+            m_isModified = true;
+        }
+    }
 
-        defValue += m_uniqueId;
+    /**
+     * Load the value from the persistent storage into the cache.
+     * The default value isn't cached, because it depends on the unique id.
+     */
+    void load() final
+    {
+        m_isStored   = m_preferences->isKey(m_key);
+        m_value      = (true == m_isStored) ? m_preferences->getString(m_key) : String();
+        m_isModified = false;
+    }
+
+    /**
+     * Save the cached value to the persistent storage, if it was modified.
+     */
+    void save() final
+    {
+        if (true == m_isModified)
+        {
+            (void)m_preferences->putString(m_key, m_value);
+            m_isModified = false;
+        }
+    }
 
-        return defValue;
+    /**
+     * Get default value.
+     *
+     * @return Default value
+     */
+    const String& getDefault() const
+    {
+        return m_defValueUnique;
     }
 
     /**
@@ -212,18 +273,23 @@ public:
      */
     void setUniqueId(const String& uniqueId)
     {
-        m_uniqueId = uniqueId;
+        m_uniqueId        = uniqueId;
+        m_defValueUnique  = m_defValue;
+        m_defValueUnique += m_uniqueId;
     }
 
 private:
 
-    const char*     m_key;      /**< Key */
-    const char*     m_name;     /**< Name */
-    const char*     m_defValue; /**< Default value */
-    const size_t    m_min;      /**< Min. length */
-    const size_t    m_max;      /**< Max. length */
-    const bool      m_isSecret; /**< Is the value a secret value? */
-    String          m_uniqueId; /**< Unique id to make the default value unique. */
+    const char*     m_key;            /**< Key */
+    const char*     m_name;           /**< Name */
+    const char*     m_defValue;       /**< Default value */
+    const size_t    m_min;            /**< Min. length */
+    const size_t    m_max;            /**< Max. length */
+    const bool      m_isSecret;       /**< Is the value a secret value? */
+    bool            m_isStored;       /**< Is the value stored in the persistent storage? */
+    String          m_uniqueId;       /**< Unique id to make the default value unique. */
+    String          m_defValueUnique; /**< Default value with unique id */
+    String          m_value;          /**< Cached value */
 
     /* An instance shall not be copied. */
     KeyValueString(const KeyValueString& kv);
@@ -0,0 +1,144 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   KeyValueUInt8.h
+ * @brief  Key value pair with uint8_t type
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup SETTINGS
+ *
+ * @{
+ */
+
+#ifndef KEY_VALUE_UINT8_H
+#define KEY_VALUE_UINT8_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "KeyValue.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Key value pair with uint8_t value.
+ */
+class KeyValueUInt8 : public KeyValueNumber<uint8_t>
+{
+public:
+
+    /**
+     * Constructs a key value pair.
+     * 
+     * @param[in] key       Key
+     * @param[in] name      User friendly name
+     * @param[in] defValue  Default value
+     * @param[in] min       Minimum value
+     * @param[in] max       Maximum value
+     */
+    KeyValueUInt8(const char* key, const char* name, uint8_t defValue, uint8_t min, uint8_t max) :
+        KeyValueNumber(key, name, defValue, min, max)
+    {
+    }
+
+    /**
+     * Constructs a key value pair.
+     * 
+     * @param[in] pref      Preferences
+     * @param[in] key       Key
+     * @param[in] name      User friendly name
+     * @param[in] defValue  Default value
+     * @param[in] min       Minimum value
+     * @param[in] max       Maximum value
+     */
+    KeyValueUInt8(Preferences& pref, const char* key, const char* name, uint8_t defValue, uint8_t min, uint8_t max) :
+        KeyValueNumber(pref, key, name, defValue, min, max)
+    {
+    }
+
+    /**
+     * Destroys a key value pair.
+     */
+    ~KeyValueUInt8() override
+    {
+    }
+
+    /**
+     * Get value type.
+     *
+     * @return Value type
+     */
+    Type getValueType() const final
+    {
+        return TYPE_UINT8;
+    }
+
+    /**
+     * Load the value from the persistent storage into the cache.
+     */
+    void load() final
+    {
+        m_value      = m_preferences->getUChar(m_key, m_defValue);
+        m_isModified = false;
+    }
+
+    /**
+     * Save the cached value to the persistent storage, if it was modified.
+     */
+    void save() final
+    {
+        if (true == m_isModified)
+        {
+            (void)m_preferences->putUChar(m_key, m_value);
+            m_isModified = false;
+        }
+    }
+
+private:
+
+    /* An instance shall not be copied. */
+    KeyValueUInt8(const KeyValueUInt8& kv);
+    KeyValueUInt8& operator=(const KeyValueUInt8& kv);
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif  /* KEY_VALUE_UINT8_H */
+
+/** @} */
@@ -36,6 +36,7 @@
 #include "Settings.h"
 #include "nvs.h"
 #include <algorithm>
+#include <assert.h>
 
 /******************************************************************************
  * Compiler Switches
@@ -76,6 +77,27 @@ static const char*  KEY_WIFI_SSID                   = "sta_ssid";
 /** Wifi network passphrase key */
 static const char*  KEY_WIFI_PASSPHRASE             = "sta_passphrase";
 
+/** Wifi network access point BSSID key */
+static const char*  KEY_WIFI_BSSID                  = "sta_bssid";
+
+/** Wifi network channel key */
+static const char*  KEY_WIFI_CHANNEL                = "sta_channel";
+
+/** Wifi network reuse ip-address lease key */
+static const char*  KEY_WIFI_REUSE_IP               = "sta_reuse_ip";
+
+/** Wifi network ip-address lease key */
+static const char*  KEY_WIFI_IP                     = "sta_ip";
+
+/** Wifi network gateway address lease key */
+static const char*  KEY_WIFI_GATEWAY                = "sta_gateway";
+
+/** Wifi network subnet mask lease key */
+static const char*  KEY_WIFI_SUBNET                 = "sta_subnet";
+
+/** Wifi network DNS server address lease key */
+static const char*  KEY_WIFI_DNS                    = "sta_dns";
+
 /** Wifi access point network key */
 static const char*  KEY_WIFI_AP_SSID                = "ap_ssid";
 
@@ -99,6 +121,27 @@ static const char*  NAME_WIFI_SSID                  = "Wifi SSID";
 /** Wifi network passphrase name of key value pair */
 static const char*  NAME_WIFI_PASSPHRASE            = "Wifi passphrase";
 
+/** Wifi network access point BSSID name of key value pair */
+static const char*  NAME_WIFI_BSSID                 = "Wifi BSSID";
+
+/** Wifi network channel name of key value pair */
+static const char*  NAME_WIFI_CHANNEL               = "Wifi channel";
+
+/** Wifi network reuse ip-address lease name of key value pair */
+static const char*  NAME_WIFI_REUSE_IP              = "Wifi reuse IP lease";
+
+/** Wifi network ip-address lease name of key value pair */
+static const char*  NAME_WIFI_IP                    = "Wifi IP lease";
+
+/** Wifi network gateway address lease name of key value pair */
+static const char*  NAME_WIFI_GATEWAY               = "Wifi gateway lease";
+
+/** Wifi network subnet mask lease name of key value pair */
+static const char*  NAME_WIFI_SUBNET                = "Wifi subnet lease";
+
+/** Wifi network DNS server address lease name of key value pair */
+static const char*  NAME_WIFI_DNS                   = "Wifi DNS lease";
+
 /** Wifi access point network name of key value pair */
 static const char*  NAME_WIFI_AP_SSID               = "Wifi AP SSID";
 
@@ -122,6 +165,18 @@ static const char*      DEFAULT_WIFI_SSID                   = "";
 /** Wifi network passphrase default value */
 static const char*      DEFAULT_WIFI_PASSPHRASE             = "";
 
+/** Wifi network access point BSSID default value */
+static const char*      DEFAULT_WIFI_BSSID                  = "";
+
+/** Wifi network channel default value */
+static const uint8_t    DEFAULT_WIFI_CHANNEL                = 0U;
+
+/** Wifi network reuse ip-address lease default value */
+static const bool       DEFAULT_WIFI_REUSE_IP               = false;
+
+/** Wifi network address lease default value */
+static const uint32_t   DEFAULT_WIFI_ADDRESS                = 0U;
+
 /** Wifi access point network default value */
 static const char*      DEFAULT_WIFI_AP_SSID                = "pixelix";
 
@@ -145,6 +200,15 @@ static const size_t     MIN_VALUE_WIFI_SSID                 = 0;
 /** Wifi network passphrase min. length */
 static const size_t     MIN_VALUE_WIFI_PASSPHRASE           = 8U;
 
+/** Wifi network access point BSSID min. length */
+static const size_t     MIN_VALUE_WIFI_BSSID                = 0U;
+
+/** Wifi network channel min. value */
+static const uint8_t    MIN_VALUE_WIFI_CHANNEL              = 0U;
+
+/** Wifi network address lease min. value */
+static const uint32_t   MIN_VALUE_WIFI_ADDRESS              = 0U;
+
 /** Wifi access point network SSID min. length. Section 7.3.2.1 of the 802.11-2007 specification. */
 static const size_t     MIN_VALUE_WIFI_AP_SSID              = 0;
 
@@ -168,6 +232,15 @@ static const size_t     MAX_VALUE_WIFI_SSID                 = 32U;
 /** Wifi network passphrase max. length */
 static const size_t     MAX_VALUE_WIFI_PASSPHRASE           = 64U;
 
+/** Wifi network access point BSSID max. length, e.g. "AA:BB:CC:DD:EE:FF" */
+static const size_t     MAX_VALUE_WIFI_BSSID                = 17U;
+
+/** Wifi network channel max. value */
+static const uint8_t    MAX_VALUE_WIFI_CHANNEL              = 14U;
+
+/** Wifi network address lease max. value */
+static const uint32_t   MAX_VALUE_WIFI_ADDRESS              = UINT32_MAX;
+
 /** Wifi access point network SSID max. length. Section 7.3.2.1 of the 802.11-2007 specification. */
 static const size_t     MAX_VALUE_WIFI_AP_SSID              = 32U;
 
@@ -191,23 +264,35 @@ static const size_t     MAX_VALUE_HOSTNAME                  = 63U;
 
 bool Settings::open(bool readOnly)
 {
-    /* Open Preferences with namespace. Each application module, library, etc
-     * has to use a namespace name to prevent key name collisions. We will open storage in
-     * RW-mode (second parameter has to be false).
-     * Note: Namespace name is limited to 15 chars.
-     */
-    bool status = m_preferences.begin(PREF_NAMESPACE, readOnly);
+    bool status = true;
 
-    /* If settings storage doesn't exist, it will be created. */
-    if ((false == status) &&
-        (true == readOnly))
+    /* Read only access is served by the cache, after the values are loaded. */
+    if ((false == m_isLoaded) || (false == readOnly))
     {
-        status = m_preferences.begin(PREF_NAMESPACE, false);
+        status = openStorage(readOnly);
 
         if (true == status)
         {
-            m_preferences.end();
-            status = m_preferences.begin(PREF_NAMESPACE, readOnly);
+            if (false == m_isLoaded)
+            {
+                size_t idx = 0U;
+
+                for (idx = 0U; idx < KEY_VALUE_PAIR_NUM; ++idx)
+                {
+                    m_keyValueList[idx]->load();
+                }
+
+                m_isLoaded = true;
+            }
+
+            if (true == readOnly)
+            {
+                m_preferences.end();
+            }
+            else
+            {
+                m_isWritable = true;
+            }
         }
     }
 
@@ -216,7 +301,19 @@ bool Settings::open(bool readOnly)
 
 void Settings::close()
 {
-    m_preferences.end();
+    /* Write all modified values at once. */
+    if (true == m_isWritable)
+    {
+        size_t idx = 0U;
+
+        for (idx = 0U; idx < KEY_VALUE_PAIR_NUM; ++idx)
+        {
+            m_keyValueList[idx]->save();
+        }
+
+        m_preferences.end();
+        m_isWritable = false;
+    }
 }
 
 /******************************************************************************
@@ -232,12 +329,39 @@ Settings::Settings() :
     m_preferences(),
     m_wifiSSID                  (m_preferences, KEY_WIFI_SSID,                  NAME_WIFI_SSID,                 DEFAULT_WIFI_SSID,              MIN_VALUE_WIFI_SSID,                MAX_VALUE_WIFI_SSID),
     m_wifiPassphrase            (m_preferences, KEY_WIFI_PASSPHRASE,            NAME_WIFI_PASSPHRASE,           DEFAULT_WIFI_PASSPHRASE,        MIN_VALUE_WIFI_PASSPHRASE,          MAX_VALUE_WIFI_PASSPHRASE,      true),
+    m_wifiBSSID                 (m_preferences, KEY_WIFI_BSSID,                 NAME_WIFI_BSSID,                DEFAULT_WIFI_BSSID,             MIN_VALUE_WIFI_BSSID,               MAX_VALUE_WIFI_BSSID),
+    m_wifiChannel               (m_preferences, KEY_WIFI_CHANNEL,               NAME_WIFI_CHANNEL,              DEFAULT_WIFI_CHANNEL,           MIN_VALUE_WIFI_CHANNEL,             MAX_VALUE_WIFI_CHANNEL),
+    m_wifiReuseIp               (m_preferences, KEY_WIFI_REUSE_IP,              NAME_WIFI_REUSE_IP,             DEFAULT_WIFI_REUSE_IP),
+    m_wifiIp                    (m_preferences, KEY_WIFI_IP,                    NAME_WIFI_IP,                   DEFAULT_WIFI_ADDRESS,           MIN_VALUE_WIFI_ADDRESS,             MAX_VALUE_WIFI_ADDRESS),
+    m_wifiGateway               (m_preferences, KEY_WIFI_GATEWAY,               NAME_WIFI_GATEWAY,              DEFAULT_WIFI_ADDRESS,           MIN_VALUE_WIFI_ADDRESS,             MAX_VALUE_WIFI_ADDRESS),
+    m_wifiSubnet                (m_preferences, KEY_WIFI_SUBNET,                NAME_WIFI_SUBNET,               DEFAULT_WIFI_ADDRESS,           MIN_VALUE_WIFI_ADDRESS,             MAX_VALUE_WIFI_ADDRESS),
+    m_wifiDns                   (m_preferences, KEY_WIFI_DNS,                   NAME_WIFI_DNS,                  DEFAULT_WIFI_ADDRESS,           MIN_VALUE_WIFI_ADDRESS,             MAX_VALUE_WIFI_ADDRESS),
     m_apSSID                    (m_preferences, KEY_WIFI_AP_SSID,               NAME_WIFI_AP_SSID,              DEFAULT_WIFI_AP_SSID,           MIN_VALUE_WIFI_AP_SSID,             MAX_VALUE_WIFI_AP_SSID),
     m_apPassphrase              (m_preferences, KEY_WIFI_AP_PASSPHRASE,         NAME_WIFI_AP_PASSPHRASE,        DEFAULT_WIFI_AP_PASSPHRASE,     MIN_VALUE_WIFI_AP_PASSPHRASE,       MAX_VALUE_WIFI_AP_PASSPHRASE,   true),
     m_webLoginUser              (m_preferences, KEY_WEB_LOGIN_USER,             NAME_WEB_LOGIN_USER,            DEFAULT_WEB_LOGIN_USER,         MIN_VALUE_WEB_LOGIN_USER,           MAX_VALUE_WEB_LOGIN_USER),
     m_webLoginPassword          (m_preferences, KEY_WEB_LOGIN_PASSWORD,         NAME_WEB_LOGIN_PASSWORD,        DEFAULT_WEB_LOGIN_PASSWORD,     MIN_VALUE_WEB_LOGIN_PASSWORD,       MAX_VALUE_WEB_LOGIN_PASSWORD,   true),
-    m_hostname                  (m_preferences, KEY_HOSTNAME,                   NAME_HOSTNAME,                  DEFAULT_HOSTNAME,               MIN_VALUE_HOSTNAME,                 MAX_VALUE_HOSTNAME)
+    m_hostname                  (m_preferences, KEY_HOSTNAME,                   NAME_HOSTNAME,                  DEFAULT_HOSTNAME,               MIN_VALUE_HOSTNAME,                 MAX_VALUE_HOSTNAME),
+    m_keyValueList{
+        &m_wifiSSID,
+        &m_wifiPassphrase,
+        &m_wifiBSSID,
+        &m_wifiChannel,
+        &m_wifiReuseIp,
+        &m_wifiIp,
+        &m_wifiGateway,
+        &m_wifiSubnet,
+        &m_wifiDns,
+        &m_apSSID,
+        &m_apPassphrase,
+        &m_webLoginUser,
+        &m_webLoginPassword,
+        &m_hostname
+    },
+    m_isLoaded(false),
+    m_isWritable(false)
 {
+    /* Additional key value pairs don't compile, missing ones would be nullptr. */
+    assert(nullptr != m_keyValueList[KEY_VALUE_PAIR_NUM - 1U]);
 }
 /* clang-format on */
 
@@ -245,6 +369,31 @@ Settings::~Settings()
 {
 }
 
+bool Settings::openStorage(bool readOnly)
+{
+    /* Open Preferences with namespace. Each application module, library, etc
+     * has to use a namespace name to prevent key name collisions. We will open storage in
+     * RW-mode (second parameter has to be false).
+     * Note: Namespace name is limited to 15 chars.
+     */
+    bool status = m_preferences.begin(PREF_NAMESPACE, readOnly);
+
+    /* If settings storage doesn't exist, it will be created. */
+    if ((false == status) &&
+        (true == readOnly))
+    {
+        status = m_preferences.begin(PREF_NAMESPACE, false);
+
+        if (true == status)
+        {
+            m_preferences.end();
+            status = m_preferences.begin(PREF_NAMESPACE, readOnly);
+        }
+    }
+
+    return status;
+}
+
 /******************************************************************************
  * External Functions
  *****************************************************************************/
@@ -49,6 +49,9 @@
 
 #include "KeyValue.h"
 #include "KeyValueString.h"
+#include "KeyValueBool.h"
+#include "KeyValueUInt8.h"
+#include "KeyValueUInt32.h"
 
 /******************************************************************************
  * Macros
@@ -81,6 +84,11 @@ public:
      * Open settings.
      * If the settings storage doesn't exist, it will be created.
      *
+     * All settings are loaded once into a RAM cache, therefore opening
+     * read only is served by the cache after the first time. Values which
+     * are set, are written to the persistent storage on close(), if opened
+     * read/write.
+     *
      * @param[in] readOnly  Open read only or read/write
      *
      * @return Status
@@ -91,6 +99,7 @@ public:
 
     /**
      * Close settings.
+     * If opened read/write, all modified values are written at once.
      */
     void close();
 
@@ -114,6 +123,79 @@ public:
         return m_wifiPassphrase;
     }
 
+    /**
+     * Get BSSID of the last connected remote wifi network access point.
+     * It is empty, if not known.
+     *
+     * @return Key value pair
+     */
+    KeyValueString& getWifiBSSID()
+    {
+        return m_wifiBSSID;
+    }
+
+    /**
+     * Get channel of the last connected remote wifi network.
+     * It is 0, if not known.
+     *
+     * @return Key value pair
+     */
+    KeyValueUInt8& getWifiChannel()
+    {
+        return m_wifiChannel;
+    }
+
+    /**
+     * Shall the last ip-address lease of the remote wifi network be reused?
+     *
+     * @return Key value pair
+     */
+    KeyValueBool& getWifiReuseIp()
+    {
+        return m_wifiReuseIp;
+    }
+
+    /**
+     * Get ip-address of the last lease in the remote wifi network.
+     * It is 0, if not known.
+     *
+     * @return Key value pair
+     */
+    KeyValueUInt32& getWifiIp()
+    {
+        return m_wifiIp;
+    }
+
+    /**
+     * Get gateway address of the last lease in the remote wifi network.
+     *
+     * @return Key value pair
+     */
+    KeyValueUInt32& getWifiGateway()
+    {
+        return m_wifiGateway;
+    }
+
+    /**
+     * Get subnet mask of the last lease in the remote wifi network.
+     *
+     * @return Key value pair
+     */
+    KeyValueUInt32& getWifiSubnet()
+    {
+        return m_wifiSubnet;
+    }
+
+    /**
+     * Get DNS server address of the last lease in the remote wifi network.
+     *
+     * @return Key value pair
+     */
+    KeyValueUInt32& getWifiDns()
+    {
+        return m_wifiDns;
+    }
+
     /**
      * Get wifi access point network SSID.
      *
@@ -166,14 +248,27 @@ public:
 
 private:
 
+    /** Number of key value pairs. It must match the list in the constructor. */
+    static const size_t KEY_VALUE_PAIR_NUM = 14U;
+
     Preferences    m_preferences;      /**< Persistent storage */
     KeyValueString m_wifiSSID;         /**< Remote wifi network SSID */
     KeyValueString m_wifiPassphrase;   /**< Remote wifi network passphrase */
+    KeyValueString m_wifiBSSID;        /**< Last remote wifi network access point BSSID */
+    KeyValueUInt8  m_wifiChannel;      /**< Last remote wifi network channel */
+    KeyValueBool   m_wifiReuseIp;      /**< Reuse the last ip-address lease? */
+    KeyValueUInt32 m_wifiIp;           /**< Last ip-address lease */
+    KeyValueUInt32 m_wifiGateway;      /**< Last gateway address lease */
+    KeyValueUInt32 m_wifiSubnet;       /**< Last subnet mask lease */
+    KeyValueUInt32 m_wifiDns;          /**< Last DNS server address lease */
     KeyValueString m_apSSID;           /**< Access point SSID */
     KeyValueString m_apPassphrase;     /**< Access point passphrase */
     KeyValueString m_webLoginUser;     /**< Website login user account */
     KeyValueString m_webLoginPassword; /**< Website login user password */
     KeyValueString m_hostname;         /**< Hostname */
+    KeyValue*      m_keyValueList[KEY_VALUE_PAIR_NUM]; /**< All key value pairs */
+    bool           m_isLoaded;         /**< Are all values loaded into the cache? */
+    bool           m_isWritable;       /**< Is the persistent storage opened read/write? */
 
     /**
      * Constructs the settings service instance.
@@ -185,6 +280,18 @@ private:
      */
     ~Settings();
 
+    /**
+     * Open the persistent storage.
+     * If the settings storage doesn't exist, it will be created.
+     *
+     * @param[in] readOnly  Open read only or read/write
+     *
+     * @return Status
+     * @retval false    Failed to open
+     * @retval true     Successful opened
+     */
+    bool openStorage(bool readOnly);
+
     /* An instance shall not be copied. */
     Settings(const Settings& service);
     Settings& operator=(const Settings& service);
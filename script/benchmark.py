@@ -0,0 +1,443 @@
+"""
+This script benchmarks the upload paths of the PixelixUpdater. It uploads
+firmware and filesystem images several times via each path and records the
+time to first byte, the throughput, the failure rate and the device side
+metrics. Optional the end-to-end time through the /change-partition reboot
+is measured. The results are written as JSON file per PlatformIO environment.
+
+Note, the firmware must be a valid binary, because the device verifies it.
+A synthetic filesystem image overwrites the filesystem partition.
+
+Usage: python benchmark.py <ip-address> --firmware firmware.bin --filesystem-size 1048576
+"""
+
+# MIT License
+#
+# Copyright (c) 2019 - 2025 Andreas Merkle (web@blue-andi.de)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+################################################################################
+# Imports
+################################################################################
+
+import argparse
+import configparser
+import gzip
+import http.client
+import json
+import os
+import statistics
+import sys
+import time
+import uuid
+
+import upload as chunked_upload
+
+################################################################################
+# Variables
+################################################################################
+
+SIZE_HEADERS = chunked_upload.SIZE_HEADERS
+
+PATHS = ["form", "raw", "compressed", "chunked", "serial"]
+
+DEFAULT_PATHS = ["form", "raw", "compressed", "chunked"]
+
+DEFAULT_RUNS = 3
+
+TIMEOUT = 60 # s
+
+# Time in s, the device has to answer again after the reboot.
+REBOOT_TIMEOUT = 60 # s
+
+REBOOT_POLL_PERIOD = 0.25 # s
+
+PLATFORMIO_INI = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "platformio.ini")
+
+################################################################################
+# Classes
+################################################################################
+
+################################################################################
+# Functions
+################################################################################
+
+def get_default_env():
+    """
+    Get the default environment from platformio.ini.
+
+    Returns:
+        str: Environment name or None, if not available.
+    """
+    config = configparser.ConfigParser(inline_comment_prefixes=(";",))
+    config.read(PLATFORMIO_INI)
+
+    return config.get("platformio", "default_envs", fallback=None)
+
+def create_filesystem_image(size):
+    """
+    Create a synthetic filesystem image. The first half is random data and
+    the second half is erased flash, which gives a realistic compression ratio.
+
+    Args:
+        size: Image size in byte.
+
+    Returns:
+        bytes: Image
+    """
+    random_size = size // 2
+
+    return os.urandom(random_size) + b"\xff" * (size - random_size)
+
+def send_request(host, method, url, body, headers):
+    """
+    Send a HTTP request and measure it.
+
+    Args:
+        host: Device IP address or hostname.
+        method: HTTP method.
+        url: Request URL.
+        body: Request body.
+        headers: Request headers.
+
+    Returns:
+        Dict: HTTP status, response message, total time, time to first byte
+        and time between the last sent byte and the first response byte in s.
+    """
+    connection = http.client.HTTPConnection(host, timeout=TIMEOUT)
+
+    try:
+        start = time.perf_counter()
+        connection.request(method, url, body=body, headers=headers)
+        sent = time.perf_counter()
+        response = connection.getresponse()
+        first_byte = time.perf_counter()
+        message = response.read().decode("utf-8", errors="replace")
+        end = time.perf_counter()
+    finally:
+        connection.close()
+
+    return {
+        "status": response.status,
+        "message": message.strip(),
+        "time_s": end - start,
+        "ttfb_s": first_byte - start,
+        "finish_s": first_byte - sent
+    }
+
+def upload_form(host, target, image):
+    """
+    Upload the image via multipart form like the webinterface.
+
+    Args:
+        host: Device IP address or hostname.
+        target: "firmware" or "filesystem".
+        image: Binary.
+
+    Returns:
+        Dict: Measurement, see send_request().
+    """
+    boundary = uuid.uuid4().hex
+    file_name = f"{target}.bin"
+    body = (
+        f"--{boundary}\r\n"
+        f"Content-Disposition: form-data; name=\"{file_name}\"; filename=\"{file_name}\"\r\n"
+        f"Content-Type: application/octet-stream\r\n\r\n"
+    ).encode("utf-8") + image + f"\r\n--{boundary}--\r\n".encode("utf-8")
+    headers = {
+        "Content-Type": f"multipart/form-data; boundary={boundary}",
+        SIZE_HEADERS[target]: str(len(image))
+    }
+
+    return send_request(host, "POST", "/upload.html", body, headers)
+
+def upload_raw(host, target, image):
+    """
+    Upload the image with a single HTTP PUT request.
+
+    Args:
+        host: Device IP address or hostname.
+        target: "firmware" or "filesystem".
+        image: Binary.
+
+    Returns:
+        Dict: Measurement, see send_request().
+    """
+    headers = {
+        "Content-Type": "application/octet-stream",
+        SIZE_HEADERS[target]: str(len(image))
+    }
+
+    return send_request(host, "PUT", f"/{target}", image, headers)
+
+def upload_chunked(host, target, image):
+    """
+    Upload the image in resumable chunks.
+
+    Args:
+        host: Device IP address or hostname.
+        target: "firmware" or "filesystem".
+        image: Binary.
+
+    Returns:
+        Dict: Measurement with status and total time.
+    """
+    start = time.perf_counter()
+    is_successful = chunked_upload.upload(host, target, image, None, chunked_upload.DEFAULT_CHUNK_SIZE,
+                                          chunked_upload.DEFAULT_RETRIES, False)
+
+    return {
+        "status": 200 if is_successful else 0,
+        "message": "",
+        "time_s": time.perf_counter() - start
+    }
+
+def upload_serial(port_name, target, image):
+    """
+    Upload the image via the serial interface.
+
+    Args:
+        port_name: Serial port name.
+        target: "firmware" or "filesystem".
+        image: Binary.
+
+    Returns:
+        Dict: Measurement with status and total time.
+    """
+    import serial_upload # pylint: disable=import-outside-toplevel
+
+    start = time.perf_counter()
+    is_successful = serial_upload.upload(port_name, target, image, None, serial_upload.DEFAULT_RETRIES)
+
+    return {
+        "status": 200 if is_successful else 0,
+        "message": "",
+        "time_s": time.perf_counter() - start
+    }
+
+def get_metrics(host):
+    """
+    Get the device side metrics of the last upload.
+
+    Args:
+        host: Device IP address or hostname.
+
+    Returns:
+        Dict: Metric values by metric name or None, if not available.
+    """
+    metrics = None
+    connection = http.client.HTTPConnection(host, timeout=TIMEOUT)
+
+    try:
+        connection.request("GET", "/metrics")
+        response = connection.getresponse()
+        text = response.read().decode("utf-8", errors="replace")
+
+        if response.status == 200:
+            metrics = {}
+
+            for line in text.splitlines():
+                if line and not line.startswith("#"):
+                    name, value = line.rsplit(" ", 1)
+                    metrics[name] = float(value)
+    except (OSError, http.client.HTTPException, ValueError):
+        pass
+    finally:
+        connection.close()
+
+    return metrics
+
+def measure_reboot(host):
+    """
+    Switch to the application partition and measure the time until the
+    device answers HTTP requests again.
+
+    Args:
+        host: Device IP address or hostname.
+
+    Returns:
+        float: Time in s or None, if the device is not reachable.
+    """
+    result = send_request(host, "GET", "/change-partition", None, {})
+    start = time.perf_counter()
+    reboot_time = None
+
+    if result["status"] == 200:
+        # Wait until the device is gone, otherwise the old instance answers.
+        time.sleep(1.0)
+
+        while reboot_time is None and (time.perf_counter() - start) < REBOOT_TIMEOUT:
+            try:
+                send_request(host, "GET", "/", None, {})
+                reboot_time = time.perf_counter() - start
+            except (OSError, http.client.HTTPException):
+                time.sleep(REBOOT_POLL_PERIOD)
+
+    return reboot_time
+
+def run(args, path, target, image):
+    """
+    Run the benchmark of one upload path and target.
+
+    Args:
+        args: Command line arguments.
+        path: Upload path.
+        target: "firmware" or "filesystem".
+        image: Binary.
+
+    Returns:
+        Dict: Result with all runs and their summary.
+    """
+    runs = []
+    image_size = len(image)
+
+    if path == "compressed":
+        image = gzip.compress(image, 9)
+
+    for index in range(args.runs):
+        print(f"{path} {target} ({len(image)} bytes) run {index + 1}/{args.runs}")
+
+        try:
+            if path == "form":
+                measurement = upload_form(args.host, target, image)
+            elif path == "raw" or path == "compressed":
+                measurement = upload_raw(args.host, target, image)
+            elif path == "chunked":
+                measurement = upload_chunked(args.host, target, image)
+            else:
+                measurement = upload_serial(args.port, target, image)
+        except (OSError, http.client.HTTPException) as error:
+            measurement = {"status": 0, "message": str(error)}
+
+        measurement["success"] = measurement["status"] == 200
+
+        # The throughput is related to the written image, which is bigger than a compressed upload.
+        if measurement["success"]:
+            measurement["mb_per_s"] = image_size / measurement["time_s"] / 1e6
+
+        if path != "serial":
+            measurement["metrics"] = get_metrics(args.host)
+
+        runs.append(measurement)
+
+    successful = [measurement for measurement in runs if measurement["success"]]
+    summary = {
+        "runs": len(runs),
+        "failures": len(runs) - len(successful),
+        "failure_rate": (len(runs) - len(successful)) / len(runs)
+    }
+
+    for key in ["time_s", "ttfb_s", "finish_s", "mb_per_s"]:
+        values = [measurement[key] for measurement in successful if key in measurement]
+        if values:
+            summary[key] = {
+                "min": min(values),
+                "mean": statistics.mean(values),
+                "max": max(values)
+            }
+
+    return {
+        "path": path,
+        "target": target,
+        "size": len(image),
+        "image_size": image_size,
+        "summary": summary,
+        "runs": runs
+    }
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Benchmark the upload paths of the PixelixUpdater.")
+    parser.add_argument("host", help="IP address or hostname of the device.")
+    parser.add_argument("--env", default=get_default_env(), help="PlatformIO environment of the device.")
+    parser.add_argument("--firmware", help="Firmware binary, which is uploaded.")
+    parser.add_argument("--filesystem", help="Filesystem binary, which is uploaded.")
+    parser.add_argument("--filesystem-size", type=int, action="append", default=[],
+                        help="Size in byte of a synthetic filesystem image. Can be given several times.")
+    parser.add_argument("--paths", nargs="+", choices=PATHS, default=DEFAULT_PATHS, help="Upload paths to benchmark.")
+    parser.add_argument("--port", help="Serial port for the serial upload path.")
+    parser.add_argument("--runs", type=int, default=DEFAULT_RUNS, help="Runs per upload path and image.")
+    parser.add_argument("--reboot", action="store_true",
+                        help="Measure the end-to-end time through the /change-partition reboot at the end.")
+    parser.add_argument("--output", default=".", help="Directory for the result file.")
+    args = parser.parse_args()
+
+    images = []
+    results = []
+
+    if "serial" in args.paths and args.port is None:
+        parser.error("The serial upload path requires --port.")
+
+    if args.firmware is not None:
+        with open(args.firmware, "rb") as f:
+            images.append(("firmware", f.read()))
+
+    if args.filesystem is not None:
+        with open(args.filesystem, "rb") as f:
+            images.append(("filesystem", f.read()))
+
+    for size in args.filesystem_size:
+        images.append(("filesystem", create_filesystem_image(size)))
+
+    if not images:
+        parser.error("No image given, use --firmware, --filesystem or --filesystem-size.")
+
+    for path in args.paths:
+        for target, image in images:
+            results.append(run(args, path, target, image))
+
+    report = {
+        "env": args.env,
+        "host": args.host,
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "results": results
+    }
+
+    if args.reboot:
+        reboot_time = measure_reboot(args.host)
+        firmware_times = [result["summary"]["time_s"]["mean"] for result in results
+                          if result["target"] == "firmware" and "time_s" in result["summary"]]
+
+        report["reboot_s"] = reboot_time
+
+        # The last firmware upload is activated by the reboot.
+        if reboot_time is not None and firmware_times:
+            report["end_to_end_s"] = firmware_times[-1] + reboot_time
+
+    file_name = os.path.join(args.output, f"benchmark_{args.env}.json")
+
+    with open(file_name, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=4)
+
+    print(f"Results written to {file_name}.")
+
+    return 0 if all(result["summary"]["failures"] == 0 for result in results) else 1
+
+################################################################################
+# Main
+################################################################################
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,153 @@
+"""
+This script creates a bundle with a firmware and a filesystem image, which is
+uploaded in one request. The updater writes each segment to its partition and
+optional switches to app0 and restarts afterwards. A segment may be a gzip
+compressed image or a delta patch too.
+
+Usage: python create_bundle.py <bundle> --firmware firmware.bin --filesystem littlefs.bin --activate
+       curl -T <bundle> http://<ip-address>/bundle
+"""
+# MIT License
+#
+# Copyright (c) 2019 - 2025 Andreas Merkle (web@blue-andi.de)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+################################################################################
+# Imports
+################################################################################
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+################################################################################
+# Variables
+################################################################################
+
+BUNDLE_MAGIC = b"PXB1"
+
+FLAG_ACTIVATE = 0x01
+
+TARGETS = {
+    "firmware": 0,
+    "filesystem": 1
+}
+
+# The written image of a compressed image or a delta patch differs from the segment.
+GZIP_MAGIC = b"\x1f\x8b"
+PATCH_MAGIC = b"PXD1"
+
+NO_HASH = bytes(32)
+
+################################################################################
+# Classes
+################################################################################
+
+################################################################################
+# Functions
+################################################################################
+
+def get_image_hash(image):
+    """
+    Get the SHA-256 of the written image, which the device verifies.
+
+    Args:
+        image: Segment data.
+
+    Returns:
+        bytes: SHA-256 or all zero, if the written image differs from the segment.
+    """
+    if image.startswith(GZIP_MAGIC) or image.startswith(PATCH_MAGIC):
+        return NO_HASH
+
+    return hashlib.sha256(image).digest()
+
+def create_bundle(segments, is_activated, is_verified):
+    """
+    Create a bundle.
+
+    Args:
+        segments: List of target and segment data.
+        is_activated: Shall the device switch to app0 and restart afterwards?
+        is_verified: Shall the device verify the SHA-256 of uncompressed images?
+
+    Returns:
+        bytes: Bundle
+    """
+    flags = FLAG_ACTIVATE if is_activated else 0
+    header = BUNDLE_MAGIC + struct.pack("<BBH", len(segments), flags, 0)
+
+    for target, image in segments:
+        image_hash = get_image_hash(image) if is_verified else NO_HASH
+        header += struct.pack("<B3xI", TARGETS[target], len(image)) + image_hash
+
+    header += struct.pack("<I", zlib.crc32(header))
+
+    return header + b"".join(image for _, image in segments)
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Create a firmware and filesystem bundle for a single upload.")
+    parser.add_argument("bundle", help="Bundle file to create.")
+    parser.add_argument("--firmware", help="Firmware binary, optional gzip compressed or delta patch.")
+    parser.add_argument("--filesystem", help="Filesystem binary, optional gzip compressed or delta patch.")
+    parser.add_argument("--activate", action="store_true",
+                        help="Switch to app0 and restart, after the bundle is written.")
+    parser.add_argument("--no-verify", action="store_true",
+                        help="Don't verify the SHA-256 of the uncompressed images on the device.")
+    args = parser.parse_args()
+
+    segments = []
+
+    # The filesystem is written first, so an aborted bundle never leaves a new firmware with an old filesystem.
+    for target, file_name in (("filesystem", args.filesystem), ("firmware", args.firmware)):
+        if file_name is not None:
+            with open(file_name, "rb") as f:
+                segments.append((target, f.read()))
+
+    if not segments:
+        print("At least one binary is required.", file=sys.stderr)
+        return 1
+
+    bundle = create_bundle(segments, args.activate, not args.no_verify)
+
+    with open(args.bundle, "wb") as f:
+        f.write(bundle)
+
+    for target, image in segments:
+        print(f"{target}: {len(image)} bytes")
+
+    print(f"Bundle: {len(bundle)} bytes")
+
+    return 0
+
+################################################################################
+# Main
+################################################################################
+
+if __name__ == "__main__":
+    sys.exit(main())
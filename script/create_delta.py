@@ -0,0 +1,301 @@
+"""
+This script creates a delta patch, which updates an installed image to a new one.
+The patch is applied in place by the updater, which recognizes it by its magic bytes.
+
+Usage: python create_delta.py <installed image> <new image> <patch>
+"""
+
+# MIT License
+#
+# Copyright (c) 2019 - 2025 Andreas Merkle (web@blue-andi.de)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+################################################################################
+# Imports
+################################################################################
+
+import argparse
+import gzip
+import struct
+import sys
+import zlib
+
+################################################################################
+# Variables
+################################################################################
+
+PATCH_MAGIC = b"PXD1"
+
+OP_COPY = 0
+OP_ADD = 1
+OP_DATA = 2
+
+# Must be equal to the flash sector size of the device.
+SECTOR_SIZE = 4096
+
+# Max. number of sectors the patch may refer back, see DeltaPatcher::MAX_WINDOW_SECTORS.
+MAX_WINDOW_SECTORS = 16
+
+# Length of the blocks, which are used to find matches.
+BLOCK_SIZE = 16
+
+# Distance of the indexed blocks in the installed image.
+BLOCK_STEP = 4
+
+# Max. number of indexed positions per block.
+MAX_CANDIDATES = 8
+
+# Min. length of a match, which is worth an operation.
+MIN_MATCH_SIZE = 32
+
+# Stop the approximate match extension after this number of bytes without improvement.
+MAX_EXTENSION_GAP = 64
+
+################################################################################
+# Classes
+################################################################################
+
+################################################################################
+# Functions
+################################################################################
+
+def build_index(old):
+    """
+    Index the blocks of the installed image.
+
+    Args:
+        old: Installed image.
+
+    Returns:
+        Dict[bytes, List[int]]: Positions of every block.
+    """
+    index = {}
+
+    for pos in range(0, len(old) - BLOCK_SIZE + 1, BLOCK_STEP):
+        positions = index.setdefault(old[pos:pos + BLOCK_SIZE], [])
+        if len(positions) < MAX_CANDIDATES:
+            positions.append(pos)
+
+    return index
+
+def extend_match(old, new, new_pos, old_pos):
+    """
+    Extend a match forward. Mismatching bytes are accepted, as long as the
+    majority of the bytes match, because they are encoded as difference.
+
+    Args:
+        old: Installed image.
+        new: New image.
+        new_pos: Match position in the new image.
+        old_pos: Match position in the installed image.
+
+    Returns:
+        int: Match length.
+    """
+    max_length = min(len(new) - new_pos, len(old) - old_pos)
+    length = 0
+    score = 0
+    best_score = 0
+    best_length = 0
+
+    while length < max_length and (length - best_length) < MAX_EXTENSION_GAP:
+        if old[old_pos + length] == new[new_pos + length]:
+            score += 1
+        else:
+            score -= 1
+        length += 1
+
+        if score > best_score:
+            best_score = score
+            best_length = length
+
+    return best_length
+
+def find_match(old, new, index, new_pos, min_distance, last_distance):
+    """
+    Find the best match for the data at the position in the new image.
+
+    Args:
+        old: Installed image.
+        new: New image.
+        index: Block index of the installed image.
+        new_pos: Position in the new image.
+        min_distance: Min. distance between installed and new position, which
+            is readable during the in place update.
+        last_distance: Distance of the previous match.
+
+    Returns:
+        Tuple[int, int]: Position in the installed image and match length.
+    """
+    best_pos = 0
+    best_length = 0
+    candidates = list(index.get(new[new_pos:new_pos + BLOCK_SIZE], []))
+
+    # Data after a changed region is likely at the same distance as before.
+    if last_distance is not None and 0 <= new_pos + last_distance < len(old):
+        candidates.append(new_pos + last_distance)
+
+    for old_pos in candidates:
+        if (old_pos - new_pos) >= min_distance:
+            length = extend_match(old, new, new_pos, old_pos)
+            if length > best_length:
+                best_pos = old_pos
+                best_length = length
+
+    return best_pos, best_length
+
+def create_ops(old, new, window_sectors):
+    """
+    Create the patch operations.
+
+    Args:
+        old: Installed image.
+        new: New image.
+        window_sectors: Number of sectors, the patch may refer back.
+
+    Returns:
+        List[Tuple[int, int, bytes]]: Operations with type, source offset and data.
+    """
+    # The original content of a written sector is only available inside the window.
+    min_distance = -window_sectors * SECTOR_SIZE
+    index = build_index(old)
+    ops = []
+    literal_pos = 0
+    new_pos = 0
+    last_distance = None
+
+    while new_pos < len(new):
+        old_pos, length = find_match(old, new, index, new_pos, min_distance, last_distance)
+
+        if length < MIN_MATCH_SIZE:
+            new_pos += 1
+            continue
+
+        # Take matching bytes before the match from the literals.
+        while (new_pos > literal_pos and old_pos > 0 and
+               old[old_pos - 1] == new[new_pos - 1]):
+            old_pos -= 1
+            new_pos -= 1
+            length += 1
+
+        if new_pos > literal_pos:
+            ops.append((OP_DATA, 0, new[literal_pos:new_pos]))
+
+        diff = bytes((new[new_pos + idx] - old[old_pos + idx]) & 0xFF for idx in range(length))
+
+        if diff.count(0) == length:
+            ops.append((OP_COPY, old_pos, length))
+        else:
+            ops.append((OP_ADD, old_pos, diff))
+
+        last_distance = old_pos - new_pos
+        new_pos += length
+        literal_pos = new_pos
+
+    if literal_pos < len(new):
+        ops.append((OP_DATA, 0, new[literal_pos:]))
+
+    return ops
+
+def create_patch(old, new, window_sectors):
+    """
+    Create the patch.
+
+    Args:
+        old: Installed image.
+        new: New image.
+        window_sectors: Number of sectors, the patch may refer back.
+
+    Returns:
+        bytes: Patch.
+    """
+    patch = bytearray()
+    ops = create_ops(old, new, window_sectors)
+
+    patch += PATCH_MAGIC
+    patch += struct.pack("<IIII", len(old), zlib.crc32(old), len(new), window_sectors)
+
+    for op_type, offset, data in ops:
+        if op_type == OP_COPY:
+            patch += struct.pack("<BII", op_type, offset, data)
+        else:
+            patch += struct.pack("<BII", op_type, offset, len(data))
+            patch += data
+
+    return bytes(patch)
+
+def strip_padding(image):
+    """
+    Remove the erased flash content after an image, e.g. of a partition dump.
+
+    Args:
+        image: Image.
+
+    Returns:
+        bytes: Image without trailing 0xFF bytes.
+    """
+    return image.rstrip(b"\xff")
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Create a delta patch for an in place update.")
+    parser.add_argument("old", help="Installed image, e.g. the previous firmware.bin or a partition dump.")
+    parser.add_argument("new", help="New image.")
+    parser.add_argument("patch", help="Patch file to create.")
+    parser.add_argument("--window", type=int, default=MAX_WINDOW_SECTORS,
+                        help=f"Sectors the patch may refer back, costs 4 KB RAM each (max. {MAX_WINDOW_SECTORS}).")
+    parser.add_argument("--no-compress", action="store_true", help="Don't gzip compress the patch.")
+    args = parser.parse_args()
+
+    if not 0 <= args.window <= MAX_WINDOW_SECTORS:
+        print(f"Window must be in the range 0 - {MAX_WINDOW_SECTORS}.", file=sys.stderr)
+        return 1
+
+    with open(args.old, "rb") as f:
+        old = strip_padding(f.read())
+
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    patch = create_patch(old, new, args.window)
+
+    if not args.no_compress:
+        patch = gzip.compress(patch, compresslevel=9, mtime=0)
+
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+
+    print(f"Installed image: {len(old)} bytes")
+    print(f"New image: {len(new)} bytes")
+    print(f"Patch: {len(patch)} bytes ({100 * len(patch) / max(len(new), 1):.1f} %)")
+
+    return 0
+
+################################################################################
+# Main
+################################################################################
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -28,8 +28,11 @@ generates C header files with the compressed content as byte arrays.
 ################################################################################
 # Imports
 ################################################################################
+import base64
 import gzip
+import hashlib
 import os
+import re
 
 ################################################################################
 # Variables
@@ -39,6 +42,25 @@ SRC_FOLDER = "embed"
 DST_FOLDER = os.path.join("src", "generated")
 INDEX_FILE_BASE_NAME = "EmbeddedFiles"
 
+# In bundle mode, the page is served as a single document with all
+# referenced styles, scripts and images inlined.
+BUNDLE_PAGE = "index.html"
+
+# The root URI serves this page directly, which avoids a redirect.
+ROOT_PAGE = "index.html"
+
+# FNV-1a parameters of the URI hash, which is used for the route table lookup.
+FNV_OFFSET_BASIS = 0x811C9DC5
+FNV_PRIME = 0x01000193
+
+# Max. number of tried seeds per slot count to find a collision free URI hash.
+HASH_SEED_MAX = 0x10000
+
+# Build mode is selected by the PlatformIO project option "custom_embed_bundle"
+# or if the script is called directly, by the environment variable EMBED_BUNDLE.
+BUNDLE_PROJECT_OPTION = "custom_embed_bundle"
+BUNDLE_ENV_VARIABLE = "EMBED_BUNDLE"
+
 LICENSE = """\
 /* MIT License
  *
@@ -78,6 +100,23 @@ MIME_TYPES = {
     "ico": "image/x-icon"
 }
 
+# Files, which the browser shall revalidate on every use, because they reference
+# the other files. The references are versioned with the entity tag of the
+# referenced file, which are cached for CACHE_MAX_AGE seconds. Unreferenced
+# files are revalidated too, because they are requested by a fixed name.
+REVALIDATED_FILE_EXTENSIONS = [
+    "html"
+]
+
+# Max. age in seconds a browser may use a cached file without revalidation (1 week).
+CACHE_MAX_AGE = 604800
+
+# Query parameter in a reference, which contains the version of the referenced file.
+VERSION_QUERY = "v"
+
+# Number of hash characters used for the entity tag.
+ETAG_HASH_LENGTH = 16
+
 COMPRESSED_FILE_EXTENSIONS = [
     "html",
     "css",
@@ -360,16 +399,364 @@ class CppSourceGenerator(CppFileGenerator):
 # Functions
 ################################################################################
 
-def embed_file_name(file_name):
+def is_bundle_mode():
+    """
+    Is the bundle mode selected?
+
+    Returns:
+        bool: True if the page shall be bundled, otherwise False.
+    """
+    value = os.environ.get(BUNDLE_ENV_VARIABLE, "")
+
+    try:
+        # pylint: disable=undefined-variable
+        Import("env") # type: ignore
+        value = env.GetProjectOption(BUNDLE_PROJECT_OPTION, value) # type: ignore
+    except NameError:
+        # Not called by PlatformIO.
+        pass
+
+    return value.strip().lower() in ["1", "true", "yes", "on"]
+
+def hash_uri(uri, seed):
+    """
+    Calculate the FNV-1a hash of an URI. It must be the same as the generated
+    C function hashUri().
+
+    Args:
+        uri (str): URI with leading slash.
+        seed (int): Seed, which is XORed to the offset basis.
+
+    Returns:
+        int: 32-bit hash.
+    """
+    value = (FNV_OFFSET_BASIS ^ seed) & 0xFFFFFFFF
+
+    for byte in uri.encode("utf-8"):
+        value ^= byte
+        value = (value * FNV_PRIME) & 0xFFFFFFFF
+
+    return value
+
+def find_perfect_hash(uris):
+    """
+    Find the seed and the slot count of a collision free (perfect) hash for
+    the given URIs. The slot count is a power of two, at least twice the
+    number of URIs.
+
+    Args:
+        uris (list of str): URIs with leading slash.
+
+    Returns:
+        tuple: (seed, slot count)
+    """
+    slot_count = 1
+
+    while slot_count < (2 * len(uris)):
+        slot_count *= 2
+
+    while True:
+        for seed in range(HASH_SEED_MAX):
+            slots = {hash_uri(uri, seed) & (slot_count - 1) for uri in uris}
+
+            if len(slots) == len(uris):
+                return seed, slot_count
+
+        slot_count *= 2
+
+def _strip_css_comments(css):
+    """
+    Remove all comments from a stylesheet. Strings are kept untouched.
+
+    Args:
+        css (str): The stylesheet.
+
+    Returns:
+        str: The stylesheet without comments.
+    """
+    result = []
+    idx = 0
+    quote = None
+
+    while idx < len(css):
+        char = css[idx]
+
+        if quote is not None:
+            result.append(char)
+            if char == "\\":
+                result.append(css[idx + 1:idx + 2])
+                idx += 1
+            elif char == quote:
+                quote = None
+        elif char in "\"'":
+            quote = char
+            result.append(char)
+        elif css.startswith("/*", idx):
+            end = css.find("*/", idx + 2)
+            idx = len(css) if end < 0 else end + 1
+        else:
+            result.append(char)
+
+        idx += 1
+
+    return "".join(result)
+
+def _parse_css_rules(css):
+    """
+    Split a stylesheet without comments into its top level rules.
+
+    Args:
+        css (str): The stylesheet.
+
+    Returns:
+        list of (str, str): The prelude and the block content of every rule.
+            The block content is None for statements like @import.
+    """
+    rules = []
+    idx = 0
+    start = 0
+    depth = 0
+    quote = None
+    prelude = ""
+
+    while idx < len(css):
+        char = css[idx]
+
+        if quote is not None:
+            if char == "\\":
+                idx += 1
+            elif char == quote:
+                quote = None
+        elif char in "\"'":
+            quote = char
+        elif char == "{":
+            if depth == 0:
+                prelude = css[start:idx].strip()
+                start = idx + 1
+            depth += 1
+        elif char == "}":
+            depth -= 1
+            if depth == 0:
+                rules.append((prelude, css[start:idx]))
+                start = idx + 1
+        elif (char == ";") and (depth == 0):
+            rules.append((css[start:idx].strip(), None))
+            start = idx + 1
+
+        idx += 1
+
+    return rules
+
+def _split_selectors(prelude):
+    """
+    Split a selector list into its selectors.
+
+    Args:
+        prelude (str): The selector list, e.g. ".a, .b:not(.c, .d)".
+
+    Returns:
+        list of str: The selectors.
+    """
+    selectors = []
+    depth = 0
+    start = 0
+
+    for idx, char in enumerate(prelude):
+        if char in "([":
+            depth += 1
+        elif char in ")]":
+            depth -= 1
+        elif (char == ",") and (depth == 0):
+            selectors.append(prelude[start:idx].strip())
+            start = idx + 1
+
+    selectors.append(prelude[start:].strip())
+
+    return selectors
+
+def _is_selector_used(selector, tokens):
+    """
+    Check whether a selector may match an element of the page. It is used,
+    if all of its class names appear in the page or its scripts. Class names
+    inside of functional pseudo classes like :not() are not considered.
+
+    Args:
+        selector (str): The selector.
+        tokens (set of str): All words of the page and its scripts.
+
+    Returns:
+        bool: True if the selector may be used, otherwise False.
+    """
+    selector = re.sub(r"\([^()]*\)", "", re.sub(r"\[[^\]]*\]", "", selector))
+    class_names = re.findall(r"\.(-?[_a-zA-Z][\w-]*)", selector)
+
+    return all(class_name in tokens for class_name in class_names)
+
+def prune_css(css, tokens):
+    """
+    Remove all rules of a stylesheet, which can't match any element of the page.
+
+    Args:
+        css (str): The stylesheet.
+        tokens (set of str): All words of the page and its scripts.
+
+    Returns:
+        str: The pruned stylesheet.
+    """
+    result = []
+
+    for prelude, block in _parse_css_rules(_strip_css_comments(css)):
+        if block is None:
+            result.append(prelude + ";")
+        elif prelude.startswith(("@media", "@supports", "@layer", "@container")):
+            pruned_block = prune_css(block, tokens)
+            if pruned_block:
+                result.append(prelude + "{" + pruned_block + "}")
+        elif prelude.startswith("@"):
+            result.append(prelude + "{" + block + "}")
+        else:
+            selectors = [selector for selector in _split_selectors(prelude)
+                         if _is_selector_used(selector, tokens)]
+            if selectors:
+                result.append(",".join(selectors) + "{" + block + "}")
+
+    return "".join(result)
+
+def bundle_page(file_name):
+    """
+    Bundle a html page with all of its local stylesheets, scripts and images
+    into a single document. Unused style rules are removed.
+
+    Args:
+        file_name (str): The file name of the page in the embed folder.
+
+    Returns:
+        bytes: The bundled page.
+    """
+    def read_text(name):
+        with open(os.path.join(SRC_FOLDER, name), "r", encoding="utf-8") as f:
+            return f.read()
+
+    def is_local(name):
+        return os.path.isfile(os.path.join(SRC_FOLDER, name))
+
+    page = read_text(file_name)
+
+    # Remove comments and indentation. Lines are kept, because of the inline scripts.
+    page = re.sub(r"<!--.*?-->", "", page, flags=re.DOTALL)
+    page = "\n".join(line.strip() for line in page.splitlines() if line.strip())
+
+    # Inline the scripts and escape end tags inside them.
+    scripts = {}
+    for name in re.findall(r'<script[^>]*\ssrc="([^"]+)"', page):
+        if is_local(name):
+            scripts[name] = read_text(name).replace("</script", "<\\/script")
+
+    def inline_script(match):
+        name = match.group(1)
+        if name not in scripts:
+            return match.group(0)
+        return "<script>" + scripts[name] + "</script>"
+
+    page = re.sub(r'<script[^>]*\ssrc="([^"]+)"[^>]*>\s*</script>', inline_script, page)
+
+    # The words of the page and all of its scripts decide which styles are used.
+    tokens = set(re.findall(r"[\w-]+", page))
+
+    def inline_style(match):
+        name = match.group(1)
+        if not is_local(name):
+            return match.group(0)
+        return "<style>" + prune_css(read_text(name), tokens) + "</style>"
+
+    page = re.sub(r'<link[^>]*rel="stylesheet"[^>]*href="([^"]+)"[^>]*>', inline_style, page)
+
+    # Images are inlined as data URIs.
+    def inline_image(match):
+        name = match.group(2)
+        file_extension = name.split('.')[-1].lower()
+        if (not is_local(name)) or (file_extension not in ["png", "jpg", "jpeg", "gif", "ico", "svg"]):
+            return match.group(0)
+        with open(os.path.join(SRC_FOLDER, name), "rb") as f:
+            data = base64.b64encode(f.read()).decode("ascii")
+        mime_type = MIME_TYPES.get(file_extension, "application/octet-stream")
+        return f'{match.group(1)}="data:{mime_type};base64,{data}"'
+
+    page = re.sub(r'(src|href)="([^":#?]+)"', inline_image, page)
+
+    return page.encode("utf-8")
+
+def get_etag(content):
+    """
+    Get the entity tag of a file content.
+
+    Args:
+        content (bytes): The original file content.
+
+    Returns:
+        str: The entity tag without quotes.
+    """
+    return hashlib.sha256(content).hexdigest()[:ETAG_HASH_LENGTH]
+
+def get_versions():
+    """
+    Get the version of every local file, which is referenced by a page.
+
+    Returns:
+        dict: The entity tag of the referenced files by their file name.
+    """
+    versions = {}
+
+    for file_name in os.listdir(SRC_FOLDER):
+        if file_name.split('.')[-1].lower() in REVALIDATED_FILE_EXTENSIONS:
+            with open(os.path.join(SRC_FOLDER, file_name), "r", encoding="utf-8") as f:
+                names = re.findall(r'(?:src|href)="([^":#?]+)"', f.read())
+
+            for name in names:
+                file_path = os.path.join(SRC_FOLDER, name)
+                file_extension = name.split('.')[-1].lower()
+                if (os.path.isfile(file_path)) and (file_extension not in REVALIDATED_FILE_EXTENSIONS):
+                    with open(file_path, "rb") as f:
+                        versions[name] = get_etag(f.read())
+
+    return versions
+
+def version_references(page, versions):
+    """
+    Append the version to every reference of a page to a versioned file.
+    The web server ignores the query, when it looks up the file.
+
+    Args:
+        page (bytes): The page content.
+        versions (dict): The entity tag of the referenced files by their file name.
+
+    Returns:
+        bytes: The page with versioned references.
+    """
+    def version_reference(match):
+        name = match.group(2)
+        if name not in versions:
+            return match.group(0)
+        return f'{match.group(1)}="{name}?{VERSION_QUERY}={versions[name]}"'
+
+    return re.sub(r'(src|href)="([^":#?]+)"', version_reference, page.decode("utf-8")).encode("utf-8")
+
+def embed_file_name(file_name, is_bundle=False, versions=None):
     """
     Generate a C++ module with embedded file content.
     
     Args:
         file_name (str): The path of the file.
+        is_bundle (bool): Embed the page with all its resources bundled.
+        versions (dict): The entity tag of the files, which are referenced
+            versioned by the pages.
         
     Returns:
         (str, str): The original file name and the generated C++ module base name.
     """
+    if versions is None:
+        versions = {}
+
     file_path = os.path.join(SRC_FOLDER, file_name)
     file_extension = file_name.split('.')[-1].lower()
 
@@ -382,16 +769,49 @@ def embed_file_name(file_name):
     header_path = os.path.join(DST_FOLDER, header_filename)
     source_path = os.path.join(DST_FOLDER, source_filename)
 
+    # A bundled page depends on all files. A page depends on the versions of
+    # its referenced files.
+    if is_bundle is True:
+        source_brief = f"Bundled content of {file_name}"
+        dependencies = [os.path.join(SRC_FOLDER, name) for name in os.listdir(SRC_FOLDER)]
+    elif file_extension in REVALIDATED_FILE_EXTENSIONS:
+        source_brief = f"Compressed content of {file_name}"
+        dependencies = [os.path.join(SRC_FOLDER, name) for name in os.listdir(SRC_FOLDER)]
+    else:
+        source_brief = f"Compressed content of {file_name}"
+        dependencies = [file_path]
+
+    # Only files, which are referenced versioned, can be cached without revalidation.
+    if (file_extension not in REVALIDATED_FILE_EXTENSIONS) and (file_name in versions):
+        cache_control = f"max-age={CACHE_MAX_AGE}"
+    else:
+        cache_control = "no-cache"
+
     # Skip file if its content is already embedded and didn't change.
     if os.path.exists(header_path) and os.path.exists(source_path):
-        # Check by commparing the timestamps of the source files.
-        if os.path.getmtime(file_path) <= os.path.getmtime(source_path):
+        # Check by commparing the timestamps of the source files and this script,
+        # because the generated code depends on both. The brief and the cache
+        # control show whether it was generated in the same mode.
+        source_mtime = os.path.getmtime(source_path)
+        with open(source_path, "r", encoding="utf-8") as f:
+            source = f.read()
+            is_same_mode = (f"@brief  {source_brief}\n" in source) and \
+                           (f'return "{cache_control}";' in source)
+        if (is_same_mode is True) and \
+           (all(os.path.getmtime(path) <= source_mtime for path in dependencies)) and \
+           (os.path.getmtime(__file__) <= source_mtime):
             return file_name, base_name
 
     mime_type = MIME_TYPES.get(file_extension, "application/octet-stream")
 
-    with open(file_path, "rb") as f:
-        html_content = f.read()
+    if is_bundle is True:
+        html_content = bundle_page(file_name)
+    else:
+        with open(file_path, "rb") as f:
+            html_content = f.read()
+
+        if file_extension in REVALIDATED_FILE_EXTENSIONS:
+            html_content = version_references(html_content, versions)
 
     # Compress only specific file types.
     content = html_content
@@ -400,6 +820,10 @@ def embed_file_name(file_name):
         content = gzip.compress(html_content)
         is_compressed = "true"
 
+    # The entity tag is derived from the original content, because the gzip
+    # output may differ between python versions although the content is equal.
+    etag = get_etag(html_content)
+
     header_includes = [
         "#include <stdint.h>",
         "#include <stddef.h>"]
@@ -426,7 +850,21 @@ extern const char* {base_name}_getMimeType();
  * 
  * @return true if the file is compressed, otherwise false.
  */
-extern bool {base_name}_isCompressed();\
+extern bool {base_name}_isCompressed();
+
+/**
+ * @brief Get the entity tag (ETag) of the file, which changes with its content.
+ *
+ * @return Entity tag incl. quotes as a string.
+ */
+extern const char* {base_name}_getETag();
+
+/**
+ * @brief Get the cache control directive for the browser.
+ *
+ * @return Cache control directive as a string.
+ */
+extern const char* {base_name}_getCacheControl();\
 """)
 
     header_generator = CppHeaderGenerator(
@@ -481,12 +919,22 @@ return "{mime_type}";
 extern bool {base_name}_isCompressed()
 {{
 return {is_compressed};
+}}
+
+extern const char* {base_name}_getETag()
+{{
+return "\\"{etag}\\"";
+}}
+
+extern const char* {base_name}_getCacheControl()
+{{
+return "{cache_control}";
 }}\
 """)
 
     source_generator = CppSourceGenerator(
         file_path=source_path,
-        brief=f"Compressed content of {file_name}",
+        brief=source_brief,
         author="Andreas Merkle <web@blue-andi.de>",
         includes=source_includes,
         local_variables=source_local_variables,
@@ -503,8 +951,13 @@ def generate():
     """
     embed_data = []
 
-    for file_name in os.listdir(SRC_FOLDER):
-        embed_data.append(embed_file_name(file_name))
+    # The bundled page contains all other files, therefore only it is embedded.
+    if is_bundle_mode() is True:
+        embed_data.append(embed_file_name(BUNDLE_PAGE, True))
+    else:
+        versions = get_versions()
+        for file_name in os.listdir(SRC_FOLDER):
+            embed_data.append(embed_file_name(file_name, versions=versions))
 
     # Genreate module with all compressed files.
     module_header_path = os.path.join(DST_FOLDER, f"{INDEX_FILE_BASE_NAME}.h")
@@ -514,14 +967,54 @@ def generate():
         "#include <stdint.h>",
         "#include <stddef.h>",
         "#include <WebServer.h>",]
+    header_types_and_classes = []
+    header_types_and_classes.append("""\
+/**
+ * @brief An embedded file.
+ */
+typedef struct
+{
+    const char*    uri;                         /**< URI with leading slash */
+    const uint8_t* (*getFile)(size_t* size);    /**< Get the content */
+    const char*    (*getMimeType)();            /**< Get the MIME type */
+    bool           (*isCompressed)();           /**< Is the content gzip compressed? */
+    const char*    (*getETag)();                /**< Get the entity tag */
+    const char*    (*getCacheControl)();        /**< Get the cache control directive */
+
+} EmbeddedFile;\
+""")
+
     header_external_functions = []
     header_external_functions.append(f"""\
+/**
+ * @brief Find an embedded file by its URI in constant time.
+ * The URI "/" is an alias of the root page.
+ *
+ * @param[in] uri       URI with leading slash, not necessarily null terminated.
+ * @param[in] uriLen    Length of the URI without query.
+ *
+ * @return Embedded file or nullptr, if not found.
+ */
+extern const EmbeddedFile* {INDEX_FILE_BASE_NAME}_find(const char* uri, size_t uriLen);
+
 /**
  * @brief Setup embedded files for the web server.
+ * A single request handler serves all embedded files.
+ * The "If-None-Match" request header must be collected by the web server,
+ * otherwise the browser cache is never validated.
  * 
  * @param[in] server    Web server instance to register the embedded files with.
  */
-extern void {INDEX_FILE_BASE_NAME}_setup(WebServer& server);\
+extern void {INDEX_FILE_BASE_NAME}_setup(WebServer& server);
+
+/**
+ * @brief Get the peak heap usage while an embedded file was sent.
+ * It is measured by the free heap before and during sending, therefore
+ * allocations of other tasks at the same time are included.
+ *
+ * @return Peak heap usage in byte.
+ */
+extern uint32_t {INDEX_FILE_BASE_NAME}_getHeapPeakUsage();\
 """)
 
     header_generator = CppHeaderGenerator(
@@ -530,39 +1023,303 @@ extern void {INDEX_FILE_BASE_NAME}_setup(WebServer& server);\
         author="Andreas Merkle <web@blue-andi.de>",
         group="GENERATED",
         includes=header_includes,
+        types_and_classes=header_types_and_classes,
         external_functions=header_external_functions)
 
-    source_includes = [f'#include "{INDEX_FILE_BASE_NAME}.h"']
+    source_includes = [
+        f'#include "{INDEX_FILE_BASE_NAME}.h"',
+        "#include <string.h>",
+        "#include <inttypes.h>",
+        "#include <Arduino.h>",
+        "#include <esp_log.h>"]
 
     for data in embed_data:
         _file_name, base_name = data
         source_includes.append(f'#include "{base_name}.h"')
 
+    source_prototypes = [
+        "static uint32_t hashUri(const char* uri, size_t uriLen);",
+        "static bool isCached(WebServer& server, const char* etag);",
+        "static void sendFile(WebServer& server, const EmbeddedFile& file);"]
+
+    # The class is defined after the prototypes, because it uses them.
+    source_prototypes.append("")
+    source_prototypes.append("""\
+/**
+ * @brief Request handler, which serves all embedded files. It replaces a
+ * route per file, which would be searched one after another.
+ */
+class EmbeddedFileHandler : public RequestHandler
+{
+public:
+
+    /**
+     * @brief Can the request be handled?
+     *
+     * @param[in] server    Web server instance.
+     * @param[in] method    HTTP method.
+     * @param[in] uri       Request URI.
+     *
+     * @return If the URI is an embedded file, it will return true otherwise false.
+     */
+    bool canHandle(WebServer& server, HTTPMethod method, const String& uri) override
+    {
+        (void)server;
+
+        return (HTTP_GET == method) && (nullptr != EmbeddedFiles_find(uri.c_str(), uri.length()));
+    }
+
+    /**
+     * @brief Handle the request by sending the embedded file.
+     *
+     * @param[in] server        Web server instance.
+     * @param[in] requestMethod HTTP method.
+     * @param[in] requestUri    Request URI.
+     *
+     * @return If the request was handled, it will return true otherwise false.
+     */
+    bool handle(WebServer& server, HTTPMethod requestMethod, const String& requestUri) override
+    {
+        bool                isHandled = false;
+        const EmbeddedFile* file      = EmbeddedFiles_find(requestUri.c_str(), requestUri.length());
+
+        if ((HTTP_GET == requestMethod) && (nullptr != file))
+        {
+            sendFile(server, *file);
+            isHandled = true;
+        }
+
+        return isHandled;
+    }
+};\
+""")
+
+    source_local_functions = []
+    source_local_functions.append("""\
+/**
+ * @brief Calculate the FNV-1a hash of an URI, seeded by HASH_SEED.
+ *
+ * @param[in] uri       URI, not necessarily null terminated.
+ * @param[in] uriLen    Length of the URI.
+ *
+ * @return 32-bit hash
+ */
+static uint32_t hashUri(const char* uri, size_t uriLen)
+{
+    uint32_t hash = FNV_OFFSET_BASIS ^ HASH_SEED;
+    size_t   idx  = 0U;
+
+    for (idx = 0U; idx < uriLen; ++idx)
+    {
+        hash ^= static_cast<uint8_t>(uri[idx]);
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}\
+""")
+    source_local_functions.append("")
+    source_local_functions.append("""\
+/**
+ * @brief Check whether the browser has the file already cached, by comparing
+ * the entity tags of the If-None-Match request header with the current one.
+ *
+ * @param[in] server    Web server instance.
+ * @param[in] etag      Current entity tag of the file.
+ *
+ * @return If the cached file is up to date, it will return true otherwise false.
+ */
+static bool isCached(WebServer& server, const char* etag)
+{
+    String ifNoneMatch = server.header("If-None-Match");
+
+    /* The header may contain a list of weak or strong entity tags. */
+    return (ifNoneMatch == "*") || (0 <= ifNoneMatch.indexOf(etag));
+}\
+""")
+    source_local_functions.append("")
+    source_local_functions.append("""\
+/**
+ * @brief Send an embedded file. The content is written to the client in
+ * chunks directly from flash, so no copy of the whole file is allocated.
+ *
+ * @param[in] server    Web server instance.
+ * @param[in] file      Embedded file.
+ */
+static void sendFile(WebServer& server, const EmbeddedFile& file)
+{
+    const char* etag = file.getETag();
+
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", file.getCacheControl());
+
+    /* Browser has the same content already cached? */
+    if (true == isCached(server, etag))
+    {
+        server.send(304);
+    }
+    else
+    {
+        size_t         size          = 0U;
+        const uint8_t* content       = file.getFile(&size);
+        size_t         offset        = 0U;
+        bool           isError       = false;
+        uint32_t       freeHeapStart = ESP.getFreeHeap();
+        uint32_t       freeHeapMin   = freeHeapStart;
+        WiFiClient&    client        = server.client();
+
+        if (true == file.isCompressed())
+        {
+            server.sendHeader("Content-Encoding", "gzip");
+        }
+
+        /* Send the headers only, the content follows. */
+        server.setContentLength(size);
+        server.send(200, file.getMimeType(), "");
+
+        while ((size > offset) && (false == isError))
+        {
+            size_t   chunkSize = ((size - offset) < SEND_CHUNK_SIZE) ? (size - offset) : SEND_CHUNK_SIZE;
+            size_t   written   = client.write(&content[offset], chunkSize);
+            uint32_t freeHeap  = ESP.getFreeHeap();
+
+            if (freeHeapMin > freeHeap)
+            {
+                freeHeapMin = freeHeap;
+            }
+
+            /* Nothing written, if the connection is lost or the send timeout elapsed. */
+            if (0U == written)
+            {
+                ESP_LOGW(LOG_TAG, "Failed to send %s at %u of %u bytes.", file.uri, offset, size);
+                isError = true;
+            }
+            else
+            {
+                offset += written;
+            }
+        }
+
+        if ((freeHeapStart - freeHeapMin) > gHeapPeakUsage)
+        {
+            gHeapPeakUsage = freeHeapStart - freeHeapMin;
+
+            ESP_LOGD(LOG_TAG, "Peak heap usage %" PRIu32 " bytes, while sending %s.", gHeapPeakUsage, file.uri);
+        }
+    }
+}\
+""")
+
+    source_local_variables = []
+    source_local_variables.append("""\
+/**
+ * @brief Tag for logging purposes.
+ */
+static const char LOG_TAG[] = "EmbeddedFiles";
+
+/**
+ * @brief Chunk size in byte, which is written at once to the client. It
+ * corresponds to the TCP maximum segment size.
+ */
+static const size_t SEND_CHUNK_SIZE = 1436U;
+
+/**
+ * @brief Peak heap usage in byte while an embedded file was sent.
+ */
+static uint32_t gHeapPeakUsage = 0U;\
+""")
+    source_local_variables.append("")
+    # The root URI is an alias of the root page, if it is embedded.
+    routes = [(f"/{file_name}", base_name) for file_name, base_name in embed_data]
+    routes += [("/", base_name) for file_name, base_name in embed_data if file_name == ROOT_PAGE]
+
+    seed, slot_count = find_perfect_hash([uri for uri, _base_name in routes])
+    slots = [0] * slot_count
+
+    for idx, (uri, _base_name) in enumerate(routes):
+        slots[hash_uri(uri, seed) & (slot_count - 1)] = idx + 1
+
+    source_local_variables.append(f"""\
+/**
+ * @brief Seed of the URI hash, which maps all URIs to different slots.
+ */
+static const uint32_t HASH_SEED = {seed}U;
+
+/**
+ * @brief FNV-1a offset basis.
+ */
+static const uint32_t FNV_OFFSET_BASIS = 0x{FNV_OFFSET_BASIS:08X}U;
+
+/**
+ * @brief FNV-1a prime.
+ */
+static const uint32_t FNV_PRIME = 0x{FNV_PRIME:08X}U;
+
+/**
+ * @brief Number of hash slots, which is a power of two.
+ */
+static const size_t SLOT_COUNT = {slot_count}U;\
+""")
+    source_local_variables.append("")
+
+    files = "".join(f"""\
+    {{ "{uri}", {base_name}_getFile, {base_name}_getMimeType, {base_name}_isCompressed, {base_name}_getETag, {base_name}_getCacheControl }},
+""" for uri, base_name in routes)
+    source_local_variables.append(f"""\
+/**
+ * @brief All embedded files.
+ */
+static const EmbeddedFile gFiles[] = {{
+{files}}};\
+""")
+    source_local_variables.append("")
+    slot_values = ", ".join(f"{slot}U" for slot in slots)
+    source_local_variables.append(f"""\
+/**
+ * @brief Hash slots with the index of the file plus one. Zero is an empty slot.
+ */
+static const uint8_t gSlots[SLOT_COUNT] = {{ {slot_values} }};\
+""")
+
     source_external_functions = []
     source_external_functions.append(f"""\
-extern void {INDEX_FILE_BASE_NAME}_setup(WebServer& server)
+extern const EmbeddedFile* {INDEX_FILE_BASE_NAME}_find(const char* uri, size_t uriLen)
 {{
-""")
+    const EmbeddedFile* file = nullptr;
+    uint8_t             slot = gSlots[hashUri(uri, uriLen) & (SLOT_COUNT - 1U)];
 
-    for data in embed_data:
-        file_name, base_name = data
-        source_external_functions.append(f"""\
-    server.on("/{file_name}", HTTP_GET, [&server]() {{
-        size_t      size     = 0U;
-        const char* content  = reinterpret_cast<const char*>({base_name}_getFile(&size));
-        const char* mimeType = {base_name}_getMimeType();
-
-        if (true == {base_name}_isCompressed())
+    /* The hash is only unique for the embedded URIs, therefore the URI is compared. */
+    if (0U != slot)
+    {{
+        const EmbeddedFile* candidate = &gFiles[slot - 1U];
+
+        if ((uriLen == strlen(candidate->uri)) && (0 == strncmp(candidate->uri, uri, uriLen)))
         {{
-            server.sendHeader("Content-Encoding", "gzip");
+            file = candidate;
         }}
+    }}
+
+    return file;
+}}
 
-        server.send_P(200, mimeType, content, size);
-    }});
+""")
+    source_external_functions.append(f"""\
+extern void {INDEX_FILE_BASE_NAME}_setup(WebServer& server)
+{{
 """)
 
     source_external_functions.append("""\
-}
+    /* The handler is owned by the web server. */
+    server.addHandler(new EmbeddedFileHandler());
+""")
+
+    source_external_functions.append(f"""\
+}}
+
+extern uint32_t {INDEX_FILE_BASE_NAME}_getHeapPeakUsage()
+{{
+    return gHeapPeakUsage;
+}}
 """)
 
     source_generator = CppSourceGenerator(
@@ -570,7 +1327,10 @@ extern void {INDEX_FILE_BASE_NAME}_setup(WebServer& server)
         brief="Embedded files for the web server",
         author="Andreas Merkle <web@blue-andi.de>",
         includes=source_includes,
-        external_functions=source_external_functions)
+        prototypes=source_prototypes,
+        local_variables=source_local_variables,
+        external_functions=source_external_functions,
+        local_functions=source_local_functions)
 
     # Generate module header and source files.
     header_generator.generate()
@@ -1,5 +1,11 @@
 """
 This script is used to flash a factory binary to an ESP32 device after the upload action.
+
+Standalone it flashes the segment list of a sparse merged image, which is
+created by merge_factory.py with "custom_merge_sparse = yes". Only the populated
+regions are written, compressed and at the baud rate of the segment list.
+
+Usage: python flash_factory.py <merged-firmware.json> --port <serial-port>
 """
 
 # MIT License
@@ -29,9 +35,18 @@ This script is used to flash a factory binary to an ESP32 device after the uploa
 ################################################################################
 # Imports
 ################################################################################
+import argparse
+import json
 import os
+import subprocess
+import sys
 
-Import("env") # pylint: disable=undefined-variable
+# The environment exists only if the script is run by PlatformIO.
+try:
+    Import("env") # pylint: disable=undefined-variable
+    IS_PLATFORMIO = True
+except NameError:
+    IS_PLATFORMIO = False
 
 ################################################################################
 # Variables
@@ -68,8 +83,12 @@ def flash_factory_binary(target, source, env):
     factory_image = os.path.join(project_dir, f"{FACTORY_PROGNAME}.bin")
 
     # Get write flash relevant parameters from the environment.
+    # The board may be flashed faster than its default upload speed.
     chip = env.get("BOARD_MCU")
-    upload_speed = env.BoardConfig().get("upload.speed")
+    upload_speed = env.GetProjectOption("custom_flash_speed", "")
+
+    if upload_speed == "":
+        upload_speed = env.BoardConfig().get("upload.speed")
 
     env.Execute(
         f"esptool.py "
@@ -77,12 +96,67 @@ def flash_factory_binary(target, source, env):
         f"--chip {chip} "
         f"--port {env.get('UPLOAD_PORT')} "
         f"write_flash "
+        f"-z "
         f"{FACTORY_OFFSET} "
         f"{factory_image}"
     )
 
+def flash_segments(segment_list, port, baud, chip):
+    """
+    Flash all segments of a segment list with one esptool call.
+
+    Args:
+        segment_list: Path of the segment list.
+        port: Serial port.
+        baud: Baud rate or None for the one of the segment list.
+        chip: Chip type or None for the one of the segment list.
+
+    Returns:
+        int: Exit code of esptool.
+    """
+    with open(segment_list, "r", encoding="utf-8") as f:
+        segments = json.load(f)
+
+    segment_dir = os.path.dirname(os.path.abspath(segment_list))
+    written_size = sum(segment["size"] for segment in segments["segments"])
+    cmd = [
+        sys.executable, "-m", "esptool",
+        "--chip", chip if chip is not None else segments["chip"],
+        "--port", port,
+        "--baud", str(baud if baud is not None else segments["baud"]),
+        "write_flash",
+        "-z"
+    ]
+
+    for segment in segments["segments"]:
+        cmd.append(segment["offset"])
+        cmd.append(os.path.join(segment_dir, segment["file"]))
+
+    print(f"Flashing {written_size} bytes in {len(segments['segments'])} segments.")
+
+    return subprocess.run(cmd, check=False).returncode
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Flash the segment list of a sparse merged image.")
+    parser.add_argument("segment_list", help="Segment list, e.g. merged-firmware.json.")
+    parser.add_argument("--port", required=True, help="Serial port of the device.")
+    parser.add_argument("--baud", type=int, help="Baud rate, default is the one of the segment list.")
+    parser.add_argument("--chip", help="Chip type, default is the one of the segment list.")
+    args = parser.parse_args()
+
+    return flash_segments(args.segment_list, args.port, args.baud, args.chip)
+
 ################################################################################
 # Main
 ################################################################################
 
-env.AddPostAction("upload", flash_factory_binary) # pylint: disable=undefined-variable
+if IS_PLATFORMIO:
+    env.AddPostAction("upload", flash_factory_binary) # pylint: disable=undefined-variable
+elif __name__ == "__main__":
+    sys.exit(main())
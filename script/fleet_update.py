@@ -0,0 +1,573 @@
+"""
+This script updates a fleet of PixelixUpdater devices in parallel. The devices
+are discovered via mDNS, where every updater advertises the service
+"_pixelix-updater._tcp" with its hostname, or via the attached serial ports.
+Further devices can be given by their ip-address or serial port name.
+
+A bounded pool uploads the binaries to several devices at once. Every device
+is retried on its own, a HTTP upload is resumed at the committed offset. After
+a successful upload, the device is switched to the application partition
+(/change-partition respectively the terminal commands "activate app" and
+"restart"). The progress of the whole fleet is shown in one line.
+
+Usage: python fleet_update.py --mdns --firmware firmware.bin --filesystem littlefs.bin
+"""
+# MIT License
+#
+# Copyright (c) 2019 - 2025 Andreas Merkle (web@blue-andi.de)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+################################################################################
+# Imports
+################################################################################
+
+import argparse
+import concurrent.futures
+import fnmatch
+import hashlib
+import http.client
+import socket
+import struct
+import sys
+import threading
+import time
+
+import upload as chunked_upload
+
+################################################################################
+# Variables
+################################################################################
+
+MDNS_ADDRESS = "224.0.0.251"
+
+MDNS_PORT = 5353
+
+MDNS_SERVICE = "_pixelix-updater._tcp.local"
+
+# DNS record types
+DNS_TYPE_A = 1
+DNS_TYPE_PTR = 12
+DNS_TYPE_SRV = 33
+
+# DNS class IN with the "unicast response" bit set.
+DNS_CLASS_IN_QU = 0x8001
+
+# Max. number of followed name compression pointers.
+DNS_MAX_POINTERS = 16
+
+DEFAULT_DISCOVERY_TIMEOUT = 3 # s
+
+DEFAULT_JOBS = 8
+
+DEFAULT_ATTEMPTS = 3
+
+RETRY_DELAY = 5 # s
+
+PROGRESS_PERIOD = 1 # s
+
+TIMEOUT = 30 # s
+
+################################################################################
+# Classes
+################################################################################
+
+class Device:
+    """
+    A device of the fleet, which is reachable via HTTP or serial interface.
+    """
+
+    def __init__(self, name, address, is_serial):
+        """
+        Create a device.
+
+        Args:
+            name (str): Name, which is shown in the progress, e.g. the hostname.
+            address (str): IP address, hostname or serial port name.
+            is_serial (bool): Is the device attached via serial interface?
+        """
+        self.name = name
+        self.address = address
+        self.is_serial = is_serial
+
+class FleetProgress:
+    """
+    Collects the progress of all devices, which are updated in parallel.
+    """
+
+    def __init__(self, devices, total_size):
+        """
+        Create the progress for a fleet.
+
+        Args:
+            devices (List[Device]): Devices of the fleet.
+            total_size (int): Size of all binaries of one device in byte.
+        """
+        self._lock = threading.Lock()
+        self._done = {device.name: 0 for device in devices}
+        self._base = {device.name: 0 for device in devices}
+        self._states = {device.name: "waiting" for device in devices}
+        self._total_size = total_size
+
+    def set_state(self, name, state):
+        """
+        Set the state of a device.
+
+        Args:
+            name (str): Device name.
+            state (str): "waiting", "running", "finished" or "failed".
+        """
+        with self._lock:
+            self._states[name] = state
+
+    def begin_binary(self, name, base):
+        """
+        Begin the upload of a binary. The progress of a retried binary starts
+        again at its begin.
+
+        Args:
+            name (str): Device name.
+            base (int): Size of the binaries of this device, which are already uploaded.
+        """
+        with self._lock:
+            self._base[name] = base
+            self._done[name] = base
+
+    def update(self, name, offset):
+        """
+        Update the progress of the current binary of a device.
+
+        Args:
+            name (str): Device name.
+            offset (int): Uploaded bytes of the current binary.
+        """
+        with self._lock:
+            self._done[name] = self._base[name] + offset
+
+    def get_line(self):
+        """
+        Get the progress of the whole fleet as one line.
+
+        Returns:
+            str: Progress line.
+        """
+        with self._lock:
+            states = list(self._states.values())
+            done = sum(self._done.values())
+
+        total = self._total_size * len(states)
+        percent = (100 * done / total) if total > 0 else 100
+
+        return (f"{states.count('finished')} finished, {states.count('failed')} failed, "
+                f"{states.count('running')} running, {states.count('waiting')} waiting - "
+                f"{done / 1e6:.1f} / {total / 1e6:.1f} MB ({percent:.0f} %)")
+
+################################################################################
+# Functions
+################################################################################
+
+def encode_name(name):
+    """
+    Encode a domain name as DNS labels.
+
+    Args:
+        name (str): Domain name, e.g. "_pixelix-updater._tcp.local".
+
+    Returns:
+        bytes: Encoded name.
+    """
+    data = b""
+
+    for label in name.split("."):
+        encoded = label.encode("utf-8")
+        data += bytes([len(encoded)]) + encoded
+
+    return data + b"\x00"
+
+def read_name(packet, offset):
+    """
+    Read a domain name, which may be compressed.
+
+    Args:
+        packet (bytes): DNS packet.
+        offset (int): Offset of the name in the packet.
+
+    Returns:
+        Tuple[str, int]: Domain name in lower case and the offset after the name.
+    """
+    labels = []
+    end = None
+    pointers = 0
+
+    while True:
+        length = packet[offset]
+
+        if (length & 0xC0) == 0xC0:
+            if end is None:
+                end = offset + 2
+
+            pointers += 1
+            if pointers > DNS_MAX_POINTERS:
+                raise ValueError("Too many name compression pointers.")
+
+            offset = struct.unpack_from(">H", packet, offset)[0] & 0x3FFF
+            continue
+
+        offset += 1
+
+        if length == 0:
+            break
+
+        labels.append(packet[offset:offset + length].decode("utf-8", errors="replace"))
+        offset += length
+
+    return ".".join(labels).lower(), offset if end is None else end
+
+def parse_mdns_response(packet, source):
+    """
+    Parse a mDNS response and get the announced updaters.
+
+    Args:
+        packet (bytes): mDNS response.
+        source (str): IP address of the responder, which is used if the response contains no address record.
+
+    Returns:
+        Dict[str, str]: IP address per instance name.
+    """
+    instances = []
+    targets = {}
+    addresses = {}
+    question_count, answer_count, authority_count, additional_count = struct.unpack_from(">4H", packet, 4)
+    offset = 12
+
+    for _ in range(question_count):
+        _, offset = read_name(packet, offset)
+        offset += 4
+
+    for _ in range(answer_count + authority_count + additional_count):
+        name, offset = read_name(packet, offset)
+        record_type, _, _, length = struct.unpack_from(">HHIH", packet, offset)
+        offset += 10
+
+        if record_type == DNS_TYPE_PTR and name == MDNS_SERVICE.lower():
+            instances.append(read_name(packet, offset)[0])
+        elif record_type == DNS_TYPE_SRV:
+            targets[name] = read_name(packet, offset + 6)[0]
+        elif record_type == DNS_TYPE_A and length == 4:
+            addresses[name] = socket.inet_ntoa(packet[offset:offset + 4])
+
+        offset += length
+
+    return {
+        instance: addresses.get(targets.get(instance), source)
+        for instance in instances
+    }
+
+def discover_mdns(timeout):
+    """
+    Discover the updaters in the local network via mDNS.
+
+    Args:
+        timeout (float): Discovery time in s.
+
+    Returns:
+        List[Device]: Discovered devices.
+    """
+    found = {}
+    query = struct.pack(">6H", 0, 0, 1, 0, 0, 0) + encode_name(MDNS_SERVICE) + struct.pack(">HH", DNS_TYPE_PTR, DNS_CLASS_IN_QU)
+    deadline = time.monotonic() + timeout
+    next_query = 0
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP) as sock:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+        sock.bind(("", 0))
+        sock.settimeout(0.2)
+
+        while time.monotonic() < deadline:
+            # The query is repeated, because mDNS uses UDP.
+            if time.monotonic() >= next_query:
+                sock.sendto(query, (MDNS_ADDRESS, MDNS_PORT))
+                next_query = time.monotonic() + (timeout / 3)
+
+            try:
+                packet, (source, _) = sock.recvfrom(9000)
+                found.update(parse_mdns_response(packet, source))
+            except socket.timeout:
+                pass
+            except (IndexError, ValueError, struct.error):
+                # Ignore malformed responses.
+                pass
+
+    return [Device(instance.split(".")[0], address, False) for instance, address in sorted(found.items())]
+
+def discover_serial(pattern):
+    """
+    Discover the updaters, which are attached via serial interface.
+
+    Args:
+        pattern (str): Serial port name pattern, e.g. "/dev/ttyUSB*".
+
+    Returns:
+        List[Device]: Devices of all matching serial ports.
+    """
+    from serial.tools import list_ports # pylint: disable=import-error,import-outside-toplevel
+
+    return [
+        Device(port.device, port.device, True)
+        for port in sorted(list_ports.comports(), key=lambda port: port.device)
+        if fnmatch.fnmatch(port.device, pattern)
+    ]
+
+def change_partition_http(host):
+    """
+    Switch to the application partition, which restarts the device.
+
+    Args:
+        host (str): Device IP address or hostname.
+
+    Returns:
+        bool: True if successful, otherwise False.
+    """
+    connection = http.client.HTTPConnection(host, timeout=TIMEOUT)
+
+    try:
+        connection.request("GET", "/change-partition")
+        response = connection.getresponse()
+        response.read()
+    finally:
+        connection.close()
+
+    return response.status == 200
+
+def change_partition_serial(port_name):
+    """
+    Switch to the application partition and restart the device via terminal.
+
+    Args:
+        port_name (str): Serial port name.
+
+    Returns:
+        bool: True if successful, otherwise False.
+    """
+    import serial # pylint: disable=import-error,import-outside-toplevel
+    import serial_upload # pylint: disable=import-outside-toplevel
+
+    is_successful = False
+
+    with serial.Serial(port_name, serial_upload.DEFAULT_BAUDRATE, timeout=serial_upload.ACK_TIMEOUT) as port:
+        port.reset_input_buffer()
+        port.write(b"\nactivate app\n")
+
+        if serial_upload.read_result(port, serial_upload.RESPONSE_TIMEOUT)[0]:
+            port.write(b"restart\n")
+            is_successful = serial_upload.read_result(port, serial_upload.RESPONSE_TIMEOUT)[0]
+
+    return is_successful
+
+def upload_binary(device, target, image, image_hash, attempt, progress):
+    """
+    Upload one binary to a device.
+
+    Args:
+        device (Device): Device
+        target (str): "firmware" or "filesystem".
+        image (bytes): Binary.
+        image_hash (str): Expected SHA-256 of the written image as hex string or None.
+        attempt (int): Number of the attempt, starting with 1.
+        progress (function): Called with the uploaded offset and the binary size.
+
+    Returns:
+        bool: True if successful, otherwise False.
+    """
+    if device.is_serial:
+        import serial_upload # pylint: disable=import-outside-toplevel
+
+        return serial_upload.upload(device.address, target, image, image_hash, serial_upload.DEFAULT_RETRIES, progress)
+
+    # A retry continues at the committed offset of the previous attempt.
+    return chunked_upload.upload(device.address, target, image, image_hash, chunked_upload.DEFAULT_CHUNK_SIZE,
+                                 chunked_upload.DEFAULT_RETRIES, attempt > 1, progress)
+
+def update_device(device, binaries, attempts, is_activated, progress):
+    """
+    Update a single device with all binaries and switch to the application.
+
+    Args:
+        device (Device): Device
+        binaries (List[Tuple[str, bytes, str]]): Target, binary and expected SHA-256 or None.
+        attempts (int): Max. number of attempts per binary and for the partition switch.
+        is_activated (bool): Switch to the application partition after the upload?
+        progress (FleetProgress): Fleet progress.
+
+    Returns:
+        bool: True if successful, otherwise False.
+    """
+    is_successful = True
+    base = 0
+
+    progress.set_state(device.name, "running")
+
+    for target, image, image_hash in binaries:
+        is_uploaded = False
+
+        for attempt in range(1, attempts + 1):
+            progress.begin_binary(device.name, base)
+
+            try:
+                is_uploaded = upload_binary(device, target, image, image_hash, attempt,
+                                            lambda offset, _: progress.update(device.name, offset))
+            except (OSError, http.client.HTTPException, ValueError) as error:
+                print(f"\n{device.name}: {error}", file=sys.stderr)
+
+            if is_uploaded:
+                break
+
+            time.sleep(RETRY_DELAY)
+
+        if not is_uploaded:
+            print(f"\n{device.name}: {target} upload failed after {attempts} attempts.", file=sys.stderr)
+            is_successful = False
+            break
+
+        base += len(image)
+
+    if is_successful and is_activated:
+        is_successful = False
+
+        for _ in range(attempts):
+            try:
+                if device.is_serial:
+                    is_successful = change_partition_serial(device.address)
+                else:
+                    is_successful = change_partition_http(device.address)
+            except (OSError, http.client.HTTPException) as error:
+                print(f"\n{device.name}: {error}", file=sys.stderr)
+
+            if is_successful:
+                break
+
+            time.sleep(RETRY_DELAY)
+
+        if not is_successful:
+            print(f"\n{device.name}: Partition switch failed.", file=sys.stderr)
+
+    progress.set_state(device.name, "finished" if is_successful else "failed")
+
+    return is_successful
+
+def show_progress(progress, stop_event):
+    """
+    Show the fleet progress periodically, until stopped.
+
+    Args:
+        progress (FleetProgress): Fleet progress.
+        stop_event (threading.Event): Set to stop.
+    """
+    while not stop_event.wait(PROGRESS_PERIOD):
+        print(f"\r{progress.get_line()}", end="", flush=True)
+
+    print(f"\r{progress.get_line()}")
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Update a fleet of PixelixUpdater devices in parallel.")
+    parser.add_argument("--mdns", action="store_true", help="Discover the devices via mDNS.")
+    parser.add_argument("--serial", nargs="?", const="*", metavar="PATTERN",
+                        help="Use all serial ports, which match the pattern, e.g. \"/dev/ttyUSB*\".")
+    parser.add_argument("--host", action="append", default=[], help="IP address or hostname of a device.")
+    parser.add_argument("--port", action="append", default=[], help="Serial port of a device.")
+    parser.add_argument("--firmware", help="Firmware binary, optional gzip compressed or delta patch.")
+    parser.add_argument("--filesystem", help="Filesystem binary, optional gzip compressed or delta patch.")
+    parser.add_argument("--jobs", type=int, default=DEFAULT_JOBS, help="Max. number of devices updated at once.")
+    parser.add_argument("--attempts", type=int, default=DEFAULT_ATTEMPTS, help="Attempts per binary and device.")
+    parser.add_argument("--discovery-timeout", type=float, default=DEFAULT_DISCOVERY_TIMEOUT,
+                        help="mDNS discovery time in s.")
+    parser.add_argument("--verify", action="store_true",
+                        help="Verify the SHA-256 of the binaries on the devices, only for uncompressed binaries.")
+    parser.add_argument("--no-activate", action="store_true", help="Don't switch to the application partition.")
+    parser.add_argument("--list", action="store_true", help="Only list the discovered devices.")
+    args = parser.parse_args()
+
+    devices = [Device(host, host, False) for host in args.host]
+    devices += [Device(port, port, True) for port in args.port]
+
+    if args.mdns:
+        devices += discover_mdns(args.discovery_timeout)
+
+    if args.serial is not None:
+        devices += discover_serial(args.serial)
+
+    for device in devices:
+        print(f"{device.name} ({device.address})")
+
+    print(f"{len(devices)} device(s).")
+
+    if args.list:
+        return 0
+
+    binaries = []
+
+    for target, file_name in (("firmware", args.firmware), ("filesystem", args.filesystem)):
+        if file_name is not None:
+            with open(file_name, "rb") as f:
+                image = f.read()
+
+            binaries.append((target, image, hashlib.sha256(image).hexdigest() if args.verify else None))
+
+    if not binaries:
+        parser.error("At least one binary is required.")
+
+    if not devices:
+        return 1
+
+    progress = FleetProgress(devices, sum(len(image) for _, image, _ in binaries))
+    stop_event = threading.Event()
+    progress_thread = threading.Thread(target=show_progress, args=(progress, stop_event))
+    start = time.monotonic()
+
+    progress_thread.start()
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, args.jobs)) as executor:
+        futures = {
+            executor.submit(update_device, device, binaries, args.attempts, not args.no_activate, progress): device
+            for device in devices
+        }
+        failed = [futures[future].name for future in concurrent.futures.as_completed(futures) if not future.result()]
+
+    stop_event.set()
+    progress_thread.join()
+
+    print(f"{len(devices) - len(failed)} of {len(devices)} device(s) updated in {time.monotonic() - start:.0f} s.")
+
+    for name in sorted(failed):
+        print(f"Failed: {name}", file=sys.stderr)
+
+    return 0 if not failed else 1
+
+################################################################################
+# Main
+################################################################################
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,5 +1,10 @@
 """
 This script merges factory.bin and firmware.bin into merged-firmware.bin before upload.
+
+With "custom_merge_sparse = yes" in the platformio.ini environment, no merged
+image is created. Instead, the populated regions are written as segment list
+merged-firmware.json with one binary per segment, which flash_factory.py writes
+without the erased-state padding between them.
 """
 
 # MIT License
@@ -30,6 +35,7 @@ This script merges factory.bin and firmware.bin into merged-firmware.bin before
 # Imports
 ################################################################################
 
+import json
 import os
 import sys
 Import("env")  # pylint: disable=undefined-variable
@@ -46,6 +52,15 @@ PLATFORM = env.PioPlatform() # pylint: disable=undefined-variable
 PROJECT_DIR = env.subst("$PROJECT_DIR") # pylint: disable=undefined-variable
 BUILD_DIR = env.subst("$BUILD_DIR") # pylint: disable=undefined-variable
 
+# Create a segment list instead of a merged image?
+IS_SPARSE = env.GetProjectOption("custom_merge_sparse", "no").lower() in ("yes", "true", "1") # pylint: disable=undefined-variable
+
+# Baud rate for flashing the segments, default is the upload speed of the board.
+FLASH_SPEED = env.GetProjectOption("custom_flash_speed", "") # pylint: disable=undefined-variable
+
+# Flash sector size in byte, which is the erase unit of esptool.
+SECTOR_SIZE = 4096
+
 ################################################################################
 # Classes
 ################################################################################
@@ -117,6 +132,72 @@ def show_section_info(sections):
     for sect_adr, sect_file in zip(offsets, files):
         print(f"{sect_adr.ljust(offset_width)} | {sect_file.ljust(file_width)}")
 
+def trim_erased(data):
+    """
+    Remove the trailing erased-state bytes (0xFF) of a segment. Only bytes in
+    the last sector, which is written anyway, are removed. Whole sectors are
+    kept, because esptool erases only the sectors it writes and their old
+    content would survive, e.g. an old otadata.
+
+    Args:
+        data: Segment data.
+
+    Returns:
+        bytes: Trimmed segment data.
+    """
+    populated_size = len(data.rstrip(b"\xff"))
+    populated_sectors = (populated_size + SECTOR_SIZE - 1) // SECTOR_SIZE
+    sectors = (len(data) + SECTOR_SIZE - 1) // SECTOR_SIZE
+
+    if populated_sectors == sectors:
+        data = data[:populated_size]
+
+    return data
+
+def create_segment_list(sections, chip, baud, segment_list):
+    """
+    Create the segment list and the trimmed binary of each segment.
+
+    Args:
+        sections: List of sections, each "<offset> <file>".
+        chip: Chip type for esptool.
+        baud: Baud rate for flashing.
+        segment_list: Path of the segment list.
+    """
+    segment_dir = os.path.splitext(segment_list)[0]
+    segments = []
+    image_size = 0
+    written_size = 0
+
+    os.makedirs(segment_dir, exist_ok=True)
+
+    for section in sections:
+        sect_adr, sect_file = section.split(" ", 1)
+
+        with open(sect_file, "rb") as f:
+            data = f.read()
+
+        trimmed = trim_erased(data)
+        segment_file = os.path.join(segment_dir, f"{sect_adr}.bin")
+
+        with open(segment_file, "wb") as f:
+            f.write(trimmed)
+
+        segments.append({
+            "offset": sect_adr,
+            "file": os.path.relpath(segment_file, os.path.dirname(segment_list)),
+            "size": len(trimmed)
+        })
+
+        image_size = max(image_size, int(sect_adr, 0) + len(data))
+        written_size += len(trimmed)
+
+    with open(segment_list, "w", encoding="utf-8") as f:
+        json.dump({"chip": chip, "baud": baud, "segments": segments}, f, indent=4)
+
+    print(f"Segment list: {segment_list}")
+    print(f"{written_size} bytes in {len(segments)} segments instead of a merged image with {image_size} bytes.")
+
 def merge_factory(target, source, env): # pylint: disable=unused-argument
     """
     Merge factor and application binaries into a single binary file.
@@ -135,6 +216,7 @@ def merge_factory(target, source, env): # pylint: disable=unused-argument
     factory_image = os.path.join(PROJECT_DIR, f"{FACTORY_PROGNAME}.bin")
     app_image = os.path.join(BUILD_DIR, f"{program_name}.bin")
     merged_image = os.path.join(BUILD_DIR, f"{MERGE_PROGNAME}.bin")
+    segment_list = os.path.join(BUILD_DIR, f"{MERGE_PROGNAME}.json")
 
     # Get offset for factory and application images from partition table.
     partition_table = get_partition_table(env)
@@ -164,7 +246,10 @@ def merge_factory(target, source, env): # pylint: disable=unused-argument
     tool_dir = PLATFORM.get_package_dir("tool-esptoolpy")
     esptool_path = os.path.join(tool_dir, "esptool.py")
 
-    if tool_dir is None:
+    if IS_SPARSE:
+        baud = int(FLASH_SPEED) if FLASH_SPEED != "" else int(env.BoardConfig().get("upload.speed"))
+        create_segment_list(sections, chip, baud, segment_list)
+    elif tool_dir is None:
         print("Package tool-esptoolpy could not be found!")
     else:
         # Find the esptool command description here:
@@ -226,5 +311,8 @@ def replace_firmware(target, source, env): # pylint: disable=unused-argument
 ################################################################################
 
 env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", merge_factory) # pylint: disable=undefined-variable
-env.AddPreAction("upload", change_progname)  # pylint: disable=undefined-variable
+
+# The segment list is flashed by flash_factory.py, the upload keeps the application image.
+if not IS_SPARSE:
+    env.AddPreAction("upload", change_progname)  # pylint: disable=undefined-variable
 #env.AddPreAction("upload", replace_firmware)
@@ -0,0 +1,297 @@
+"""
+This script uploads a firmware or filesystem binary to the PixelixUpdater
+via the serial interface. The binary is sent in CRC checked frames with a
+sliding window, see src/SerialUpload.h for the protocol.
+
+Usage: python serial_upload.py <port> firmware|filesystem <binary>
+"""
+
+# MIT License
+#
+# Copyright (c) 2019 - 2025 Andreas Merkle (web@blue-andi.de)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+################################################################################
+# Imports
+################################################################################
+
+import argparse
+import hashlib
+import struct
+import sys
+import time
+import zlib
+
+import serial # pylint: disable=import-error
+
+################################################################################
+# Variables
+################################################################################
+
+COMMANDS = {
+    "firmware": "upload fw",
+    "filesystem": "upload fs"
+}
+
+DEFAULT_BAUDRATE = 115200
+
+SYNC = 0xA5
+ACK = 0x06
+NAK = 0x15
+
+# Time in s the device needs to change the baudrate.
+BAUDRATE_SWITCH_DELAY = 0.1
+
+# Pause in s after a NAK, so the device drops the frames in flight.
+NAK_PAUSE = 0.1
+
+# Time in s to wait for an acknowledge, before the window is sent again.
+ACK_TIMEOUT = 1.0
+
+# Time in s to wait for a command response.
+RESPONSE_TIMEOUT = 10.0
+
+DEFAULT_RETRIES = 10
+
+################################################################################
+# Classes
+################################################################################
+
+################################################################################
+# Functions
+################################################################################
+
+def read_result(port, timeout):
+    """
+    Read the terminal response lines until "OK" or "ERR".
+
+    Args:
+        port: Serial port.
+        timeout: Timeout in s.
+
+    Returns:
+        Tuple[bool, List[str]]: Successful and all lines before "OK" or "ERR".
+    """
+    lines = []
+    deadline = time.monotonic() + timeout
+
+    while time.monotonic() < deadline:
+        line = port.readline().decode("utf-8", errors="replace").strip()
+
+        if line == "OK":
+            return True, lines
+        if line == "ERR":
+            return False, lines
+        if line:
+            lines.append(line)
+
+    return False, lines + ["Response timeout."]
+
+def make_frame(seq, payload):
+    """
+    Build a frame.
+
+    Args:
+        seq: Sequence number.
+        payload: Payload, which may be empty to end the upload.
+
+    Returns:
+        bytes: Frame
+    """
+    header = struct.pack("<HH", seq & 0xFFFF, len(payload))
+    crc = zlib.crc32(header + payload)
+
+    return bytes([SYNC]) + header + payload + struct.pack("<I", crc)
+
+def read_response(port):
+    """
+    Read an ACK or NAK response.
+
+    Args:
+        port: Serial port.
+
+    Returns:
+        Tuple[int, int]: Response type and expected sequence number or (None, None) on timeout.
+    """
+    data = b""
+
+    # Skip everything, which is not a response, e.g. log output.
+    while True:
+        byte = port.read(1)
+        if not byte:
+            return None, None
+        if byte[0] in (ACK, NAK):
+            data = port.read(2)
+            break
+
+    if len(data) != 2:
+        return None, None
+
+    return byte[0], struct.unpack("<H", data)[0]
+
+def print_progress(offset, size):
+    """
+    Print the upload progress in one line.
+
+    Args:
+        offset: Number of acknowledged bytes.
+        size: Size of the whole binary in byte.
+    """
+    print(f"\r{offset} / {size} bytes", end="", flush=True)
+
+def send_frames(port, image, block_size, window_size, retries, progress):
+    """
+    Send the binary in frames with a sliding window (go-back-N).
+
+    Args:
+        port: Serial port.
+        image: Binary.
+        block_size: Max. payload size in byte.
+        window_size: Max. number of unacknowledged frames.
+        retries: Number of timeouts in a row, before the upload is given up.
+        progress: Called with the acknowledged offset and the binary size or None.
+
+    Returns:
+        bool: True if all frames are acknowledged, otherwise False.
+    """
+    blocks = [image[offset:offset + block_size] for offset in range(0, len(image), block_size)]
+    blocks.append(b"") # End of upload
+    base = 0 # First unacknowledged frame
+    next_seq = 0
+    failures = 0
+
+    while base < len(blocks) and failures <= retries:
+        while next_seq < len(blocks) and next_seq < (base + window_size):
+            port.write(make_frame(next_seq, blocks[next_seq]))
+            next_seq += 1
+
+        response, expected = read_response(port)
+
+        if response is None:
+            # Send the whole window again.
+            failures += 1
+            next_seq = base
+            continue
+
+        # The 16-bit sequence number wraps, the window is much smaller.
+        acked = base + ((expected - base) & 0xFFFF)
+
+        if acked <= next_seq:
+            if acked > base:
+                failures = 0
+            base = acked
+
+        if response == NAK:
+            time.sleep(NAK_PAUSE)
+            port.reset_input_buffer()
+            next_seq = base
+
+        if progress is not None:
+            progress(min(base * block_size, len(image)), len(image))
+
+    if progress is print_progress:
+        print("")
+
+    return base >= len(blocks)
+
+def upload(port_name, target, image, image_hash, retries, progress=print_progress):
+    """
+    Upload the binary via the serial interface.
+
+    Args:
+        port_name: Serial port name, e.g. COM3 or /dev/ttyUSB0.
+        target: "firmware" or "filesystem".
+        image: Binary.
+        image_hash: Expected SHA-256 of the written image as hex string or None.
+        retries: Number of timeouts in a row, before the upload is given up.
+        progress: Called with the acknowledged offset and the binary size or None.
+
+    Returns:
+        bool: True if successful, otherwise False.
+    """
+    is_successful = False
+
+    with serial.Serial(port_name, DEFAULT_BAUDRATE, timeout=ACK_TIMEOUT) as port:
+        command = f"{COMMANDS[target]} {len(image)}"
+
+        if image_hash is not None:
+            command += f" {image_hash}"
+
+        # The leading line feed terminates any pending input.
+        port.reset_input_buffer()
+        port.write(f"\n{command}\n".encode("utf-8"))
+
+        is_started, lines = read_result(port, RESPONSE_TIMEOUT)
+
+        if not is_started:
+            print(f"{port_name}: Upload failed: {lines[-1] if lines else ''}", file=sys.stderr)
+        else:
+            # The last line contains the upload baudrate, the block size and the window size.
+            baudrate, block_size, window_size = (int(value) for value in lines[-1].split())
+
+            if baudrate != 0:
+                port.flush()
+                time.sleep(BAUDRATE_SWITCH_DELAY)
+                port.baudrate = baudrate
+
+            if send_frames(port, image, block_size, window_size, retries, progress):
+                is_successful, lines = read_result(port, RESPONSE_TIMEOUT)
+                print(f"{port_name}: {lines[-1] if lines else ''}")
+            else:
+                print(f"{port_name}: Upload failed: No response.", file=sys.stderr)
+
+            port.baudrate = DEFAULT_BAUDRATE
+
+    return is_successful
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Upload a binary to the PixelixUpdater via serial interface.")
+    parser.add_argument("port", help="Serial port, e.g. COM3 or /dev/ttyUSB0.")
+    parser.add_argument("target", choices=COMMANDS.keys(), help="Target partition.")
+    parser.add_argument("binary", help="Firmware or filesystem binary, optional gzip compressed or delta patch.")
+    parser.add_argument("--retries", type=int, default=DEFAULT_RETRIES, help="Timeouts in a row, before giving up.")
+    parser.add_argument("--sha256", help="Expected SHA-256 of the written image as hex string.")
+    parser.add_argument("--verify", action="store_true",
+                        help="Verify the SHA-256 of the binary on the device, only for uncompressed binaries.")
+    args = parser.parse_args()
+
+    with open(args.binary, "rb") as f:
+        image = f.read()
+
+    image_hash = args.sha256
+    if args.verify:
+        image_hash = hashlib.sha256(image).hexdigest()
+
+    is_successful = upload(args.port, args.target, image, image_hash, args.retries)
+
+    return 0 if is_successful else 1
+
+################################################################################
+# Main
+################################################################################
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,293 @@
+"""
+This script uploads a firmware or filesystem binary to the PixelixUpdater.
+The binary is sent in chunks, which are verified by the device. If the
+connection breaks, the upload is resumed at the last committed chunk.
+
+Usage: python upload.py <ip-address> firmware|filesystem <binary>
+"""
+
+# MIT License
+#
+# Copyright (c) 2019 - 2025 Andreas Merkle (web@blue-andi.de)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+################################################################################
+# Imports
+################################################################################
+
+import argparse
+import hashlib
+import http.client
+import json
+import sys
+import time
+import zlib
+
+################################################################################
+# Variables
+################################################################################
+
+SIZE_HEADERS = {
+    "firmware": "X-File-Size-Firmware",
+    "filesystem": "X-File-Size-Filesystem"
+}
+
+# Must not exceed CHUNK_MAX_SIZE of the device.
+DEFAULT_CHUNK_SIZE = 16384
+
+DEFAULT_RETRIES = 10
+
+RETRY_DELAY = 2 # s
+
+TIMEOUT = 30 # s
+
+# Partition of the target in the partition info.
+PARTITION_INFO_KEYS = {
+    "firmware": "app0",
+    "filesystem": "filesystem"
+}
+
+################################################################################
+# Classes
+################################################################################
+
+################################################################################
+# Functions
+################################################################################
+
+def get_upload_status(host):
+    """
+    Get the status of the chunked upload.
+
+    Args:
+        host: Device IP address or hostname.
+
+    Returns:
+        Dict: Upload status with state, target, offset and size.
+    """
+    connection = http.client.HTTPConnection(host, timeout=TIMEOUT)
+
+    try:
+        connection.request("GET", "/upload-status")
+        response = connection.getresponse()
+        status = json.loads(response.read().decode("utf-8"))
+    finally:
+        connection.close()
+
+    return status
+
+def get_partition_info(host):
+    """
+    Get the partition information with the hashes of the installed images.
+
+    Args:
+        host: Device IP address or hostname.
+
+    Returns:
+        Dict: Partition information.
+    """
+    connection = http.client.HTTPConnection(host, timeout=TIMEOUT)
+
+    try:
+        connection.request("GET", "/partition-info")
+        response = connection.getresponse()
+        info = json.loads(response.read().decode("utf-8"))
+    finally:
+        connection.close()
+
+    return info
+
+def is_installed(host, target, image_hash):
+    """
+    Check whether the image is already installed on the device.
+
+    Args:
+        host: Device IP address or hostname.
+        target: "firmware" or "filesystem".
+        image_hash: SHA-256 of the image as hex string.
+
+    Returns:
+        bool: True if the installed image has the same hash, otherwise False.
+    """
+    partition = get_partition_info(host).get(PARTITION_INFO_KEYS[target])
+
+    return partition is not None and partition.get("sha256") == image_hash.lower()
+
+def send_chunk(host, target, image_size, offset, chunk, image_hash):
+    """
+    Send one chunk to the device.
+
+    Args:
+        host: Device IP address or hostname.
+        target: "firmware" or "filesystem".
+        image_size: Size of the whole binary in byte.
+        offset: Chunk offset in byte.
+        chunk: Chunk data.
+        image_hash: Expected SHA-256 of the written image as hex string or None.
+
+    Returns:
+        Tuple[int, int, str]: HTTP status, committed offset and response message.
+    """
+    headers = {
+        "Content-Type": "application/octet-stream",
+        SIZE_HEADERS[target]: str(image_size),
+        "X-Chunk-Offset": str(offset),
+        "X-Chunk-CRC32": f"{zlib.crc32(chunk):08x}"
+    }
+
+    if image_hash is not None:
+        headers["X-Image-SHA256"] = image_hash
+
+    connection = http.client.HTTPConnection(host, timeout=TIMEOUT)
+
+    try:
+        connection.request("PUT", f"/{target}", body=chunk, headers=headers)
+        response = connection.getresponse()
+        message = response.read().decode("utf-8", errors="replace")
+        committed = int(response.getheader("X-Upload-Offset", "0"))
+    finally:
+        connection.close()
+
+    return response.status, committed, message
+
+def print_progress(offset, size):
+    """
+    Print the upload progress in one line.
+
+    Args:
+        offset: Number of committed bytes.
+        size: Size of the whole binary in byte.
+    """
+    print(f"\r{offset} / {size} bytes", end="", flush=True)
+
+def upload(host, target, image, image_hash, chunk_size, retries, resume, progress=print_progress):
+    """
+    Upload the binary in chunks and resume after connection errors.
+
+    Args:
+        host: Device IP address or hostname.
+        target: "firmware" or "filesystem".
+        image: Binary.
+        image_hash: Expected SHA-256 of the written image as hex string or None.
+        chunk_size: Chunk size in byte.
+        retries: Number of retries in a row, before the upload is given up.
+        resume: Continue a pending upload of a previous run.
+        progress: Called with the committed offset and the binary size after every chunk or None.
+
+    Returns:
+        bool: True if successful, otherwise False.
+    """
+    offset = 0
+    failures = 0
+    is_finished = False
+
+    if resume:
+        status = get_upload_status(host)
+        if status["state"] == "running" and status["target"] == target and status["size"] == len(image):
+            offset = status["offset"]
+            print(f"Resuming at offset {offset}.")
+
+    while not is_finished and failures <= retries:
+        chunk = image[offset:offset + chunk_size]
+
+        try:
+            http_status, committed, message = send_chunk(host, target, len(image), offset, chunk, image_hash)
+        except (OSError, http.client.HTTPException) as error:
+            failures += 1
+            print(f"{host}: Chunk at offset {offset} failed: {error}", file=sys.stderr)
+            time.sleep(RETRY_DELAY)
+
+            # Ask the device, what was committed before the connection broke.
+            try:
+                status = get_upload_status(host)
+                if status["state"] == "running":
+                    offset = status["offset"]
+            except (OSError, http.client.HTTPException, ValueError):
+                pass
+            continue
+
+        if http_status == 200:
+            failures = 0
+            offset = committed
+            is_finished = offset >= len(image)
+            if progress is not None:
+                progress(offset, len(image))
+        elif http_status in (400, 409) and committed > 0:
+            # Wrong offset or corrupted chunk, continue at the committed offset.
+            failures += 1
+            offset = committed
+        else:
+            print(f"\n{host}: Upload failed: {message}", file=sys.stderr)
+            break
+
+    if progress is print_progress:
+        print("")
+
+    return is_finished
+
+def main():
+    """
+    Main entry point.
+
+    Returns:
+        int: Exit code.
+    """
+    parser = argparse.ArgumentParser(description="Upload a binary to the PixelixUpdater in resumable chunks.")
+    parser.add_argument("host", help="IP address or hostname of the device.")
+    parser.add_argument("target", choices=SIZE_HEADERS.keys(), help="Target partition.")
+    parser.add_argument("binary", help="Firmware or filesystem binary, optional gzip compressed or delta patch.")
+    parser.add_argument("--chunk-size", type=int, default=DEFAULT_CHUNK_SIZE, help="Chunk size in byte.")
+    parser.add_argument("--retries", type=int, default=DEFAULT_RETRIES, help="Retries per chunk.")
+    parser.add_argument("--sha256", help="Expected SHA-256 of the written image as hex string.")
+    parser.add_argument("--verify", action="store_true",
+                        help="Verify the SHA-256 of the binary on the device, only for uncompressed binaries.")
+    parser.add_argument("--resume", action="store_true", help="Continue a pending upload of a previous run.")
+    parser.add_argument("--skip-current", action="store_true",
+                        help="Skip the upload, if the image is already installed. Requires --sha256 or --verify.")
+    args = parser.parse_args()
+
+    with open(args.binary, "rb") as f:
+        image = f.read()
+
+    image_hash = args.sha256
+    if args.verify:
+        image_hash = hashlib.sha256(image).hexdigest()
+
+    if args.skip_current and image_hash is None:
+        print("--skip-current requires --sha256 or --verify.", file=sys.stderr)
+        return 1
+
+    if args.skip_current and is_installed(args.host, args.target, image_hash):
+        print("Image is already installed, upload skipped.")
+        return 0
+
+    is_successful = upload(args.host, args.target, image, image_hash, args.chunk_size, args.retries, args.resume)
+
+    if is_successful:
+        print("Upload successful.")
+
+    return 0 if is_successful else 1
+
+################################################################################
+# Main
+################################################################################
+
+if __name__ == "__main__":
+    sys.exit(main())
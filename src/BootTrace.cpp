@@ -0,0 +1,147 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   BootTrace.cpp
+ * @brief  Boot to ready latency tracing
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "BootTrace.h"
+#include <inttypes.h>
+
+#include <esp_timer.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/**
+ * A recorded event.
+ */
+typedef struct
+{
+    uint32_t    timestamp; /**< Time since boot in us */
+    const char* event;     /**< Event description */
+
+} TraceEvent;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/** Recorded events. */
+static TraceEvent        gEvents[BootTrace::MAX_EVENTS];
+
+/** Number of recorded events. It is incremented after the event is written. */
+static volatile size_t   gEventCount   = 0U;
+
+/** Number of events, which were not recorded, because the trace was full. */
+static volatile uint32_t gDroppedCount = 0U;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+void BootTrace::mark(const char* event)
+{
+    if (MAX_EVENTS > gEventCount)
+    {
+        gEvents[gEventCount].timestamp = static_cast<uint32_t>(esp_timer_get_time());
+        gEvents[gEventCount].event     = event;
+        ++gEventCount;
+    }
+    else
+    {
+        ++gDroppedCount;
+    }
+}
+
+void BootTrace::getTrace(String& text)
+{
+    size_t   count    = gEventCount;
+    uint32_t previous = 0U;
+    size_t   idx      = 0U;
+
+    text.clear();
+    (void)text.reserve(count * 48U);
+
+    text += "     time [ms]     delta [ms]  event\n";
+
+    for (idx = 0U; count > idx; ++idx)
+    {
+        char           line[64];
+        const uint32_t timestamp = gEvents[idx].timestamp;
+        const uint32_t delta     = timestamp - previous;
+
+        (void)snprintf(line, sizeof(line), "%10" PRIu32 ".%03" PRIu32 "  %10" PRIu32 ".%03" PRIu32 "  ",
+            timestamp / 1000U, timestamp % 1000U,
+            delta / 1000U, delta % 1000U);
+
+        text += line;
+        text += gEvents[idx].event;
+        text += "\n";
+
+        previous = timestamp;
+    }
+
+    if (0U < gDroppedCount)
+    {
+        text += gDroppedCount;
+        text += " events dropped.\n";
+    }
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
@@ -0,0 +1,96 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   BootTrace.h
+ * @brief  Boot to ready latency tracing
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The boot trace records the timestamps of the startup phases and the state
+ * transitions, beginning with the restart. It shows, where the time until
+ * the web server answers is spent.
+ *
+ * Only the first MAX_EVENTS events are recorded, the later ones are counted
+ * as dropped. Events shall be marked by the loop() task only, the trace can
+ * be read by any task.
+ */
+namespace BootTrace
+{
+    /** Max. number of recorded events. */
+    static const size_t MAX_EVENTS = 32U;
+
+    /**
+     * Mark an event with the current time since boot.
+     *
+     * @param[in] event Event description, which must be a string literal.
+     */
+    void mark(const char* event);
+
+    /**
+     * Get the trace as text. Every line contains the time since boot, the
+     * time since the previous event and the event.
+     *
+     * @param[out] text Trace
+     */
+    void getTrace(String& text);
+
+} /* namespace BootTrace */
+
+#endif /* BOOT_TRACE_H */
+
+/** @} */
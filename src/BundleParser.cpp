@@ -0,0 +1,355 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   BundleParser.cpp
+ * @brief  Splits a firmware and filesystem bundle into its images
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "BundleParser.h"
+#include <string.h>
+#include <algorithm>
+#include <Update.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+
+#include "OtaWriter.h"
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char    LOG_TAG[]      = "BundleParser";
+
+/** Bundle magic bytes. */
+static const uint8_t BUNDLE_MAGIC[] = { 'P', 'X', 'B', '1' };
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+bool BundleParser::begin(size_t bundleSize, OutputFunc output)
+{
+    bool isSuccessful = false;
+
+    if ((nullptr != output) && (false == isRunning()))
+    {
+        m_output                = output;
+        m_state                 = STATE_HEADER;
+        m_headerSize            = 0U;
+        m_bundleSize            = bundleSize;
+        m_segmentCount          = 0U;
+        m_segmentIdx            = 0U;
+        m_segmentRemaining      = 0U;
+        m_isActivationRequested = false;
+        m_errorString           = nullptr;
+        isSuccessful            = true;
+    }
+
+    return isSuccessful;
+}
+
+bool BundleParser::write(const uint8_t* data, size_t size)
+{
+    bool   isSuccessful = (nullptr != data) && (STATE_IDLE != m_state) && (STATE_ERROR != m_state);
+    size_t offset       = 0U;
+
+    while ((size > offset) && (true == isSuccessful))
+    {
+        switch (m_state)
+        {
+        case STATE_HEADER:
+            if (true == collectHeader(data, size, offset, HEADER_SIZE))
+            {
+                isSuccessful = handleHeader();
+                m_state      = STATE_TABLE;
+            }
+            break;
+
+        case STATE_TABLE:
+            if (true == collectHeader(data, size, offset, getHeaderSize()))
+            {
+                isSuccessful = handleTable();
+            }
+            break;
+
+        case STATE_SEGMENT:
+            isSuccessful = handleSegmentData(data, size, offset);
+            break;
+
+        case STATE_DONE:
+            ESP_LOGE(LOG_TAG, "Unexpected data after the end of the bundle.");
+            m_errorString = "Bundle too large";
+            isSuccessful  = false;
+            break;
+
+        default:
+            isSuccessful = false;
+            break;
+        }
+    }
+
+    if (false == isSuccessful)
+    {
+        if (STATE_SEGMENT == m_state)
+        {
+            OtaWriter::abort();
+        }
+
+        m_state = STATE_ERROR;
+    }
+
+    return isSuccessful;
+}
+
+bool BundleParser::end()
+{
+    bool isSuccessful = (STATE_DONE == m_state);
+
+    if ((false == isSuccessful) && (STATE_ERROR != m_state))
+    {
+        ESP_LOGE(LOG_TAG, "Bundle incomplete, %u of %u segments written.", m_segmentIdx, m_segmentCount);
+        m_errorString = "Bundle incomplete";
+    }
+
+    abort();
+
+    return isSuccessful;
+}
+
+void BundleParser::abort()
+{
+    /* Only the image write of an incomplete segment is pending. */
+    if (STATE_SEGMENT == m_state)
+    {
+        OtaWriter::abort();
+    }
+
+    m_output = nullptr;
+    m_state  = STATE_IDLE;
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+bool BundleParser::collectHeader(const uint8_t* data, size_t size, size_t& offset, size_t total)
+{
+    size_t chunkSize = std::min(total - m_headerSize, size - offset);
+
+    memcpy(&m_header[m_headerSize], &data[offset], chunkSize);
+    m_headerSize += chunkSize;
+    offset       += chunkSize;
+
+    return (total == m_headerSize);
+}
+
+bool BundleParser::handleHeader()
+{
+    bool isSuccessful = false;
+
+    m_segmentCount    = m_header[4U];
+
+    if (0 != memcmp(m_header, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)))
+    {
+        ESP_LOGE(LOG_TAG, "No bundle.");
+        m_errorString = "No bundle";
+    }
+    else if ((0U == m_segmentCount) || (MAX_SEGMENTS < m_segmentCount))
+    {
+        ESP_LOGE(LOG_TAG, "Invalid number of segments: %u", m_segmentCount);
+        m_errorString = "Invalid bundle header";
+    }
+    else
+    {
+        m_isActivationRequested = (0U != (m_header[5U] & FLAG_ACTIVATE));
+        isSuccessful            = true;
+    }
+
+    return isSuccessful;
+}
+
+bool BundleParser::handleTable()
+{
+    bool   isSuccessful = false;
+    size_t tableEnd     = getHeaderSize() - CRC_SIZE;
+    size_t totalSize    = getHeaderSize();
+    bool   isValid      = (getHeaderValue(tableEnd) == esp_rom_crc32_le(0U, m_header, tableEnd));
+    size_t idx          = 0U;
+
+    for (idx = 0U; (m_segmentCount > idx) && (true == isValid); ++idx)
+    {
+        size_t  entry  = HEADER_SIZE + (idx * ENTRY_SIZE);
+        uint8_t target = m_header[entry];
+        size_t  size   = getHeaderValue(entry + 4U);
+
+        isValid        = ((TARGET_FIRMWARE == target) || (TARGET_FILESYSTEM == target)) && (0U < size);
+        totalSize     += size;
+    }
+
+    if (false == isValid)
+    {
+        ESP_LOGE(LOG_TAG, "Invalid segment table.");
+        m_errorString = "Invalid bundle header";
+    }
+    else if ((0U != m_bundleSize) && (m_bundleSize != totalSize))
+    {
+        ESP_LOGE(LOG_TAG, "Bundle size %u, expected %u.", m_bundleSize, totalSize);
+        m_errorString = "Bundle size mismatch";
+    }
+    else
+    {
+        m_segmentIdx = 0U;
+        isSuccessful = beginSegment();
+    }
+
+    return isSuccessful;
+}
+
+bool BundleParser::beginSegment()
+{
+    static const uint8_t NO_HASH[HASH_SIZE] = { 0U };
+    bool                 isSuccessful       = false;
+    size_t               entry              = HEADER_SIZE + (m_segmentIdx * ENTRY_SIZE);
+    bool                 isFilesystem       = (TARGET_FILESYSTEM == m_header[entry]);
+    size_t               size               = getHeaderValue(entry + 4U);
+    const uint8_t*       hash               = &m_header[entry + 8U];
+
+    if (false == OtaWriter::begin(size, (true == isFilesystem) ? U_SPIFFS : U_FLASH))
+    {
+        m_errorString = "Failed to begin segment";
+    }
+    /* An all zero hash means, the segment is not verified. */
+    else if ((0 != memcmp(hash, NO_HASH, HASH_SIZE)) && (false == OtaWriter::setExpectedHash(hash)))
+    {
+        OtaWriter::abort();
+        m_errorString = "Invalid segment hash";
+    }
+    else
+    {
+        ESP_LOGI(LOG_TAG, "Segment %u: %s, %u bytes", m_segmentIdx, (true == isFilesystem) ? "filesystem" : "firmware", size);
+
+        m_segmentRemaining = size;
+        m_state            = STATE_SEGMENT;
+        isSuccessful       = true;
+    }
+
+    return isSuccessful;
+}
+
+bool BundleParser::handleSegmentData(const uint8_t* data, size_t size, size_t& offset)
+{
+    bool   isSuccessful = false;
+    size_t chunkSize    = std::min(m_segmentRemaining, size - offset);
+
+    if (false == m_output(&data[offset], chunkSize))
+    {
+        m_errorString = "Failed to write segment";
+    }
+    else
+    {
+        offset             += chunkSize;
+        m_segmentRemaining -= chunkSize;
+        isSuccessful        = true;
+
+        if (0U == m_segmentRemaining)
+        {
+            /* The next segment needs the OTA writer, therefore the current one is finished first. */
+            m_state = STATE_IDLE;
+
+            if (false == OtaWriter::end())
+            {
+                ESP_LOGE(LOG_TAG, "Segment %u failed: %s", m_segmentIdx, OtaWriter::getErrorString());
+                m_errorString = "Failed to end segment";
+                isSuccessful  = false;
+            }
+            else
+            {
+                ++m_segmentIdx;
+
+                if (m_segmentCount > m_segmentIdx)
+                {
+                    isSuccessful = beginSegment();
+                }
+                else
+                {
+                    ESP_LOGI(LOG_TAG, "All %u segments written.", m_segmentCount);
+                    m_state = STATE_DONE;
+                }
+            }
+        }
+    }
+
+    return isSuccessful;
+}
+
+uint32_t BundleParser::getHeaderValue(size_t offset) const
+{
+    uint32_t value = 0U;
+    size_t   idx   = 0U;
+
+    for (idx = 0U; sizeof(uint32_t) > idx; ++idx)
+    {
+        value |= static_cast<uint32_t>(m_header[offset + idx]) << (idx * 8U);
+    }
+
+    return value;
+}
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
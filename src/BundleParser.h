@@ -0,0 +1,308 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   BundleParser.h
+ * @brief  Splits a firmware and filesystem bundle into its images
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef BUNDLE_PARSER_H
+#define BUNDLE_PARSER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Splits a streamed bundle into its segments and writes each with the OTA
+ * writer to its target partition. Therefore a segment may be a compressed
+ * image or a delta patch too.
+ *
+ * The bundle is created by script/create_bundle.py and has the following
+ * format, all numbers are little endian:
+ *
+ * Header:
+ *   - 4 byte magic "PXB1"
+ *   - 1 byte number of segments
+ *   - 1 byte flags, bit 0: switch to app0 and restart after the bundle is written.
+ *   - 2 byte reserved
+ *
+ * Followed by the segment table, each entry with:
+ *   - 1 byte target, 0: firmware, 1: filesystem
+ *   - 3 byte reserved
+ *   - 4 byte segment size
+ *   - 32 byte SHA-256 of the written image, all zero if not verified.
+ *
+ * Followed by the CRC32 of the header and the segment table and then by the
+ * segments in the order of the table.
+ */
+class BundleParser
+{
+public:
+
+    /** Max. number of segments in a bundle. */
+    static const size_t MAX_SEGMENTS = 4U;
+
+    /**
+     * Output function, which receives the segment data.
+     *
+     * @param[in] data  Segment data
+     * @param[in] size  Segment data size in byte
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    typedef bool (*OutputFunc)(const uint8_t* data, size_t size);
+
+    /**
+     * Constructs the bundle parser.
+     */
+    BundleParser() :
+        m_output(nullptr),
+        m_state(STATE_IDLE),
+        m_header(),
+        m_headerSize(0U),
+        m_bundleSize(0U),
+        m_segmentCount(0U),
+        m_segmentIdx(0U),
+        m_segmentRemaining(0U),
+        m_isActivationRequested(false),
+        m_errorString(nullptr)
+    {
+    }
+
+    /**
+     * Destroys the bundle parser.
+     */
+    ~BundleParser()
+    {
+    }
+
+    /**
+     * Begin parsing a bundle.
+     *
+     * @param[in] bundleSize    Bundle size in byte or 0 if unknown.
+     * @param[in] output        Output function, which receives the segment data.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool begin(size_t bundleSize, OutputFunc output);
+
+    /**
+     * Parse the next bundle data.
+     *
+     * @param[in] data  Bundle data
+     * @param[in] size  Bundle data size in byte
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool write(const uint8_t* data, size_t size);
+
+    /**
+     * Finish parsing the bundle.
+     *
+     * @return If all segments are completely written, it will return true otherwise false.
+     */
+    bool end();
+
+    /**
+     * Abort parsing the bundle. The image write of the current segment is aborted.
+     */
+    void abort();
+
+    /**
+     * Is a bundle parsed?
+     *
+     * @return If parsing, it will return true otherwise false.
+     */
+    bool isRunning() const
+    {
+        return (STATE_IDLE != m_state);
+    }
+
+    /**
+     * Shall app0 be activated, after the bundle is written?
+     *
+     * @return If requested, it will return true otherwise false.
+     */
+    bool isActivationRequested() const
+    {
+        return m_isActivationRequested;
+    }
+
+    /**
+     * Get the error description of the last failed bundle.
+     *
+     * @return Error description or nullptr
+     */
+    const char* getErrorString() const
+    {
+        return m_errorString;
+    }
+
+private:
+
+    /**
+     * Bundle parser states.
+     */
+    enum State
+    {
+        STATE_IDLE = 0,      /**< Not started */
+        STATE_HEADER,        /**< Parsing the bundle header */
+        STATE_TABLE,         /**< Parsing the segment table */
+        STATE_SEGMENT,       /**< Writing segment data */
+        STATE_DONE,          /**< All segments written */
+        STATE_ERROR          /**< Invalid bundle or write failed */
+    };
+
+    /** Bundle header size in byte. */
+    static const size_t  HEADER_SIZE       = 8U;
+
+    /** Segment table entry size in byte. */
+    static const size_t  ENTRY_SIZE        = 40U;
+
+    /** CRC32 size in byte. */
+    static const size_t  CRC_SIZE          = 4U;
+
+    /** SHA-256 size in byte. */
+    static const size_t  HASH_SIZE         = 32U;
+
+    /** Max. size of the header, the segment table and its CRC in byte. */
+    static const size_t  HEADER_MAX_SIZE   = HEADER_SIZE + (MAX_SEGMENTS * ENTRY_SIZE) + CRC_SIZE;
+
+    /** Flag: Switch to app0 and restart after the bundle is written. */
+    static const uint8_t FLAG_ACTIVATE     = 0x01U;
+
+    /** Segment target: firmware */
+    static const uint8_t TARGET_FIRMWARE   = 0U;
+
+    /** Segment target: filesystem */
+    static const uint8_t TARGET_FILESYSTEM = 1U;
+
+    OutputFunc  m_output;                    /**< Output function for the segment data */
+    State       m_state;                     /**< Parser state */
+    uint8_t     m_header[HEADER_MAX_SIZE];   /**< Header, segment table and its CRC */
+    size_t      m_headerSize;                /**< Number of received header bytes */
+    size_t      m_bundleSize;                /**< Bundle size in byte or 0 if unknown */
+    size_t      m_segmentCount;              /**< Number of segments */
+    size_t      m_segmentIdx;                /**< Index of the current segment */
+    size_t      m_segmentRemaining;          /**< Remaining bytes of the current segment */
+    bool        m_isActivationRequested;     /**< Shall app0 be activated after the bundle? */
+    const char* m_errorString;               /**< Error description */
+
+    /* An instance shall not be copied. */
+    BundleParser(const BundleParser& parser);
+    BundleParser& operator=(const BundleParser& parser);
+
+    /**
+     * Collect header bytes.
+     *
+     * @param[in]       data    Bundle data
+     * @param[in]       size    Bundle data size in byte
+     * @param[in,out]   offset  Offset in the bundle data
+     * @param[in]       total   Number of header bytes, which shall be collected in total.
+     *
+     * @return If the header bytes are complete, it will return true otherwise false.
+     */
+    bool collectHeader(const uint8_t* data, size_t size, size_t& offset, size_t total);
+
+    /**
+     * Handle the complete bundle header.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool handleHeader();
+
+    /**
+     * Handle the complete segment table.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool handleTable();
+
+    /**
+     * Begin writing the current segment.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool beginSegment();
+
+    /**
+     * Pass segment data to the output and finish the segment, if complete.
+     *
+     * @param[in]       data    Bundle data
+     * @param[in]       size    Bundle data size in byte
+     * @param[in,out]   offset  Offset in the bundle data
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool handleSegmentData(const uint8_t* data, size_t size, size_t& offset);
+
+    /**
+     * Get the size of the header, the segment table and its CRC.
+     *
+     * @return Size in byte
+     */
+    size_t getHeaderSize() const
+    {
+        return HEADER_SIZE + (m_segmentCount * ENTRY_SIZE) + CRC_SIZE;
+    }
+
+    /**
+     * Get a little endian 32-bit value from the header.
+     *
+     * @param[in] offset    Offset in the header
+     *
+     * @return Value
+     */
+    uint32_t getHeaderValue(size_t offset) const;
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif /* BUNDLE_PARSER_H */
+
+/** @} */
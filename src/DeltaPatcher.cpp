@@ -0,0 +1,356 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   DeltaPatcher.cpp
+ * @brief  Streaming in-place binary delta patcher
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "DeltaPatcher.h"
+#include <string.h>
+#include <algorithm>
+
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char    LOG_TAG[]     = "DeltaPatcher";
+
+/** Patch magic bytes. */
+static const uint8_t PATCH_MAGIC[] = { 'P', 'X', 'D', '1' };
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+bool DeltaPatcher::isPatch(const uint8_t* data, size_t size)
+{
+    return (nullptr != data) && (sizeof(PATCH_MAGIC) <= size) && (0 == memcmp(data, PATCH_MAGIC, sizeof(PATCH_MAGIC)));
+}
+
+bool DeltaPatcher::begin(PartitionWriter* writer)
+{
+    bool isSuccessful = false;
+
+    if ((nullptr != writer) && (true == writer->isRunning()) && (0U == writer->getWrittenSize()))
+    {
+        m_writer     = writer;
+        m_state      = STATE_HEADER;
+        m_headerSize = 0U;
+        m_sourceSize = 0U;
+        m_targetSize = 0U;
+        m_outputSize = 0U;
+        isSuccessful = true;
+    }
+
+    return isSuccessful;
+}
+
+bool DeltaPatcher::write(const uint8_t* data, size_t size)
+{
+    bool   isSuccessful = (nullptr != data) && (STATE_IDLE != m_state) && (STATE_ERROR != m_state);
+    size_t offset       = 0U;
+
+    while ((size > offset) && (true == isSuccessful))
+    {
+        switch (m_state)
+        {
+        case STATE_HEADER:
+            if (true == collectHeader(data, size, offset, HEADER_SIZE))
+            {
+                isSuccessful = handleHeader();
+                m_headerSize = 0U;
+                m_state      = STATE_OP_HEADER;
+            }
+            break;
+
+        case STATE_OP_HEADER:
+            if (true == collectHeader(data, size, offset, OP_HEADER_SIZE))
+            {
+                m_headerSize = 0U;
+                isSuccessful = handleOpHeader();
+            }
+            break;
+
+        case STATE_OP_DATA:
+            isSuccessful = handleOpData(data, size, offset);
+            break;
+
+        case STATE_DONE:
+            ESP_LOGE(LOG_TAG, "Unexpected data after the end of the patch.");
+            isSuccessful = false;
+            break;
+
+        default:
+            isSuccessful = false;
+            break;
+        }
+    }
+
+    if (false == isSuccessful)
+    {
+        m_state = STATE_ERROR;
+    }
+
+    return isSuccessful;
+}
+
+bool DeltaPatcher::end()
+{
+    bool isSuccessful = (STATE_DONE == m_state);
+
+    if ((false == isSuccessful) && (STATE_ERROR != m_state))
+    {
+        ESP_LOGE(LOG_TAG, "Patch incomplete, %u of %u bytes produced.", m_outputSize, m_targetSize);
+    }
+
+    m_writer = nullptr;
+    m_state  = STATE_IDLE;
+
+    return isSuccessful;
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+bool DeltaPatcher::collectHeader(const uint8_t* data, size_t size, size_t& offset, size_t total)
+{
+    size_t chunkSize = std::min(total - m_headerSize, size - offset);
+
+    memcpy(&m_header[m_headerSize], &data[offset], chunkSize);
+    m_headerSize += chunkSize;
+    offset       += chunkSize;
+
+    return (total == m_headerSize);
+}
+
+bool DeltaPatcher::handleHeader()
+{
+    bool                   isSuccessful  = false;
+    const esp_partition_t* partition     = m_writer->getPartition();
+    uint32_t               sourceCrc     = getHeaderValue(8U);
+    size_t                 windowSectors = getHeaderValue(16U);
+
+    m_sourceSize                         = getHeaderValue(4U);
+    m_targetSize                         = getHeaderValue(12U);
+
+    if ((0U == m_targetSize) ||
+        (partition->size < m_sourceSize) ||
+        (partition->size < m_targetSize) ||
+        (MAX_WINDOW_SECTORS < windowSectors))
+    {
+        ESP_LOGE(LOG_TAG, "Invalid patch header.");
+    }
+    else
+    {
+        uint32_t crc    = 0U;
+        size_t   offset = 0U;
+
+        isSuccessful    = true;
+
+        /* The patch is only applicable to the image it was created for. */
+        while ((m_sourceSize > offset) && (true == isSuccessful))
+        {
+            size_t chunkSize = std::min(BUFFER_SIZE, m_sourceSize - offset);
+
+            isSuccessful     = m_writer->readOriginal(offset, m_buffer, chunkSize);
+            crc              = esp_rom_crc32_le(crc, m_buffer, chunkSize);
+            offset          += chunkSize;
+        }
+
+        if (false == isSuccessful)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to read the installed image.");
+        }
+        else if (sourceCrc != crc)
+        {
+            ESP_LOGE(LOG_TAG, "Patch doesn't match the image in '%s'.", partition->label);
+            isSuccessful = false;
+        }
+        else if ((false == m_writer->enableBackup(windowSectors)) ||
+                 (false == m_writer->setImageSize(m_targetSize)))
+        {
+            isSuccessful = false;
+        }
+        else
+        {
+            ESP_LOGI(LOG_TAG, "Patching %u bytes to %u bytes.", m_sourceSize, m_targetSize);
+        }
+    }
+
+    return isSuccessful;
+}
+
+bool DeltaPatcher::handleOpHeader()
+{
+    bool isSuccessful = false;
+
+    m_opType          = m_header[0];
+    m_opOffset        = getHeaderValue(1U);
+    m_opLength        = getHeaderValue(5U);
+
+    if ((0U == m_opLength) || ((m_targetSize - m_outputSize) < m_opLength))
+    {
+        ESP_LOGE(LOG_TAG, "Operation exceeds the target image.");
+    }
+    else if ((OP_COPY != m_opType) && (OP_ADD != m_opType) && (OP_DATA != m_opType))
+    {
+        ESP_LOGE(LOG_TAG, "Unknown operation %u.", m_opType);
+    }
+    else if ((OP_DATA != m_opType) &&
+             ((m_sourceSize < m_opOffset) || ((m_sourceSize - m_opOffset) < m_opLength)))
+    {
+        ESP_LOGE(LOG_TAG, "Operation exceeds the source image.");
+    }
+    else if (OP_COPY == m_opType)
+    {
+        isSuccessful = copyOriginal();
+    }
+    else
+    {
+        m_state      = STATE_OP_DATA;
+        isSuccessful = true;
+    }
+
+    return isSuccessful;
+}
+
+bool DeltaPatcher::handleOpData(const uint8_t* data, size_t size, size_t& offset)
+{
+    bool   isSuccessful = false;
+    size_t chunkSize    = std::min(m_opLength, size - offset);
+
+    if (OP_DATA == m_opType)
+    {
+        isSuccessful = m_writer->write(&data[offset], chunkSize);
+    }
+    else
+    {
+        chunkSize = std::min(chunkSize, BUFFER_SIZE);
+
+        if (true == m_writer->readOriginal(m_opOffset, m_buffer, chunkSize))
+        {
+            size_t idx = 0U;
+
+            for (idx = 0U; chunkSize > idx; ++idx)
+            {
+                m_buffer[idx] += data[offset + idx];
+            }
+
+            isSuccessful = m_writer->write(m_buffer, chunkSize);
+        }
+    }
+
+    m_opOffset   += chunkSize;
+    m_opLength   -= chunkSize;
+    m_outputSize += chunkSize;
+    offset       += chunkSize;
+
+    if (0U == m_opLength)
+    {
+        finishOp();
+    }
+
+    return isSuccessful;
+}
+
+bool DeltaPatcher::copyOriginal()
+{
+    bool isSuccessful = true;
+
+    while ((0U < m_opLength) && (true == isSuccessful))
+    {
+        size_t chunkSize = std::min(BUFFER_SIZE, m_opLength);
+
+        isSuccessful     = (true == m_writer->readOriginal(m_opOffset, m_buffer, chunkSize)) &&
+                           (true == m_writer->write(m_buffer, chunkSize));
+
+        m_opOffset      += chunkSize;
+        m_opLength      -= chunkSize;
+        m_outputSize    += chunkSize;
+    }
+
+    finishOp();
+
+    return isSuccessful;
+}
+
+void DeltaPatcher::finishOp()
+{
+    m_state = (m_targetSize == m_outputSize) ? STATE_DONE : STATE_OP_HEADER;
+}
+
+uint32_t DeltaPatcher::getHeaderValue(size_t offset) const
+{
+    uint32_t value = 0U;
+    size_t   idx   = 0U;
+
+    for (idx = 0U; sizeof(uint32_t) > idx; ++idx)
+    {
+        value |= static_cast<uint32_t>(m_header[offset + idx]) << (idx * 8U);
+    }
+
+    return value;
+}
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
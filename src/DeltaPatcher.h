@@ -0,0 +1,277 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   DeltaPatcher.h
+ * @brief  Streaming in-place binary delta patcher
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef DELTA_PATCHER_H
+#define DELTA_PATCHER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "PartitionWriter.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Applies a streamed binary delta patch to the content of the target partition.
+ * The patched image is written back in place by the partition writer, which
+ * provides the original partition content during the write.
+ *
+ * The patch is created by script/create_delta.py and has the following format,
+ * all numbers are little endian:
+ *
+ * Header:
+ *   - 4 byte magic "PXD1"
+ *   - 4 byte source image size
+ *   - 4 byte source image CRC32
+ *   - 4 byte target image size
+ *   - 4 byte number of sectors, the patch refers back to already written ones.
+ *
+ * Followed by the operations, each with a header of:
+ *   - 1 byte operation type
+ *   - 4 byte source offset
+ *   - 4 byte length
+ *
+ * The COPY operation copies original data, the ADD operation adds the following
+ * bytes to the original data and the DATA operation is followed by the literal
+ * bytes.
+ */
+class DeltaPatcher
+{
+public:
+
+    /** Max. number of sectors, a patch may refer back. Each costs one sector of RAM. */
+    static const size_t MAX_WINDOW_SECTORS = 16U;
+
+    /**
+     * Constructs the delta patcher.
+     */
+    DeltaPatcher() :
+        m_writer(nullptr),
+        m_state(STATE_IDLE),
+        m_header(),
+        m_headerSize(0U),
+        m_sourceSize(0U),
+        m_targetSize(0U),
+        m_outputSize(0U),
+        m_opType(0U),
+        m_opOffset(0U),
+        m_opLength(0U),
+        m_buffer()
+    {
+    }
+
+    /**
+     * Destroys the delta patcher.
+     */
+    ~DeltaPatcher()
+    {
+    }
+
+    /**
+     * Checks whether the data starts with the patch magic bytes.
+     *
+     * @param[in] data  Data
+     * @param[in] size  Data size in byte
+     *
+     * @return If it is a patch, it will return true otherwise false.
+     */
+    static bool isPatch(const uint8_t* data, size_t size);
+
+    /**
+     * Begin applying a patch. The partition writer must be started already,
+     * but no data written yet.
+     *
+     * @param[in] writer    Partition writer, which provides the original content
+     *                      and receives the patched image.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool begin(PartitionWriter* writer);
+
+    /**
+     * Apply the next patch data.
+     *
+     * @param[in] data  Patch data
+     * @param[in] size  Patch data size in byte
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool write(const uint8_t* data, size_t size);
+
+    /**
+     * Finish applying the patch.
+     *
+     * @return If the patch was completely applied, it will return true otherwise false.
+     */
+    bool end();
+
+    /**
+     * Get the size of the patched image.
+     *
+     * @return Patched image size in byte
+     */
+    size_t getTargetSize() const
+    {
+        return m_targetSize;
+    }
+
+private:
+
+    /**
+     * Patch parser states.
+     */
+    enum State
+    {
+        STATE_IDLE = 0,  /**< Not started */
+        STATE_HEADER,    /**< Parsing the patch header */
+        STATE_OP_HEADER, /**< Parsing an operation header */
+        STATE_OP_DATA,   /**< Processing operation data */
+        STATE_DONE,      /**< Patch completely applied */
+        STATE_ERROR      /**< Invalid patch */
+    };
+
+    /** Patch header size in byte. */
+    static const size_t  HEADER_SIZE    = 20U;
+
+    /** Operation header size in byte. */
+    static const size_t  OP_HEADER_SIZE = 9U;
+
+    /** Buffer size in byte, used for processing the original data. */
+    static const size_t  BUFFER_SIZE    = 512U;
+
+    /** Operation: Copy original data. */
+    static const uint8_t OP_COPY        = 0U;
+
+    /** Operation: Add the following bytes to the original data. */
+    static const uint8_t OP_ADD         = 1U;
+
+    /** Operation: Literal data. */
+    static const uint8_t OP_DATA        = 2U;
+
+    PartitionWriter* m_writer;              /**< Partition writer */
+    State            m_state;               /**< Parser state */
+    uint8_t          m_header[HEADER_SIZE]; /**< Patch or operation header, which is received. */
+    size_t           m_headerSize;          /**< Number of received header bytes */
+    size_t           m_sourceSize;          /**< Source image size in byte */
+    size_t           m_targetSize;          /**< Target image size in byte */
+    size_t           m_outputSize;          /**< Number of produced image bytes */
+    uint8_t          m_opType;              /**< Current operation type */
+    size_t           m_opOffset;            /**< Current operation source offset */
+    size_t           m_opLength;            /**< Remaining length of the current operation */
+    uint8_t          m_buffer[BUFFER_SIZE]; /**< Buffer for original data */
+
+    /* An instance shall not be copied. */
+    DeltaPatcher(const DeltaPatcher& patcher);
+    DeltaPatcher& operator=(const DeltaPatcher& patcher);
+
+    /**
+     * Collect header bytes.
+     *
+     * @param[in]       data    Patch data
+     * @param[in]       size    Patch data size in byte
+     * @param[in,out]   offset  Offset in the patch data
+     * @param[in]       total   Header size in byte
+     *
+     * @return If the header is complete, it will return true otherwise false.
+     */
+    bool collectHeader(const uint8_t* data, size_t size, size_t& offset, size_t total);
+
+    /**
+     * Handle the complete patch header.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool handleHeader();
+
+    /**
+     * Handle a complete operation header.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool handleOpHeader();
+
+    /**
+     * Process operation data.
+     *
+     * @param[in]       data    Patch data
+     * @param[in]       size    Patch data size in byte
+     * @param[in,out]   offset  Offset in the patch data
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool handleOpData(const uint8_t* data, size_t size, size_t& offset);
+
+    /**
+     * Copy original data to the patched image.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool copyOriginal();
+
+    /**
+     * Finish the current operation.
+     */
+    void finishOp();
+
+    /**
+     * Get a little endian 32-bit value from the header.
+     *
+     * @param[in] offset    Offset in the header
+     *
+     * @return Value
+     */
+    uint32_t getHeaderValue(size_t offset) const;
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif /* DELTA_PATCHER_H */
+
+/** @} */
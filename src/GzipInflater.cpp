@@ -0,0 +1,385 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   GzipInflater.cpp
+ * @brief  Streaming gzip decompression
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "GzipInflater.h"
+#include <new>
+
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char LOG_TAG[] = "GzipInflater";
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+bool GzipInflater::isGzip(const uint8_t* data, size_t size)
+{
+    bool isGzip = false;
+
+    if ((nullptr != data) &&
+        (3U <= size) &&
+        (ID1 == data[0]) &&
+        (ID2 == data[1]) &&
+        (CM_DEFLATE == data[2]))
+    {
+        isGzip = true;
+    }
+
+    return isGzip;
+}
+
+bool GzipInflater::begin(OutputFunc output)
+{
+    bool isSuccessful = false;
+
+    release();
+
+    if (nullptr != output)
+    {
+        m_decompressor = new (std::nothrow) tinfl_decompressor;
+        m_dict         = new (std::nothrow) uint8_t[TINFL_LZ_DICT_SIZE];
+
+        if ((nullptr == m_decompressor) || (nullptr == m_dict))
+        {
+            ESP_LOGE(LOG_TAG, "Out of memory.");
+            release();
+        }
+        else
+        {
+            tinfl_init(m_decompressor);
+
+            m_dictOffset = 0U;
+            m_output     = output;
+            m_state      = STATE_HEADER;
+            m_flags      = 0U;
+            m_count      = 0U;
+            m_skipSize   = 0U;
+            m_crc        = 0U;
+            m_outputSize = 0U;
+            isSuccessful = true;
+        }
+    }
+
+    return isSuccessful;
+}
+
+bool GzipInflater::write(const uint8_t* data, size_t size)
+{
+    size_t offset = 0U;
+
+    while ((size > offset) && (STATE_ERROR != m_state))
+    {
+        if (STATE_DATA == m_state)
+        {
+            offset += inflate(&data[offset], size - offset);
+        }
+        else if ((STATE_IDLE == m_state) || (STATE_DONE == m_state))
+        {
+            /* Concatenated gzip members are not supported. */
+            ESP_LOGE(LOG_TAG, "Unexpected data.");
+            m_state = STATE_ERROR;
+        }
+        else
+        {
+            parseByte(data[offset]);
+            ++offset;
+        }
+    }
+
+    return (STATE_ERROR != m_state);
+}
+
+bool GzipInflater::end()
+{
+    bool isSuccessful = (STATE_DONE == m_state);
+
+    if (false == isSuccessful)
+    {
+        ESP_LOGE(LOG_TAG, "Incomplete gzip stream.");
+    }
+
+    m_state = STATE_IDLE;
+
+    return isSuccessful;
+}
+
+void GzipInflater::release()
+{
+    delete m_decompressor;
+    m_decompressor = nullptr;
+
+    delete[] m_dict;
+    m_dict   = nullptr;
+
+    m_output = nullptr;
+    m_state  = STATE_IDLE;
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+void GzipInflater::parseByte(uint8_t value)
+{
+    switch (m_state)
+    {
+    case STATE_HEADER:
+        m_header[m_count] = value;
+        ++m_count;
+
+        if (HEADER_SIZE == m_count)
+        {
+            if ((ID1 != m_header[0]) || (ID2 != m_header[1]) || (CM_DEFLATE != m_header[2]))
+            {
+                ESP_LOGE(LOG_TAG, "Invalid gzip header.");
+                m_state = STATE_ERROR;
+            }
+            else
+            {
+                m_flags = m_header[3];
+                nextHeaderState();
+            }
+        }
+        break;
+
+    case STATE_EXTRA_LENGTH:
+        m_header[m_count] = value;
+        ++m_count;
+
+        if (2U == m_count)
+        {
+            m_skipSize = static_cast<size_t>(m_header[0]) | (static_cast<size_t>(m_header[1]) << 8U);
+
+            if (0U == m_skipSize)
+            {
+                nextHeaderState();
+            }
+            else
+            {
+                m_state = STATE_SKIP;
+            }
+        }
+        break;
+
+    case STATE_SKIP:
+        --m_skipSize;
+
+        if (0U == m_skipSize)
+        {
+            nextHeaderState();
+        }
+        break;
+
+    case STATE_SKIP_STRING:
+        if (0U == value)
+        {
+            nextHeaderState();
+        }
+        break;
+
+    case STATE_TRAILER:
+        m_header[m_count] = value;
+        ++m_count;
+
+        if (TRAILER_SIZE == m_count)
+        {
+            checkTrailer();
+        }
+        break;
+
+    default:
+        m_state = STATE_ERROR;
+        break;
+    }
+}
+
+void GzipInflater::nextHeaderState()
+{
+    m_count = 0U;
+
+    /* The optional header parts are ordered according to RFC1952. */
+    if (0U != (m_flags & FLAG_EXTRA))
+    {
+        m_flags &= ~FLAG_EXTRA;
+        m_state  = STATE_EXTRA_LENGTH;
+    }
+    else if (0U != (m_flags & FLAG_NAME))
+    {
+        m_flags &= ~FLAG_NAME;
+        m_state  = STATE_SKIP_STRING;
+    }
+    else if (0U != (m_flags & FLAG_COMMENT))
+    {
+        m_flags &= ~FLAG_COMMENT;
+        m_state  = STATE_SKIP_STRING;
+    }
+    else if (0U != (m_flags & FLAG_HCRC))
+    {
+        m_flags    &= ~FLAG_HCRC;
+        m_skipSize  = 2U;
+        m_state     = STATE_SKIP;
+    }
+    else
+    {
+        m_state = STATE_DATA;
+    }
+}
+
+void GzipInflater::checkTrailer()
+{
+    uint32_t crc  = 0U;
+    uint32_t size = 0U;
+    size_t   idx  = 0U;
+
+    /* Both values are stored in little endian. */
+    for (idx = 0U; 4U > idx; ++idx)
+    {
+        crc  |= static_cast<uint32_t>(m_header[idx]) << (idx * 8U);
+        size |= static_cast<uint32_t>(m_header[4U + idx]) << (idx * 8U);
+    }
+
+    if (crc != m_crc)
+    {
+        ESP_LOGE(LOG_TAG, "CRC mismatch.");
+        m_state = STATE_ERROR;
+    }
+    /* The size is stored modulo 2^32. */
+    else if (size != static_cast<uint32_t>(m_outputSize))
+    {
+        ESP_LOGE(LOG_TAG, "Size mismatch.");
+        m_state = STATE_ERROR;
+    }
+    else
+    {
+        m_state = STATE_DONE;
+    }
+}
+
+size_t GzipInflater::inflate(const uint8_t* data, size_t size)
+{
+    size_t       consumed = 0U;
+    tinfl_status status   = TINFL_STATUS_FAILED;
+
+    do
+    {
+        size_t inSize  = size - consumed;
+        size_t outSize = TINFL_LZ_DICT_SIZE - m_dictOffset;
+
+        status         = tinfl_decompress(m_decompressor, &data[consumed], &inSize, m_dict, &m_dict[m_dictOffset], &outSize, TINFL_FLAG_HAS_MORE_INPUT);
+        consumed      += inSize;
+
+        if (0U < outSize)
+        {
+            m_crc         = esp_rom_crc32_le(m_crc, &m_dict[m_dictOffset], outSize);
+            m_outputSize += outSize;
+
+            if (false == m_output(&m_dict[m_dictOffset], outSize))
+            {
+                m_state = STATE_ERROR;
+            }
+
+            /* The dictionary is used as ring buffer. */
+            m_dictOffset = (m_dictOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1U);
+        }
+    }
+    while ((TINFL_STATUS_HAS_MORE_OUTPUT == status) && (STATE_DATA == m_state));
+
+    if (STATE_DATA == m_state)
+    {
+        if (TINFL_STATUS_DONE == status)
+        {
+            /* The miniz 1.x in ROM reads ahead into its bit buffer and
+             * doesn't give these bytes back at the end of the stream.
+             * They belong to the trailer, therefore feed the whole bytes
+             * from the bit buffer to the trailer parser first.
+             */
+            uint32_t bitBuffer = m_decompressor->m_bit_buf >> (m_decompressor->m_num_bits & 7U);
+            size_t   lookAhead = m_decompressor->m_num_bits >> 3U;
+            size_t   idx       = 0U;
+
+            m_count = 0U;
+            m_state = STATE_TRAILER;
+
+            while ((lookAhead > idx) && (STATE_TRAILER == m_state))
+            {
+                parseByte(static_cast<uint8_t>(bitBuffer >> (idx * 8U)));
+                ++idx;
+            }
+        }
+        else if (TINFL_STATUS_NEEDS_MORE_INPUT != status)
+        {
+            ESP_LOGE(LOG_TAG, "Decompression failed: %d", status);
+            m_state = STATE_ERROR;
+        }
+    }
+
+    return consumed;
+}
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
@@ -0,0 +1,237 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   GzipInflater.h
+ * @brief  Streaming gzip decompression
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef GZIP_INFLATER_H
+#define GZIP_INFLATER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <miniz.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Streaming gzip (RFC1952) decompression, based on the miniz inflater in ROM.
+ * The compressed data can be passed in chunks of any size. The decompressed
+ * data is passed to the output function, as soon as it is available.
+ *
+ * The memory consumption is bounded by the deflate window of 32 KB plus
+ * the decompressor state. It is only allocated between begin() and release().
+ */
+class GzipInflater
+{
+public:
+
+    /**
+     * Output function, which is called with decompressed data.
+     *
+     * @param[in] data  Decompressed data
+     * @param[in] size  Decompressed data size in byte
+     *
+     * @return If the data was processed successful, it will return true otherwise false.
+     */
+    typedef bool (*OutputFunc)(const uint8_t* data, size_t size);
+
+    /**
+     * Constructs the inflater.
+     */
+    GzipInflater() :
+        m_decompressor(nullptr),
+        m_dict(nullptr),
+        m_dictOffset(0U),
+        m_output(nullptr),
+        m_state(STATE_IDLE),
+        m_flags(0U),
+        m_header(),
+        m_count(0U),
+        m_skipSize(0U),
+        m_crc(0U),
+        m_outputSize(0U)
+    {
+    }
+
+    /**
+     * Destroys the inflater.
+     */
+    ~GzipInflater()
+    {
+        release();
+    }
+
+    /**
+     * Is the data the beginning of a gzip stream?
+     *
+     * @param[in] data  Data
+     * @param[in] size  Data size in byte
+     *
+     * @return If the gzip magic bytes are found, it will return true otherwise false.
+     */
+    static bool isGzip(const uint8_t* data, size_t size);
+
+    /**
+     * Begin decompression of a new gzip stream.
+     * It allocates the required memory.
+     *
+     * @param[in] output    Output function for the decompressed data.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool begin(OutputFunc output);
+
+    /**
+     * Decompress the next chunk of the gzip stream.
+     *
+     * @param[in] data  Compressed data
+     * @param[in] size  Compressed data size in byte
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool write(const uint8_t* data, size_t size);
+
+    /**
+     * Finish the decompression.
+     *
+     * @return If the gzip stream is complete and its checksum and size match, it will return true otherwise false.
+     */
+    bool end();
+
+    /**
+     * Release the allocated memory.
+     */
+    void release();
+
+    /**
+     * Get the number of decompressed bytes.
+     *
+     * @return Decompressed size in byte
+     */
+    size_t getOutputSize() const
+    {
+        return m_outputSize;
+    }
+
+private:
+
+    /**
+     * Processing states of the gzip stream.
+     */
+    enum State
+    {
+        STATE_IDLE = 0,     /**< Not started */
+        STATE_HEADER,       /**< Fixed size header */
+        STATE_EXTRA_LENGTH, /**< Length of the extra field */
+        STATE_SKIP,         /**< Skip a number of bytes */
+        STATE_SKIP_STRING,  /**< Skip a zero terminated string */
+        STATE_DATA,         /**< Compressed data */
+        STATE_TRAILER,      /**< Trailer with CRC-32 and size */
+        STATE_DONE,         /**< Stream complete */
+        STATE_ERROR         /**< Stream invalid */
+    };
+
+    static const size_t  HEADER_SIZE  = 10U;   /**< Fixed gzip header size in byte. */
+    static const size_t  TRAILER_SIZE = 8U;    /**< gzip trailer size in byte. */
+    static const uint8_t ID1          = 0x1FU; /**< gzip magic byte 1 */
+    static const uint8_t ID2          = 0x8BU; /**< gzip magic byte 2 */
+    static const uint8_t CM_DEFLATE   = 8U;    /**< Compression method deflate */
+    static const uint8_t FLAG_HCRC    = 0x02U; /**< Header CRC present */
+    static const uint8_t FLAG_EXTRA   = 0x04U; /**< Extra field present */
+    static const uint8_t FLAG_NAME    = 0x08U; /**< Original file name present */
+    static const uint8_t FLAG_COMMENT = 0x10U; /**< File comment present */
+
+    tinfl_decompressor* m_decompressor;         /**< Decompressor state */
+    uint8_t*            m_dict;                 /**< Dictionary, which is the deflate window. */
+    size_t              m_dictOffset;           /**< Write offset in the dictionary. */
+    OutputFunc          m_output;               /**< Output function */
+    State               m_state;                /**< Current processing state */
+    uint8_t             m_flags;                /**< Not yet processed header flags */
+    uint8_t             m_header[HEADER_SIZE];  /**< Buffer for header and trailer. */
+    size_t              m_count;                /**< Number of bytes in the header buffer. */
+    size_t              m_skipSize;             /**< Number of bytes to skip. */
+    uint32_t            m_crc;                  /**< CRC-32 of the decompressed data. */
+    size_t              m_outputSize;           /**< Number of decompressed bytes. */
+
+    /* An instance shall not be copied. */
+    GzipInflater(const GzipInflater& inflater);
+    GzipInflater& operator=(const GzipInflater& inflater);
+
+    /**
+     * Process a single byte of the header or trailer.
+     *
+     * @param[in] value Byte
+     */
+    void parseByte(uint8_t value);
+
+    /**
+     * Select the next state after a header part was processed.
+     */
+    void nextHeaderState();
+
+    /**
+     * Check the trailer against the decompressed data.
+     */
+    void checkTrailer();
+
+    /**
+     * Decompress data and pass it to the output function.
+     *
+     * @param[in] data  Compressed data
+     * @param[in] size  Compressed data size in byte
+     *
+     * @return Number of consumed bytes
+     */
+    size_t inflate(const uint8_t* data, size_t size);
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif /* GZIP_INFLATER_H */
+
+/** @} */
@@ -35,9 +35,13 @@
  *****************************************************************************/
 #include "MiniTerminal.h"
 #include <WiFi.h>
+#include <Update.h>
 #include <Settings.h>
 
 #include "BootPartition.h"
+#include "BootTrace.h"
+#include "PullUpdate.h"
+#include "UploadMetrics.h"
 
 /******************************************************************************
  * Compiler Switches
@@ -57,6 +61,11 @@
  */
 #define NOT_USED(_x) (void)(_x)
 
+/**
+ * Get the length of a command string at compile time.
+ */
+#define CMD_LEN(_cmd) (sizeof(_cmd) - 1U)
+
 /******************************************************************************
  * Types and classes
  *****************************************************************************/
@@ -70,45 +79,133 @@
  *****************************************************************************/
 
 /** Command: restart */
-static const char RESTART[]                                  = "restart";
+static constexpr char RESTART[]                                   = "restart";
 
 /** Command: write wifi passphrase */
-static const char WRITE_WIFI_PASSPHRASE[]                    = "write wifi passphrase";
+static constexpr char WRITE_WIFI_PASSPHRASE[]                     = "write wifi passphrase";
 
 /** Command: write wifi ssid */
-static const char WRITE_WIFI_SSID[]                          = "write wifi ssid";
+static constexpr char WRITE_WIFI_SSID[]                           = "write wifi ssid";
+
+/** Command: write wifi reuse ip */
+static constexpr char WRITE_WIFI_REUSE_IP[]                       = "write wifi reuse ip";
+
+/** Command: upload fw */
+static constexpr char UPLOAD_FW[]                                 = "upload fw";
+
+/** Command: upload fs */
+static constexpr char UPLOAD_FS[]                                 = "upload fs";
+
+/** Command: update fw */
+static constexpr char UPDATE_FW[]                                 = "update fw";
+
+/** Command: update fs */
+static constexpr char UPDATE_FS[]                                 = "update fs";
+
+/** Command: update status */
+static constexpr char UPDATE_STATUS[]                             = "update status";
+
+/** Command: stats */
+static constexpr char STATS[]                                     = "stats";
 
 /** Command: get ip */
-static const char GET_IP[]                                   = "get ip";
+static constexpr char GET_IP[]                                    = "get ip";
+
+/** Command: get trace */
+static constexpr char GET_TRACE[]                                 = "get trace";
 
 /** Command: activate app */
-static const char ACTIVATE_APP[]                             = "activate app";
+static constexpr char ACTIVATE_APP[]                              = "activate app";
 
 /** Command: help */
-static const char HELP[]                                     = "help";
-
-/* Command entry table. */
-const MiniTerminal::CmdTableEntry MiniTerminal::m_cmdTable[] = {
-    { RESTART, &MiniTerminal::cmdRestart },
-    { WRITE_WIFI_PASSPHRASE, &MiniTerminal::cmdWriteWifiPassphrase },
-    { WRITE_WIFI_SSID, &MiniTerminal::cmdWriteWifiSSID },
-    { GET_IP, &MiniTerminal::cmdGetIPAddress },
-    { ACTIVATE_APP, &MiniTerminal::cmdActivateApp },
-    { HELP, &MiniTerminal::cmdHelp },
+static constexpr char HELP[]                                      = "help";
+
+/* Command entry table, sorted by the command strings. */
+constexpr MiniTerminal::CmdTableEntry MiniTerminal::m_cmdTable[] = {
+    { ACTIVATE_APP, CMD_LEN(ACTIVATE_APP), &MiniTerminal::cmdActivateApp },
+    { GET_IP, CMD_LEN(GET_IP), &MiniTerminal::cmdGetIPAddress },
+    { GET_TRACE, CMD_LEN(GET_TRACE), &MiniTerminal::cmdGetBootTrace },
+    { HELP, CMD_LEN(HELP), &MiniTerminal::cmdHelp },
+    { RESTART, CMD_LEN(RESTART), &MiniTerminal::cmdRestart },
+    { STATS, CMD_LEN(STATS), &MiniTerminal::cmdStats },
+    { UPDATE_FS, CMD_LEN(UPDATE_FS), &MiniTerminal::cmdUpdateFilesystem },
+    { UPDATE_FW, CMD_LEN(UPDATE_FW), &MiniTerminal::cmdUpdateFirmware },
+    { UPDATE_STATUS, CMD_LEN(UPDATE_STATUS), &MiniTerminal::cmdUpdateStatus },
+    { UPLOAD_FS, CMD_LEN(UPLOAD_FS), &MiniTerminal::cmdUploadFilesystem },
+    { UPLOAD_FW, CMD_LEN(UPLOAD_FW), &MiniTerminal::cmdUploadFirmware },
+    { WRITE_WIFI_PASSPHRASE, CMD_LEN(WRITE_WIFI_PASSPHRASE), &MiniTerminal::cmdWriteWifiPassphrase },
+    { WRITE_WIFI_REUSE_IP, CMD_LEN(WRITE_WIFI_REUSE_IP), &MiniTerminal::cmdWriteWifiReuseIp },
+    { WRITE_WIFI_SSID, CMD_LEN(WRITE_WIFI_SSID), &MiniTerminal::cmdWriteWifiSSID },
 };
 
+/**
+ * Is the first command ordered before the second one and not its prefix?
+ *
+ * @param[in] first     First command
+ * @param[in] second    Second command
+ *
+ * @return If ordered, it will return true otherwise false.
+ */
+static constexpr bool isCmdOrdered(const char* first, const char* second)
+{
+    return ('\0' == first[0]) ? false :
+           (first[0] != second[0]) ? (static_cast<unsigned char>(first[0]) < static_cast<unsigned char>(second[0])) :
+           isCmdOrdered(&first[1], &second[1]);
+}
+
 /******************************************************************************
  * Public Methods
  *****************************************************************************/
 
 void MiniTerminal::process()
 {
-    char   buffer[LOCAL_BUFFER_SIZE];
-    size_t read = m_stream.readBytes(buffer, LOCAL_BUFFER_SIZE);
-    size_t idx  = 0U;
+    /* The binary upload reads the input on its own. */
+    if (true == m_serialUpload.isRunning())
+    {
+        m_serialUpload.process();
+    }
+    else
+    {
+        char buffer[LOCAL_BUFFER_SIZE];
+        int  available = m_stream.available();
 
-    /* Process the read input data. */
-    while (read > idx)
+        /* Read all available input, but not more. The input after a started
+         * binary upload belongs to it.
+         */
+        while ((0 < available) && (false == m_serialUpload.isRunning()))
+        {
+            size_t toRead = min(static_cast<size_t>(available), LOCAL_BUFFER_SIZE);
+            size_t read   = m_stream.readBytes(buffer, toRead);
+
+            if (0U == read)
+            {
+                available = 0;
+            }
+            else
+            {
+                processInput(buffer, read);
+                available -= static_cast<int>(read);
+            }
+        }
+
+        /* Echo and results are written at once. */
+        flush();
+    }
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+void MiniTerminal::processInput(const char* buffer, size_t size)
+{
+    size_t idx = 0U;
+
+    while (size > idx)
     {
         char currentChar = buffer[idx];
 
@@ -118,7 +215,7 @@ void MiniTerminal::process()
             /* Don't echo mechanism, because its too late in case the
              * command may write a result too.
              */
-            (void)m_stream.write(currentChar);
+            write(&currentChar, 1U);
 
             m_input[m_writeIndex] = '\0';
 
@@ -144,7 +241,7 @@ void MiniTerminal::process()
                     ASCII_BS
                 };
 
-                (void)m_stream.write(removeSeq, sizeof(removeSeq));
+                write(removeSeq, sizeof(removeSeq));
                 --m_writeIndex;
             }
         }
@@ -157,7 +254,7 @@ void MiniTerminal::process()
             {
                 m_input[m_writeIndex] = currentChar;
                 ++m_writeIndex;
-                (void)m_stream.write(currentChar);
+                write(&currentChar, 1U);
             }
         }
 
@@ -165,54 +262,103 @@ void MiniTerminal::process()
     }
 }
 
-/******************************************************************************
- * Protected Methods
- *****************************************************************************/
+void MiniTerminal::write(const char* str)
+{
+    write(str, strlen(str));
+}
 
-/******************************************************************************
- * Private Methods
- *****************************************************************************/
+void MiniTerminal::write(const char* data, size_t size)
+{
+    size_t idx = 0U;
+
+    while (size > idx)
+    {
+        size_t count = min(OUTPUT_BUFFER_SIZE - m_outputIndex, size - idx);
+
+        memcpy(&m_output[m_outputIndex], &data[idx], count);
+        m_outputIndex += count;
+        idx           += count;
+
+        if (OUTPUT_BUFFER_SIZE == m_outputIndex)
+        {
+            flush();
+        }
+    }
+}
+
+void MiniTerminal::flush()
+{
+    if (0U < m_outputIndex)
+    {
+        (void)m_stream.write(reinterpret_cast<const uint8_t*>(m_output), m_outputIndex);
+        m_outputIndex = 0U;
+    }
+}
 
 void MiniTerminal::writeSuccessful(const char* result)
 {
     if (nullptr != result)
     {
-        (void)m_stream.write(result);
+        write(result);
     }
 
-    (void)m_stream.write("OK\n");
+    write("OK\n");
 }
 
 void MiniTerminal::writeError(const char* result)
 {
     if (nullptr != result)
     {
-        (void)m_stream.write(result);
+        write(result);
     }
 
-    (void)m_stream.write("ERR\n");
+    write("ERR\n");
+}
+
+constexpr bool MiniTerminal::isCmdTableSorted(size_t idx)
+{
+    return (ARRAY_ELEMENT_COUNT(m_cmdTable) <= (idx + 1U)) ? true :
+           (isCmdOrdered(m_cmdTable[idx].cmdStr, m_cmdTable[idx + 1U].cmdStr) && isCmdTableSorted(idx + 1U));
 }
 
 void MiniTerminal::executeCommand(const char* cmdLine)
 {
-    uint32_t idx = 0U;
+    const CmdTableEntry* entry = nullptr;
+    size_t               left  = 0U;
+    size_t               right = ARRAY_ELEMENT_COUNT(m_cmdTable);
 
-    for (idx = 0U; ARRAY_ELEMENT_COUNT(m_cmdTable) > idx; ++idx)
+    static_assert(true == isCmdTableSorted(0U), "The command table must be sorted and no command may be the prefix of another one.");
+
+    /* Binary search for the command, which is a prefix of the command line.
+     * Because no command is the prefix of another one, it is unique.
+     */
+    while ((nullptr == entry) && (left < right))
     {
-        const CmdTableEntry entry = m_cmdTable[idx];
-        const size_t        len   = strlen(entry.cmdStr);
+        size_t middle = left + ((right - left) / 2U);
+        int    result = strncmp(cmdLine, m_cmdTable[middle].cmdStr, m_cmdTable[middle].cmdLen);
 
-        if (0 == strncmp(cmdLine, entry.cmdStr, len))
+        if (0 == result)
+        {
+            entry = &m_cmdTable[middle];
+        }
+        else if (0 > result)
+        {
+            right = middle;
+        }
+        else
         {
-            (this->*entry.handler)(&cmdLine[len]);
-            break;
+            left = middle + 1U;
         }
     }
 
-    if (ARRAY_ELEMENT_COUNT(m_cmdTable) == idx)
+    if (nullptr == entry)
     {
         writeError("Unknown command.\n");
     }
+    else
+    {
+        (this->*entry->handler)(&cmdLine[entry->cmdLen]);
+    }
 }
 
 void MiniTerminal::cmdRestart(const char* par)
@@ -241,6 +387,9 @@ void MiniTerminal::cmdWriteWifiPassphrase(const char* par)
             KeyValueString& wifiPassword = settings.getWifiPassphrase();
 
             wifiPassword.setValue(&par[1]); /* Skip leading space */
+
+            /* The cached access point shall not be used for the changed network. */
+            settings.getWifiBSSID().setValue("");
             settings.close();
 
             writeSuccessful();
@@ -267,6 +416,40 @@ void MiniTerminal::cmdWriteWifiSSID(const char* par)
             KeyValueString& wifiSSID = settings.getWifiSSID();
 
             wifiSSID.setValue(&par[1]); /* Skip leading space */
+
+            /* The cached access point shall not be used for the changed network. */
+            settings.getWifiBSSID().setValue("");
+            settings.close();
+
+            writeSuccessful();
+        }
+    }
+}
+
+void MiniTerminal::cmdWriteWifiReuseIp(const char* par)
+{
+    if (nullptr != par)
+    {
+        Settings& settings = Settings::getInstance();
+
+        if ((' ' != par[0]) ||
+            (('0' != par[1]) && ('1' != par[1])) ||
+            ('\0' != par[2]))
+        {
+            writeError("Usage: write wifi reuse ip <0|1>\n");
+        }
+        else if (false == settings.open(false))
+        {
+            writeError();
+        }
+        else
+        {
+            KeyValueBool& wifiReuseIp = settings.getWifiReuseIp();
+
+            wifiReuseIp.setValue('1' == par[1]);
+
+            /* Forget the last lease, it will be stored after the next DHCP handshake. */
+            settings.getWifiIp().setValue(0U);
             settings.close();
 
             writeSuccessful();
@@ -274,6 +457,125 @@ void MiniTerminal::cmdWriteWifiSSID(const char* par)
     }
 }
 
+void MiniTerminal::cmdUploadFirmware(const char* par)
+{
+    startUpload(par, U_FLASH);
+}
+
+void MiniTerminal::cmdUploadFilesystem(const char* par)
+{
+    startUpload(par, U_SPIFFS);
+}
+
+void MiniTerminal::startUpload(const char* par, int cmd)
+{
+    static const size_t SHA256_HEX_LEN = 64U;
+    char*               end            = nullptr;
+    unsigned long       size           = 0U;
+
+    if (' ' == par[0])
+    {
+        size = strtoul(&par[1], &end, 10);
+    }
+
+    /* The size is required, the hash is optional. */
+    if ((nullptr == end) ||
+        (&par[1] == end) ||
+        (0U == size) ||
+        (('\0' != end[0]) && ((' ' != end[0]) || (SHA256_HEX_LEN != strlen(&end[1])))))
+    {
+        writeError("Usage: upload fw|fs <size> [<sha256>]\n");
+    }
+    else
+    {
+        const char* error     = nullptr;
+        String      imageHash = ('\0' == end[0]) ? "" : &end[1];
+
+        if (false == m_serialUpload.begin(cmd, size, imageHash, error))
+        {
+            String result = error;
+
+            result += "\n";
+            writeError(result.c_str());
+        }
+        else
+        {
+            /* Tell the sender the upload baudrate, the max. payload size and the window size. */
+            String result = String(m_serialUpload.getUploadBaudRate());
+
+            result += " ";
+            result += String(SerialUpload::BLOCK_SIZE);
+            result += " ";
+            result += String(SerialUpload::WINDOW_SIZE);
+            result += "\n";
+            writeSuccessful(result.c_str());
+        }
+    }
+}
+
+void MiniTerminal::cmdUpdateFirmware(const char* par)
+{
+    startUpdate(par, U_FLASH);
+}
+
+void MiniTerminal::cmdUpdateFilesystem(const char* par)
+{
+    startUpdate(par, U_SPIFFS);
+}
+
+void MiniTerminal::startUpdate(const char* par, int cmd)
+{
+    static const size_t SHA256_HEX_LEN = 64U;
+    const char*         end            = nullptr;
+
+    if (' ' == par[0])
+    {
+        end = strchr(&par[1], ' ');
+
+        if (nullptr == end)
+        {
+            end = &par[strlen(par)];
+        }
+    }
+
+    /* The URL is required, the hash is optional. */
+    if ((nullptr == end) ||
+        (&par[1] == end) ||
+        (('\0' != end[0]) && (SHA256_HEX_LEN != strlen(&end[1]))))
+    {
+        writeError("Usage: update fw|fs <url> [<sha256>]\n");
+    }
+    else
+    {
+        const char* error     = nullptr;
+        String      url       = String(&par[1]).substring(0U, end - &par[1]);
+        String      imageHash = ('\0' == end[0]) ? "" : &end[1];
+
+        if (false == PullUpdate::start(url, cmd, imageHash, error))
+        {
+            String result = error;
+
+            result += "\n";
+            writeError(result.c_str());
+        }
+        else
+        {
+            writeSuccessful();
+        }
+    }
+}
+
+void MiniTerminal::cmdUpdateStatus(const char* par)
+{
+    NOT_USED(par);
+
+    String result;
+
+    PullUpdate::getStatus(result);
+    result += "\n";
+    writeSuccessful(result.c_str());
+}
+
 void MiniTerminal::cmdGetIPAddress(const char* par)
 {
     NOT_USED(par);
@@ -294,6 +596,26 @@ void MiniTerminal::cmdGetIPAddress(const char* par)
     writeSuccessful(result.c_str());
 }
 
+void MiniTerminal::cmdGetBootTrace(const char* par)
+{
+    NOT_USED(par);
+
+    String result;
+
+    BootTrace::getTrace(result);
+    writeSuccessful(result.c_str());
+}
+
+void MiniTerminal::cmdStats(const char* par)
+{
+    NOT_USED(par);
+
+    String result;
+
+    UploadMetrics::getMetrics(result);
+    writeSuccessful(result.c_str());
+}
+
 void MiniTerminal::cmdActivateApp(const char* par)
 {
     NOT_USED(par);
@@ -307,13 +629,13 @@ void MiniTerminal::cmdHelp(const char* par)
 {
     NOT_USED(par);
 
-    m_stream.write("Supported commands:\n");
+    write("Supported commands:\n");
 
     for (size_t idx = 0U; ARRAY_ELEMENT_COUNT(m_cmdTable) > idx; ++idx)
     {
-        (void)m_stream.write("    ");
-        (void)m_stream.write(m_cmdTable[idx].cmdStr);
-        (void)m_stream.write("\n");
+        write("    ");
+        write(m_cmdTable[idx].cmdStr, m_cmdTable[idx].cmdLen);
+        write("\n");
     }
 
     writeSuccessful();
@@ -46,6 +46,8 @@
  *****************************************************************************/
 #include <Arduino.h>
 
+#include "SerialUpload.h"
+
 /******************************************************************************
  * Macros
  *****************************************************************************/
@@ -75,7 +77,10 @@ public:
         m_stream(stream),
         m_input(),
         m_writeIndex(0U),
-        m_isRestartRequested(false)
+        m_isRestartRequested(false),
+        m_output(),
+        m_outputIndex(0U),
+        m_serialUpload(stream)
     {
         /* Don't wait for any input. */
         m_stream.setTimeout(0U);
@@ -90,10 +95,32 @@ public:
 
     /**
      * Process the mini terminal.
-     * It will handle the stream input.
+     * It will handle the stream input. During a binary upload, the input
+     * is passed to the serial upload.
      */
     void process();
 
+    /**
+     * Set the function to change the baudrate for the binary upload.
+     *
+     * @param[in] handler           Function to change the baudrate
+     * @param[in] defaultBaudRate   Baudrate, which is restored after the upload.
+     */
+    void setBaudRateHandler(SerialUpload::BaudRateHandler handler, uint32_t defaultBaudRate)
+    {
+        m_serialUpload.setBaudRateHandler(handler, defaultBaudRate);
+    }
+
+    /**
+     * Is a binary upload running?
+     *
+     * @return If running, it will return true otherwise false.
+     */
+    bool isUploading() const
+    {
+        return m_serialUpload.isRunning();
+    }
+
     /**
      * Is restart requested?
      * 
@@ -115,6 +142,7 @@ private:
      */
     struct CmdTableEntry {
         const char *cmdStr;                           /**< Command string.           */
+        size_t      cmdLen;                           /**< Command string length.    */
         void (MiniTerminal::*handler)(const char *);  /**< Command handler function. */
     };
 
@@ -122,15 +150,63 @@ private:
     static const char   ASCII_LF            = 10;   /**< ASCII line feed value */
     static const char   ASCII_SP            = 32;   /**< ASCII space value */
     static const char   ASCII_DEL           = 127;  /**< ASCII delete value */
-    static const size_t LOCAL_BUFFER_SIZE   = 12U;  /**< Buffer size in byte to read during processing. */
-    static const size_t INPUT_BUFFER_SIZE   = 80U;  /**< Buffer size of one input command line in byte. */
+    static const size_t LOCAL_BUFFER_SIZE   = 64U;  /**< Buffer size in byte to read at once during processing. */
+    static const size_t INPUT_BUFFER_SIZE   = 384U; /**< Buffer size of one input command line in byte. It fits an update URL and hash. */
+    static const size_t OUTPUT_BUFFER_SIZE  = 128U; /**< Buffer size in byte for the echo and the results. */
+
+    Stream&      m_stream;                     /**< In/Out-stream. */
+    char         m_input[INPUT_BUFFER_SIZE];   /**< Input command line buffer. */
+    size_t       m_writeIndex;                 /**< Write index to the command line buffer. */
+    bool         m_isRestartRequested;         /**< Restart requested? */
+    char         m_output[OUTPUT_BUFFER_SIZE]; /**< Output buffer, which is written at once to the stream. */
+    size_t       m_outputIndex;                /**< Write index to the output buffer. */
+    SerialUpload m_serialUpload;               /**< Binary upload via the stream. */
+
+    /**
+     * Table with supported commands. It is sorted by the command strings and
+     * no command is the prefix of another one, see executeCommand().
+     */
+    static const CmdTableEntry m_cmdTable[];
 
-    Stream& m_stream;                   /**< In/Out-stream. */
-    char    m_input[INPUT_BUFFER_SIZE]; /**< Input command line buffer. */
-    size_t  m_writeIndex;               /**< Write index to the command line buffer. */
-    bool    m_isRestartRequested;       /**< Restart requested? */
+    /**
+     * Process the input characters: echo them, edit the command line and
+     * execute a command at the end of the line.
+     *
+     * @param[in] buffer    Input characters
+     * @param[in] size      Number of input characters
+     */
+    void processInput(const char* buffer, size_t size);
 
-    static const CmdTableEntry m_cmdTable[]; /**< Table with supported commands. */
+    /**
+     * Is the command table sorted, beginning with the given index?
+     * It is evaluated at compile time.
+     *
+     * @param[in] idx   Index of the first command table entry
+     *
+     * @return If sorted, it will return true otherwise false.
+     */
+    static constexpr bool isCmdTableSorted(size_t idx);
+
+    /**
+     * Write a string to the output buffer.
+     * 
+     * @param[in] str   String
+     */
+    void write(const char* str);
+
+    /**
+     * Write data to the output buffer. If the buffer is full, it is
+     * written to the stream.
+     * 
+     * @param[in] data  Data
+     * @param[in] size  Data size in byte
+     */
+    void write(const char* data, size_t size);
+
+    /**
+     * Write the output buffer to the stream.
+     */
+    void flush();
 
     /**
      * Write successful response.
@@ -174,6 +250,65 @@ private:
      */
     void cmdWriteWifiSSID(const char* par);
 
+    /**
+     * Enable or disable the reuse of the last ip-address lease for a fast
+     * wifi connect.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdWriteWifiReuseIp(const char* par);
+
+    /**
+     * Upload a firmware binary.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdUploadFirmware(const char* par);
+
+    /**
+     * Upload a filesystem binary.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdUploadFilesystem(const char* par);
+
+    /**
+     * Start a binary upload.
+     * 
+     * @param[in] par   Parameter: " <size> [<sha256>]"
+     * @param[in] cmd   U_FLASH for firmware or U_SPIFFS for filesystem.
+     */
+    void startUpload(const char* par, int cmd);
+
+    /**
+     * Download a firmware binary from a URL.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdUpdateFirmware(const char* par);
+
+    /**
+     * Download a filesystem binary from a URL.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdUpdateFilesystem(const char* par);
+
+    /**
+     * Start a download.
+     * 
+     * @param[in] par   Parameter: " <url> [<sha256>]"
+     * @param[in] cmd   U_FLASH for firmware or U_SPIFFS for filesystem.
+     */
+    void startUpdate(const char* par, int cmd);
+
+    /**
+     * Print the download status.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdUpdateStatus(const char* par);
+
     /**
      * Get the IP-address.
      * 
@@ -181,6 +316,20 @@ private:
      */
     void cmdGetIPAddress(const char* par);
 
+    /**
+     * Print the boot trace.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdGetBootTrace(const char* par);
+
+    /**
+     * Print the upload metrics.
+     * 
+     * @param[in] par   Parameter
+     */
+    void cmdStats(const char* par);
+
     /**
      * Get the status (error id).
      * 
@@ -34,16 +34,24 @@
  * Includes
  *****************************************************************************/
 #include "MyWebServer.h"
+
+#if (0 == CONFIG_WEB_SERVER_ASYNC)
+
 #include <WebServer.h>
 #include <Update.h>
 #include <WiFi.h>
-
 #include <esp_log.h>
-#include <esp_ota_ops.h>
-#include <esp_partition.h>
+#include <new>
 
 #include "EmbeddedFiles.h"
 #include "BootPartition.h"
+#include "BootTrace.h"
+#include "HttpStatus.h"
+#include "PartitionInfo.h"
+#include "PartitionReader.h"
+#include "PullUpdate.h"
+#include "UploadHandler.h"
+#include "UploadMetrics.h"
 
 /******************************************************************************
  * Compiler Switches
@@ -57,81 +65,70 @@
  * Types and classes
  *****************************************************************************/
 
-/**
- * This type defines supported HTTP response status codes according to RFC7231.
- */
-typedef enum
-{
-    STATUS_CODE_CONTINUE                        = 100, /**< Continue */
-    STATUS_CODE_SWITCHING_PROTOCOLS             = 101, /**< Switching Protocols */
-    STATUS_CODE_PROCESSING                      = 102, /**< Processing */
-    STATUS_CODE_OK                              = 200, /**< Ok */
-    STATUS_CODE_CREATED                         = 201, /**< Created */
-    STATUS_CODE_ACCEPTED                        = 202, /**< Accepted */
-    STATUS_CODE_NON_AUTHORITATIVE_INFORMATION   = 203, /**< Non-Authoritative Information */
-    STATUS_CODE_NO_CONTENT                      = 204, /**< No Content */
-    STATUS_CODE_RESET_CONTENT                   = 205, /**< Reset Content */
-    STATUS_CODE_PARTIAL_CONTENT                 = 206, /**< Partial Content */
-    STATUS_CODE_MULTI_STATUS                    = 207, /**< Multi-Status */
-    STATUS_CODE_ALREADY_REPORTED                = 208, /**< Already Reported */
-    STATUS_CODE_IM_USED                         = 226, /**< IM Used */
-    STATUS_CODE_MULTIPLE_CHOICES                = 300, /**< Multiple Choices */
-    STATUS_CODE_MOVED_PERMANENTLY               = 301, /**< Moved Permantently */
-    STATUS_CODE_FOUND                           = 302, /**< Found */
-    STATUS_CODE_SEE_OTHER                       = 303, /**< See Other */
-    STATUS_CODE_NOT_MODIFIED                    = 304, /**< Not Modified */
-    STATUS_CODE_USE_PROXY                       = 305, /**< Use Proxy */
-    STATUS_CODE_TEMPORARY_REDIRECT              = 307, /**< Temporary Redirect */
-    STATUS_CODE_PERMANENT_REDIRECT              = 308, /**< Permanent Redirect */
-    STATUS_CODE_BAD_REQUEST                     = 400, /**< Bad Request */
-    STATUS_CODE_UNAUTHORIZED                    = 401, /**< Unauthorized */
-    STATUS_CODE_PAYMENT_REQUIRED                = 402, /**< Payment Required */
-    STATUS_CODE_FORBIDDEN                       = 403, /**< Forbidden */
-    STATUS_CODE_NOT_FOUND                       = 404, /**< Not Found */
-    STATUS_CODE_METHOD_NOT_ALLOWED              = 405, /**< Method Not Allowed */
-    STATUS_CODE_NOT_ACCEPTABLE                  = 406, /**< Not Acceptable */
-    STATUS_CODE_PROXY_AUTHENTICATION_REQUIRED   = 407, /**< Proxy Authentication Required */
-    STATUS_CODE_REQUEST_TIMEOUT                 = 408, /**< Request Timeout */
-    STATUS_CODE_CONFLICT                        = 409, /**< Conflict */
-    STATUS_CODE_GONE                            = 410, /**< Gone */
-    STATUS_CODE_LENGTH_REQUIRED                 = 411, /**< Length Required */
-    STATUS_CODE_PRECONDITION_FAILED             = 412, /**< Precondition Failed */
-    STATUS_CODE_PAYLOAD_TOO_LARGE               = 413, /**< Payload Too Large */
-    STATUS_CODE_URI_TOO_LONG                    = 414, /**< URI Too Long */
-    STATUS_CODE_UNSUPPORTED_MEDIA_TYPE          = 415, /**< Unsupported Media Type */
-    STATUS_CODE_RANGE_NOT_SATISFIABLE           = 416, /**< Range Not Satisfiable */
-    STATUS_CODE_EXPECTATION_FAILED              = 417, /**< Expectation Failed */
-    STATUS_CODE_MISDIRECTED_REQUEST             = 421, /**< Misdirected Request */
-    STATUS_CODE_UNPROCESSABLE_ENTITY            = 422, /**< Unprocessable Entity */
-    STATUS_CODE_LOCKED                          = 423, /**< Locked */
-    STATUS_CODE_FAILED_DEPENDENCY               = 424, /**< Failed Dependency */
-    STATUS_CODE_UPGRADE_REQUIRED                = 426, /**< Upgrade Required */
-    STATUS_CODE_PRECONDITION_REQUIRED           = 428, /**< Precondition Required */
-    STATUS_CODE_TOO_MANY_REQUESTS               = 429, /**< Too Many Requests */
-    STATUS_CODE_REQUEST_HEADER_FIELDS_TOO_LARGE = 431, /**< Request Header Fields Too Large */
-    STATUS_CODE_INTERNAL_SERVER_ERROR           = 500, /**< Internal Server Error */
-    STATUS_CODE_NOT_IMPLEMENTED                 = 501, /**< Not Implemented */
-    STATUS_CODE_BAD_GATEWAY                     = 502, /**< Bad Gateway */
-    STATUS_CODE_SERVICE_UNAVAILABLE             = 503, /**< Service Unavailable */
-    STATUS_CODE_GATEWAY_TIMEOUT                 = 504, /**< Gateway Timeout */
-    STATUS_CODE_HTTP_VERSION_NOT_SUPPORTED      = 505, /**< Http Version Not Supported */
-    STATUS_CODE_VARIANT_ALSO_NEGOTIATES         = 506, /**< Variant Also Negotiates */
-    STATUS_CODE_INSUFFICIENT_STORAGE            = 507, /**< Insufficient Storage */
-    STATUS_CODE_LOOP_DETECTED                   = 508, /**< Loop Detected */
-    STATUS_CODE_NOT_EXTENDED                    = 510, /**< Not Extended */
-    STATUS_CODE_NETWORK_AUTHENTICATION_REQUIRED = 511  /**< Network Authentication Required */
-
-} HTTPStatusCode;
-
 /******************************************************************************
  * Prototypes
  *****************************************************************************/
 
-static void handleUpload();
+static void restart();
+static void handleUploadResponse();
 static void handleFileUpload();
-static void handleFileStart(HTTPUpload& upload);
-static void handleFileWrite(HTTPUpload& upload);
-static void handleFileEnd(HTTPUpload& upload);
+static void handleRawUpload(int cmd);
+static void handlePullUpdate(int cmd);
+static void getRequest(UploadHandler::Request& request);
+static bool isPartitionDownload(HTTPMethod method, const String& uri);
+static void handlePartitionDownload(const String& uri);
+static bool sendPartition(PartitionReader& reader, uint8_t* buffer);
+
+/* The class is defined after the prototypes, because it uses them. */
+
+/**
+ * Request handler, which serves the partition downloads. The partition
+ * label is part of the URI, e.g. /partition/coredump.
+ */
+class PartitionDownloadHandler : public RequestHandler
+{
+public:
+
+    /**
+     * Can the request be handled?
+     *
+     * @param[in] server    Web server instance.
+     * @param[in] method    HTTP method.
+     * @param[in] uri       Request URI.
+     *
+     * @return If the URI is a partition download, it will return true otherwise false.
+     */
+    bool canHandle(WebServer& server, HTTPMethod method, const String& uri) override
+    {
+        (void)server;
+
+        return isPartitionDownload(method, uri);
+    }
+
+    /**
+     * Handle the request by sending the partition.
+     *
+     * @param[in] server        Web server instance.
+     * @param[in] requestMethod HTTP method.
+     * @param[in] requestUri    Request URI.
+     *
+     * @return If the request was handled, it will return true otherwise false.
+     */
+    bool handle(WebServer& server, HTTPMethod requestMethod, const String& requestUri) override
+    {
+        bool isHandled = false;
+
+        (void)server;
+
+        if (true == isPartitionDownload(requestMethod, requestUri))
+        {
+            handlePartitionDownload(requestUri);
+            isHandled = true;
+        }
+
+        return isHandled;
+    }
+};
 
 /******************************************************************************
  * Local Variables
@@ -140,18 +137,21 @@ static void handleFileEnd(HTTPUpload& upload);
 /**
  * Tag for logging purposes.
  */
-static const char LOG_TAG[] = "MyWebServer";
+static const char LOG_TAG[]              = "MyWebServer";
 
 /**
  * Web server instance.
  */
 static WebServer gWebServer(80U);
 
-/** Firmware binary size HTTP request header. */
-static const char FIRMWARE_SIZE_HEADER[]   = "X-File-Size-Firmware";
+/** If-None-Match HTTP request header, with the entity tags of the browser cached files. */
+static const char IF_NONE_MATCH_HEADER[] = "If-None-Match";
+
+/** Range HTTP request header of a partition download. */
+static const char RANGE_HEADER[]         = "Range";
 
-/** Filesystem binary size HTTP request header.  */
-static const char FILESYSTEM_SIZE_HEADER[] = "X-File-Size-Filesystem";
+/** URI prefix of a partition download, followed by the partition label. */
+static const char PARTITION_URI_PREFIX[] = "/partition/";
 
 /******************************************************************************
  * Public Methods
@@ -171,8 +171,18 @@ static const char FILESYSTEM_SIZE_HEADER[] = "X-File-Size-Filesystem";
 
 void MyWebServer::begin()
 {
-    const char* headerKeys[] = { FIRMWARE_SIZE_HEADER, FILESYSTEM_SIZE_HEADER };
-    size_t      keyCount     = sizeof(headerKeys) / sizeof(headerKeys[0]);
+    const char* headerKeys[] = {
+        UploadHandler::FIRMWARE_SIZE_HEADER,
+        UploadHandler::FILESYSTEM_SIZE_HEADER,
+        UploadHandler::CONTENT_LENGTH_HEADER,
+        UploadHandler::IMAGE_HASH_HEADER,
+        UploadHandler::CHUNK_OFFSET_HEADER,
+        UploadHandler::CHUNK_CRC32_HEADER,
+        UploadHandler::PRE_ERASE_HEADER,
+        IF_NONE_MATCH_HEADER,
+        RANGE_HEADER
+    };
+    size_t keyCount = sizeof(headerKeys) / sizeof(headerKeys[0]);
 
     /* Start the web server, before configuration! */
     gWebServer.begin();
@@ -180,6 +190,11 @@ void MyWebServer::begin()
     /* Webserver only keeps headers that are specified through collectHeaders(). */
     gWebServer.collectHeaders(headerKeys, keyCount);
 
+    /* Don't sleep in handleClient() while waiting for request data, because the
+     * loop() task waits for events instead.
+     */
+    gWebServer.enableDelay(false);
+
     /* Configure web server */
     gWebServer.onNotFound(
         []() {
@@ -187,39 +202,13 @@ void MyWebServer::begin()
             gWebServer.send(STATUS_CODE_FOUND, "text/plain", "");
         });
 
-    gWebServer.on("/", HTTP_GET, []() {
-        gWebServer.sendHeader("Location", "/index.html");
-        gWebServer.send(STATUS_CODE_FOUND, "text/plain", "");
-    });
-
     gWebServer.on("/change-partition", HTTP_GET, []() {
         switch (BootPartition::setApp0())
         {
-        case BootPartition::BOOT_SUCCESS: {
-            const uint32_t RESTART_DELAY = 100U; /* ms */
-
+        case BootPartition::BOOT_SUCCESS:
             gWebServer.send(STATUS_CODE_OK, "text/plain", "Partition switched. Restarting...");
-
-            /* To ensure that a positive response will be sent before the device restarts,
-             * a short delay is necessary.
-             */
-            delay(RESTART_DELAY);
-
-            /* Disconnect WiFi graceful before restart. */
-            if (WIFI_MODE_AP == WiFi.getMode())
-            {
-                /* In AP mode, stop the access point. */
-                (void)WiFi.softAPdisconnect();
-            }
-            else
-            {
-                /* In STA mode, disconnect from the access point. */
-                (void)WiFi.disconnect();
-            }
-
-            ESP.restart();
+            restart();
             break;
-        }
 
         case BootPartition::BOOT_PARTITION_NOT_FOUND:
             gWebServer.send(STATUS_CODE_INTERNAL_SERVER_ERROR, "text/plain", "App0 partition not found!");
@@ -235,36 +224,71 @@ void MyWebServer::begin()
         }
     });
 
-    gWebServer.on("/upload.html", HTTP_POST, handleUpload, handleFileUpload);
+    gWebServer.on("/upload.html", HTTP_POST, handleUploadResponse, handleFileUpload);
 
-    gWebServer.on("/partition-size", HTTP_GET, []() {
-        uint32_t size = 0U;
+    /* Raw binary uploads (application/octet-stream) skip the multipart parsing. */
+    gWebServer.on("/firmware", HTTP_PUT, handleUploadResponse, []() {
+        handleRawUpload(U_FLASH);
+    });
 
-        /* Firmware or filesystem? */
-        if (false == gWebServer.header(FIRMWARE_SIZE_HEADER).isEmpty())
-        {
-            const esp_partition_t* partition = esp_partition_find_first(
-                esp_partition_type_t::ESP_PARTITION_TYPE_APP,
-                esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_APP_OTA_0,
-                nullptr);
+    gWebServer.on("/filesystem", HTTP_PUT, handleUploadResponse, []() {
+        handleRawUpload(U_SPIFFS);
+    });
 
-            if (nullptr != partition)
-            {
-                size = partition->size;
-            }
-        }
-        else if (false == gWebServer.header(FILESYSTEM_SIZE_HEADER).isEmpty())
-        {
-            const esp_partition_t* partition = esp_partition_find_first(
-                esp_partition_type_t::ESP_PARTITION_TYPE_DATA,
-                esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
-                nullptr);
+    /* A bundle contains firmware and filesystem, see BundleParser. */
+    gWebServer.on("/bundle", HTTP_PUT, handleUploadResponse, []() {
+        handleRawUpload(UploadHandler::CMD_BUNDLE);
+    });
 
-            if (nullptr != partition)
-            {
-                size = partition->size;
-            }
-        }
+    /* The body of a pull request is the URL of the image, which the device downloads. */
+    gWebServer.on("/pull/firmware", HTTP_POST, []() {
+        handlePullUpdate(U_FLASH);
+    });
+
+    gWebServer.on("/pull/filesystem", HTTP_POST, []() {
+        handlePullUpdate(U_SPIFFS);
+    });
+
+    gWebServer.on("/pull-status", HTTP_GET, []() {
+        String json;
+
+        PullUpdate::getStatus(json);
+        gWebServer.send(STATUS_CODE_OK, "application/json", json);
+    });
+
+    gWebServer.on("/upload-status", HTTP_GET, []() {
+        String json;
+
+        UploadHandler::lock();
+        UploadHandler::getStatus(json);
+        UploadHandler::unlock();
+
+        gWebServer.send(STATUS_CODE_OK, "application/json", json);
+    });
+
+    gWebServer.on("/boot-trace", HTTP_GET, []() {
+        String text;
+
+        BootTrace::getTrace(text);
+        gWebServer.send(STATUS_CODE_OK, "text/plain", text);
+    });
+
+    gWebServer.on("/metrics", HTTP_GET, []() {
+        String text;
+
+        UploadMetrics::getMetrics(text);
+        gWebServer.send(STATUS_CODE_OK, "text/plain; version=0.0.4", text);
+    });
+
+    gWebServer.on("/partition-size", HTTP_GET, []() {
+        UploadHandler::Request request;
+        uint32_t               size = 0U;
+
+        getRequest(request);
+
+        UploadHandler::lock();
+        size = UploadHandler::getPartitionSize(request);
+        UploadHandler::unlock();
 
         if (0U != size)
         {
@@ -276,12 +300,36 @@ void MyWebServer::begin()
         }
     });
 
+    gWebServer.on("/partition-info", HTTP_GET, []() {
+        String json;
+
+        /* A pull update writes the partitions in its own task. */
+        UploadHandler::lock();
+        PartitionInfo::getInfo(json);
+        UploadHandler::unlock();
+
+        gWebServer.send(STATUS_CODE_OK, "application/json", json);
+    });
+
+    /* The handler is owned by the web server. */
+    gWebServer.addHandler(new PartitionDownloadHandler());
+
     EmbeddedFiles_setup(gWebServer);
+
+    BootTrace::mark("Embedded files setup");
 }
 
-void MyWebServer::handleClient()
+bool MyWebServer::handleClient()
 {
+    bool isChunkedUploadRunning = false;
+
     gWebServer.handleClient();
+
+    UploadHandler::lock();
+    isChunkedUploadRunning = UploadHandler::isChunkedUploadRunning();
+    UploadHandler::unlock();
+
+    return (true == gWebServer.client().connected()) || (true == isChunkedUploadRunning);
 }
 
 /******************************************************************************
@@ -289,139 +337,279 @@ void MyWebServer::handleClient()
  *****************************************************************************/
 
 /**
- * Handle upload requests.
- * This function is called when a file is uploaded to the web server.
- * It sends a response back to the client indicating that the upload was successful.
+ * Restart the device after disconnecting wifi graceful.
+ */
+static void restart()
+{
+    const uint32_t RESTART_DELAY = 100U; /* ms */
+
+    /* To ensure that a positive response will be sent before the device restarts,
+     * a short delay is necessary.
+     */
+    delay(RESTART_DELAY);
+
+    if (WIFI_MODE_AP == WiFi.getMode())
+    {
+        /* In AP mode, stop the access point. */
+        (void)WiFi.softAPdisconnect();
+    }
+    else
+    {
+        /* In STA mode, disconnect from the access point. */
+        (void)WiFi.disconnect();
+    }
+
+    ESP.restart();
+}
+
+/**
+ * Send the response of a form or raw upload request.
+ * This function is called after the whole request body was received.
+ * A bundle, which activated app0, restarts the device afterwards.
  */
-static void handleUpload()
+static void handleUploadResponse()
 {
-    gWebServer.send(STATUS_CODE_OK, "text/plain", "File upload successful.");
+    UploadHandler::Response response;
+    bool                    isRestartRequested = false;
+
+    UploadHandler::lock();
+    UploadHandler::getResponse(response);
+    isRestartRequested = UploadHandler::isRestartRequested();
+    UploadHandler::unlock();
+
+    if (true == response.hasUploadOffset)
+    {
+        gWebServer.sendHeader(UploadHandler::UPLOAD_OFFSET_HEADER, String(response.uploadOffset));
+    }
+
+    gWebServer.send(response.statusCode, "text/plain", response.message);
+
+    if (true == isRestartRequested)
+    {
+        restart();
+    }
 }
 
 /**
- * Handle file upload requests.
- * This function is called when a file is uploaded to the web server.
- * It logs the upload progress and sends a response back to the client.
+ * Handle form upload requests (multipart/form-data).
+ * The file data is passed chunk by chunk to the upload handler.
  */
 static void handleFileUpload()
 {
     HTTPUpload& upload = gWebServer.upload();
 
+    /* A pull or serial upload accesses the upload handler in its own task. */
+    UploadHandler::lock();
+
     if (UPLOAD_FILE_START == upload.status)
     {
-        handleFileStart(upload);
+        UploadHandler::Request request;
+
+        getRequest(request);
+        UploadHandler::beginForm(request, upload.filename.c_str());
     }
     else if (UPLOAD_FILE_WRITE == upload.status)
     {
-        handleFileWrite(upload);
+        UploadHandler::write(upload.buf, upload.currentSize);
     }
     else if (UPLOAD_FILE_END == upload.status)
     {
-        handleFileEnd(upload);
+        UploadHandler::end();
     }
     else
     {
-        ESP_LOGI(LOG_TAG, "File upload aborted: %s", upload.filename.c_str());
-        Update.abort();
-        gWebServer.send(STATUS_CODE_INTERNAL_SERVER_ERROR, "text/plain", "File upload aborted.");
+        UploadHandler::abort();
     }
+
+    UploadHandler::unlock();
 }
 
 /**
- * Handle start of a new file during file upload.
+ * Handle raw binary upload requests.
+ * The request body is passed chunk by chunk to the upload handler.
+ * The chunk size is defined by HTTP_RAW_BUFLEN.
  *
- * @param[in] upload Reference to the HTTPUpload object containing upload metadata.
+ * @param[in] cmd   U_FLASH for firmware, U_SPIFFS for filesystem or UploadHandler::CMD_BUNDLE.
  */
-static void handleFileStart(HTTPUpload& upload)
+static void handleRawUpload(int cmd)
 {
-    int    cmd      = U_FLASH;
-    size_t fileSize = UPDATE_SIZE_UNKNOWN;
-    String headerXFileSize;
+    HTTPRaw& raw = gWebServer.raw();
+
+    /* A pull or serial upload accesses the upload handler in its own task. */
+    UploadHandler::lock();
 
-    /* If there is a pending upload, abort it. */
-    if (true == Update.isRunning())
+    if (RAW_START == raw.status)
     {
-        Update.abort();
-        ESP_LOGW(LOG_TAG, "Aborted pending upload.");
-    }
+        UploadHandler::Request request;
 
-    /* Upload firmware or filesystem? */
-    if (false == gWebServer.header(FIRMWARE_SIZE_HEADER).isEmpty())
+        getRequest(request);
+        UploadHandler::beginRaw(request, cmd);
+    }
+    else if (RAW_WRITE == raw.status)
     {
-        headerXFileSize = gWebServer.header(FIRMWARE_SIZE_HEADER);
-        cmd             = U_FLASH;
+        UploadHandler::write(raw.buf, raw.currentSize);
     }
-    else if (false == gWebServer.header(FILESYSTEM_SIZE_HEADER).isEmpty())
+    else if (RAW_END == raw.status)
     {
-        headerXFileSize = gWebServer.header(FILESYSTEM_SIZE_HEADER);
-        cmd             = U_SPIFFS;
+        UploadHandler::end();
     }
     else
     {
-        ESP_LOGE(LOG_TAG, "Could not find %s or %s header. Cannot upload file!", FIRMWARE_SIZE_HEADER, FILESYSTEM_SIZE_HEADER);
-        gWebServer.send(STATUS_CODE_BAD_REQUEST, "text/plain", "Missing size header in request!");
+        UploadHandler::abort();
     }
 
-    /* File size available? */
-    if (false == headerXFileSize.isEmpty())
-    {
-        int32_t headerXFileSizeValue = headerXFileSize.toInt();
+    UploadHandler::unlock();
+}
 
-        if (0 < headerXFileSizeValue)
-        {
-            fileSize = static_cast<size_t>(headerXFileSizeValue);
+/**
+ * Handle pull update requests. The request body is the URL of the image.
+ *
+ * @param[in] cmd   U_FLASH for firmware or U_SPIFFS for filesystem.
+ */
+static void handlePullUpdate(int cmd)
+{
+    const char* error = nullptr;
+    String      url   = gWebServer.arg("plain");
 
-            ESP_LOGI(LOG_TAG, "File size from header: %u bytes", fileSize);
-        }
-    }
+    url.trim();
 
-    if (false == Update.begin(fileSize, cmd))
+    if (false == PullUpdate::start(url, cmd, gWebServer.header(UploadHandler::IMAGE_HASH_HEADER), error))
     {
-        ESP_LOGE(LOG_TAG, "Failed to begin file upload: %s", upload.filename.c_str());
-        gWebServer.send(STATUS_CODE_INTERNAL_SERVER_ERROR, "text/plain", "Failed to begin file upload.");
+        gWebServer.send(STATUS_CODE_BAD_REQUEST, "text/plain", error);
     }
     else
     {
-        ESP_LOGI(LOG_TAG, "File upload started: %s", upload.filename.c_str());
+        gWebServer.send(STATUS_CODE_ACCEPTED, "text/plain", "Download started.");
     }
 }
 
 /**
- * Handle writing new file data during file upload.
+ * Get the upload related headers of the current request.
+ *
+ * @param[out] request  Request headers
+ */
+static void getRequest(UploadHandler::Request& request)
+{
+    request.firmwareSize   = gWebServer.header(UploadHandler::FIRMWARE_SIZE_HEADER);
+    request.filesystemSize = gWebServer.header(UploadHandler::FILESYSTEM_SIZE_HEADER);
+    request.contentLength  = gWebServer.header(UploadHandler::CONTENT_LENGTH_HEADER);
+    request.imageHash      = gWebServer.header(UploadHandler::IMAGE_HASH_HEADER);
+    request.chunkOffset    = gWebServer.header(UploadHandler::CHUNK_OFFSET_HEADER);
+    request.chunkCrc       = gWebServer.header(UploadHandler::CHUNK_CRC32_HEADER);
+    request.preErase       = gWebServer.header(UploadHandler::PRE_ERASE_HEADER);
+}
+
+/**
+ * Is the request a partition download?
+ *
+ * @param[in] method    HTTP method
+ * @param[in] uri       Request URI
+ *
+ * @return If it is a partition download, it will return true otherwise false.
+ */
+static bool isPartitionDownload(HTTPMethod method, const String& uri)
+{
+    return (HTTP_GET == method) && (true == uri.startsWith(PARTITION_URI_PREFIX));
+}
+
+/**
+ * Handle a partition download request. The partition or the requested
+ * range of it is sent block by block.
  *
- * @param[in] upload Reference to the HTTPUpload object containing upload metadata.
+ * @param[in] uri   Request URI
  */
-static void handleFileWrite(HTTPUpload& upload)
+static void handlePartitionDownload(const String& uri)
 {
-    if (upload.currentSize != Update.write(upload.buf, upload.currentSize))
+    PartitionReader reader;
+    const char*     error      = nullptr;
+    String          label      = uri.substring(strlen(PARTITION_URI_PREFIX));
+    HTTPStatusCode  statusCode = reader.open(label, gWebServer.header(RANGE_HEADER), error);
+    String          contentRange;
+
+    reader.getContentRange(contentRange);
+
+    if (nullptr != error)
     {
-        ESP_LOGE(LOG_TAG, "Failed to write file upload: %s", upload.filename.c_str());
-        ESP_LOGE(LOG_TAG, "Upload error: %s", Update.errorString());
-        Update.abort();
-        gWebServer.send(STATUS_CODE_INTERNAL_SERVER_ERROR, "text/plain", "Failed to write file upload.");
+        if (STATUS_CODE_RANGE_NOT_SATISFIABLE == statusCode)
+        {
+            gWebServer.sendHeader("Content-Range", contentRange);
+        }
+
+        gWebServer.send(statusCode, "text/plain", error);
     }
     else
     {
-        ESP_LOGI(LOG_TAG, "File upload progress: %u bytes", upload.currentSize);
+        uint8_t* buffer = new (std::nothrow) uint8_t[PartitionReader::BLOCK_SIZE];
+
+        if (nullptr == buffer)
+        {
+            gWebServer.send(STATUS_CODE_INTERNAL_SERVER_ERROR, "text/plain", "Out of memory!");
+        }
+        else
+        {
+            gWebServer.sendHeader("Accept-Ranges", "bytes");
+            gWebServer.sendHeader("Content-Disposition", String("attachment; filename=\"") + reader.getLabel() + ".bin\"");
+
+            if (STATUS_CODE_PARTIAL_CONTENT == statusCode)
+            {
+                gWebServer.sendHeader("Content-Range", contentRange);
+            }
+
+            /* Send the headers only, the content follows. */
+            gWebServer.setContentLength(reader.getSize());
+            gWebServer.send(statusCode, "application/octet-stream", "");
+
+            if (false == sendPartition(reader, buffer))
+            {
+                ESP_LOGW(LOG_TAG, "Download of %s aborted.", reader.getLabel());
+            }
+
+            delete[] buffer;
+        }
     }
 }
 
 /**
- * Handle end of a file during file upload.
+ * Send the partition content block by block.
+ *
+ * @param[in] reader    Opened partition reader
+ * @param[in] buffer    Buffer with PartitionReader::BLOCK_SIZE bytes
  *
- * @param[in] upload Reference to the HTTPUpload object containing upload metadata.
+ * @return If all is sent, it will return true otherwise false.
  */
-static void handleFileEnd(HTTPUpload& upload)
+static bool sendPartition(PartitionReader& reader, uint8_t* buffer)
 {
-    if (false == Update.end())
-    {
-        ESP_LOGE(LOG_TAG, "Failed to end file upload: %s", upload.filename.c_str());
-        ESP_LOGE(LOG_TAG, "Upload error: %s", Update.errorString());
-        Update.abort();
-        gWebServer.send(STATUS_CODE_INTERNAL_SERVER_ERROR, "text/plain", "Failed to end file upload.");
-    }
-    else
+    WiFiClient& client       = gWebServer.client();
+    size_t      remaining    = reader.getSize();
+    bool        isSuccessful = true;
+
+    while ((0U < remaining) && (true == isSuccessful))
     {
-        ESP_LOGI(LOG_TAG, "File upload finished: %s (%u bytes)", upload.filename.c_str(), upload.totalSize);
+        size_t size   = reader.read(buffer, PartitionReader::BLOCK_SIZE);
+        size_t offset = 0U;
+
+        /* Nothing read on a flash error. */
+        isSuccessful = (0U < size);
+
+        while ((size > offset) && (true == isSuccessful))
+        {
+            size_t written = client.write(&buffer[offset], size - offset);
+
+            /* Nothing written, if the connection is lost or the send timeout elapsed. */
+            if (0U == written)
+            {
+                isSuccessful = false;
+            }
+            else
+            {
+                offset += written;
+            }
+        }
+
+        remaining -= offset;
     }
+
+    return isSuccessful;
 }
+
+#endif /* (0 == CONFIG_WEB_SERVER_ASYNC) */
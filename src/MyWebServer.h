@@ -41,6 +41,17 @@
  * Compile Switches
  *****************************************************************************/
 
+#ifndef CONFIG_WEB_SERVER_ASYNC
+
+/**
+ * Select the web server backend:
+ * 0: Arduino WebServer, which serves one request after another in the loop() task.
+ * 1: ESP-IDF HTTP server, which serves concurrent requests in its own task.
+ */
+#define CONFIG_WEB_SERVER_ASYNC (0)
+
+#endif /* CONFIG_WEB_SERVER_ASYNC */
+
 /******************************************************************************
  * Includes
  *****************************************************************************/
@@ -69,9 +80,12 @@ namespace MyWebServer
     void begin();
 
     /**
-     * Handle client requests.
+     * Handle client requests. It doesn't wait for a request, the caller
+     * decides how long to sleep until the next call.
+     *
+     * @return If a client is connected or a chunked upload is in progress, it will return true otherwise false.
      */
-    void handleClient();
+    bool handleClient();
 
 } /* namespace MyWebServer */
 
@@ -0,0 +1,1241 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   MyWebServerAsync.cpp
+ * @brief  The web server with its pages and handlers, based on the ESP-IDF HTTP server.
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "MyWebServer.h"
+
+#if (0 != CONFIG_WEB_SERVER_ASYNC)
+
+#include <Arduino.h>
+#include <Update.h>
+#include <WiFi.h>
+
+#include <esp_http_server.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <new>
+
+#include "EmbeddedFiles.h"
+#include "BootPartition.h"
+#include "BootTrace.h"
+#include "HttpStatus.h"
+#include "PartitionInfo.h"
+#include "PartitionReader.h"
+#include "PullUpdate.h"
+#include "UploadHandler.h"
+#include "UploadMetrics.h"
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/**
+ * Target of an upload request, which is the user context of its URI handler.
+ */
+typedef struct
+{
+    int  cmd;    /**< U_FLASH for firmware, U_SPIFFS for filesystem or UploadHandler::CMD_BUNDLE. Not used by form uploads. */
+    bool isForm; /**< Is it a form upload (multipart/form-data)? */
+
+} UploadTarget;
+
+/**
+ * State of the multipart/form-data parser.
+ */
+typedef enum
+{
+    MULTIPART_STATE_HEADER = 0, /**< Receiving the headers of the file part. */
+    MULTIPART_STATE_DATA,       /**< Receiving the file data. */
+    MULTIPART_STATE_DONE,       /**< File data completely received. */
+    MULTIPART_STATE_ERROR       /**< Invalid body */
+
+} MultipartState;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void restart();
+static esp_err_t handleChangePartition(httpd_req_t* req);
+static esp_err_t handlePullUpdate(httpd_req_t* req);
+static esp_err_t handlePullStatus(httpd_req_t* req);
+static esp_err_t handleUploadStatus(httpd_req_t* req);
+static esp_err_t handleMetrics(httpd_req_t* req);
+static esp_err_t handleBootTrace(httpd_req_t* req);
+static esp_err_t handlePartitionSize(httpd_req_t* req);
+static esp_err_t handlePartitionInfo(httpd_req_t* req);
+static esp_err_t handlePartitionDownload(httpd_req_t* req);
+static esp_err_t handleUpload(httpd_req_t* req);
+static esp_err_t handleEmbeddedFile(httpd_req_t* req);
+static esp_err_t handleNotFound(httpd_req_t* req, httpd_err_code_t error);
+static void uploadTask(void* parameters);
+static void processRawUpload(httpd_req_t* req, int cmd);
+static void processFormUpload(httpd_req_t* req);
+static void parseFormData(const uint8_t* data, size_t size, const UploadHandler::Request& request);
+static bool beginMultipart(httpd_req_t* req);
+static int receive(httpd_req_t* req, uint8_t* buffer, size_t size);
+static void sendUploadResponse(httpd_req_t* req);
+static void sendText(httpd_req_t* req, HTTPStatusCode statusCode, const char* text);
+static void sendRedirect(httpd_req_t* req, const char* location);
+static const char* getStatusLine(HTTPStatusCode statusCode);
+static void getHeader(httpd_req_t* req, const char* name, String& value);
+static void getRequest(httpd_req_t* req, UploadHandler::Request& request);
+static const uint8_t* findSequence(const uint8_t* data, size_t size, const uint8_t* sequence, size_t sequenceSize);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char LOG_TAG[]                        = "MyWebServer";
+
+/** HTTP server port. */
+static const uint16_t HTTP_PORT                    = 80U;
+
+/** HTTP server task stack size in byte. */
+static const size_t HTTPD_STACK_SIZE               = 6144U;
+
+/** Max. number of concurrent client connections. The least recently used one is closed, if exceeded. */
+static const uint16_t HTTPD_MAX_OPEN_SOCKETS       = 7U;
+
+/** Max. number of URI handlers. */
+static const uint16_t HTTPD_MAX_URI_HANDLERS       = 16U;
+
+/** Upload task stack size in byte. */
+static const uint32_t UPLOAD_TASK_STACK_SIZE       = 4096U;
+
+/** Upload task priority. Same as the OTA writer task, higher than the loop() task, but lower than the network tasks. */
+static const UBaseType_t UPLOAD_TASK_PRIORITY      = 2U;
+
+/** Max. number of upload requests, which wait for the upload task. */
+static const UBaseType_t UPLOAD_QUEUE_LENGTH       = 2U;
+
+/** Receive buffer size in byte. */
+static const size_t RECV_BUFFER_SIZE               = 4096U;
+
+/** Number of receive timeouts in a row, after that an upload is aborted. */
+static const uint8_t RECV_TIMEOUT_RETRIES          = 3U;
+
+/** Max. size of a request header value incl. string termination. Longer values are ignored. */
+static const size_t HEADER_VALUE_SIZE              = 128U;
+
+/** Max. size of the headers of the multipart file part in byte. */
+static const size_t MULTIPART_HEADER_MAX_SIZE      = 1024U;
+
+/** Max. size of the multipart delimiter "\r\n--<boundary>". The boundary has max. 70 characters (RFC 2046). */
+static const size_t MULTIPART_DELIMITER_MAX_SIZE   = 74U;
+
+/** If-None-Match HTTP request header, with the entity tags of the browser cached files. */
+static const char IF_NONE_MATCH_HEADER[]           = "If-None-Match";
+
+/** Range HTTP request header of a partition download. */
+static const char RANGE_HEADER[]                   = "Range";
+
+/** URI prefix of a partition download, followed by the partition label. */
+static const char PARTITION_URI_PREFIX[]           = "/partition/";
+
+/** Upload target of the firmware raw upload. */
+static UploadTarget gFirmwareTarget                = { U_FLASH, false };
+
+/** Upload target of the filesystem raw upload. */
+static UploadTarget gFilesystemTarget              = { U_SPIFFS, false };
+
+/** Upload target of the bundle raw upload. */
+static UploadTarget gBundleTarget                  = { UploadHandler::CMD_BUNDLE, false };
+
+/** Upload target of the form upload. */
+static UploadTarget gFormTarget                    = { U_FLASH, true };
+
+/** HTTP server handle */
+static httpd_handle_t gHttpServer                  = nullptr;
+
+/** Upload requests, which are handed over from the HTTP server task to the upload task. */
+static QueueHandle_t gUploadQueue                  = nullptr;
+
+/** Receive buffer of the upload task. */
+static uint8_t gRecvBuffer[RECV_BUFFER_SIZE];
+
+/** State of the multipart parser. */
+static MultipartState gMultipartState              = MULTIPART_STATE_HEADER;
+
+/** Multipart delimiter, which ends the file data. */
+static uint8_t gMultipartDelimiter[MULTIPART_DELIMITER_MAX_SIZE];
+
+/** Multipart delimiter length in byte. */
+static size_t gMultipartDelimiterLen               = 0U;
+
+/** Headers of the multipart file part. */
+static char gMultipartHeader[MULTIPART_HEADER_MAX_SIZE];
+
+/** Length of the received multipart file part headers. */
+static size_t gMultipartHeaderLen                  = 0U;
+
+/**
+ * Received file data, which is searched for the delimiter. It starts with the
+ * tail of the previous data, which may be the begin of the delimiter.
+ */
+static uint8_t gMultipartData[RECV_BUFFER_SIZE + MULTIPART_DELIMITER_MAX_SIZE];
+
+/** Length of the tail in the multipart data buffer. */
+static size_t gMultipartTailLen                    = 0U;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+void MyWebServer::begin()
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+
+    config.server_port      = HTTP_PORT;
+    config.stack_size       = HTTPD_STACK_SIZE;
+    config.max_open_sockets = HTTPD_MAX_OPEN_SOCKETS;
+    config.max_uri_handlers = HTTPD_MAX_URI_HANDLERS;
+    config.lru_purge_enable = true;
+    config.uri_match_fn     = httpd_uri_match_wildcard;
+
+    gUploadQueue            = xQueueCreate(UPLOAD_QUEUE_LENGTH, sizeof(httpd_req_t*));
+
+    if (nullptr == gUploadQueue)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create upload queue.");
+    }
+    else if (pdPASS != xTaskCreatePinnedToCore(uploadTask, "upload", UPLOAD_TASK_STACK_SIZE, nullptr, UPLOAD_TASK_PRIORITY, nullptr, tskNO_AFFINITY))
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create upload task.");
+    }
+    else if (ESP_OK != httpd_start(&gHttpServer, &config))
+    {
+        ESP_LOGE(LOG_TAG, "Failed to start HTTP server.");
+    }
+    else
+    {
+        /* The wildcard handler of the embedded files must be the last one, because
+         * the handlers are matched in the order of registration.
+         */
+        const httpd_uri_t handlers[] = {
+            { "/change-partition", HTTP_GET, handleChangePartition, nullptr },
+            { "/upload.html", HTTP_POST, handleUpload, &gFormTarget },
+            { "/firmware", HTTP_PUT, handleUpload, &gFirmwareTarget },
+            { "/filesystem", HTTP_PUT, handleUpload, &gFilesystemTarget },
+            { "/bundle", HTTP_PUT, handleUpload, &gBundleTarget },
+            { "/pull/firmware", HTTP_POST, handlePullUpdate, &gFirmwareTarget },
+            { "/pull/filesystem", HTTP_POST, handlePullUpdate, &gFilesystemTarget },
+            { "/pull-status", HTTP_GET, handlePullStatus, nullptr },
+            { "/upload-status", HTTP_GET, handleUploadStatus, nullptr },
+            { "/metrics", HTTP_GET, handleMetrics, nullptr },
+            { "/boot-trace", HTTP_GET, handleBootTrace, nullptr },
+            { "/partition-size", HTTP_GET, handlePartitionSize, nullptr },
+            { "/partition-info", HTTP_GET, handlePartitionInfo, nullptr },
+            { "/partition/*", HTTP_GET, handlePartitionDownload, nullptr },
+            { "/*", HTTP_GET, handleEmbeddedFile, nullptr }
+        };
+        size_t idx = 0U;
+
+        for (idx = 0U; (sizeof(handlers) / sizeof(handlers[0])) > idx; ++idx)
+        {
+            if (ESP_OK != httpd_register_uri_handler(gHttpServer, &handlers[idx]))
+            {
+                ESP_LOGE(LOG_TAG, "Failed to register handler for %s.", handlers[idx].uri);
+            }
+        }
+
+        (void)httpd_register_err_handler(gHttpServer, HTTPD_404_NOT_FOUND, handleNotFound);
+    }
+}
+
+bool MyWebServer::handleClient()
+{
+    /* The requests are served by the HTTP server task. */
+    return false;
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * Restart the device after disconnecting wifi graceful.
+ */
+static void restart()
+{
+    const uint32_t RESTART_DELAY = 100U; /* ms */
+
+    /* To ensure that a positive response will be sent before the device restarts,
+     * a short delay is necessary.
+     */
+    delay(RESTART_DELAY);
+
+    if (WIFI_MODE_AP == WiFi.getMode())
+    {
+        /* In AP mode, stop the access point. */
+        (void)WiFi.softAPdisconnect();
+    }
+    else
+    {
+        /* In STA mode, disconnect from the access point. */
+        (void)WiFi.disconnect();
+    }
+
+    ESP.restart();
+}
+
+/**
+ * Handle the request to switch to the app0 partition and restart.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleChangePartition(httpd_req_t* req)
+{
+    switch (BootPartition::setApp0())
+    {
+    case BootPartition::BOOT_SUCCESS:
+        sendText(req, STATUS_CODE_OK, "Partition switched. Restarting...");
+        restart();
+        break;
+
+    case BootPartition::BOOT_PARTITION_NOT_FOUND:
+        sendText(req, STATUS_CODE_INTERNAL_SERVER_ERROR, "App0 partition not found!");
+        break;
+
+    case BootPartition::BOOT_SET_FAILED:
+        sendText(req, STATUS_CODE_INTERNAL_SERVER_ERROR, "Failed to set app0 partition as boot partition!");
+        break;
+
+    case BootPartition::BOOT_UNKNOWN_ERROR:
+    default:
+        sendText(req, STATUS_CODE_INTERNAL_SERVER_ERROR, "Cannot switch to app0 partition. Error unknown!");
+        break;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * Handle the upload status request.
+ * It is served while an upload is running.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleUploadStatus(httpd_req_t* req)
+{
+    String json;
+
+    UploadHandler::lock();
+    UploadHandler::getStatus(json);
+    UploadHandler::unlock();
+
+    (void)httpd_resp_set_type(req, "application/json");
+    (void)httpd_resp_send(req, json.c_str(), json.length());
+
+    return ESP_OK;
+}
+
+/**
+ * Handle a pull update request. The request body is the URL of the image,
+ * which is downloaded by the pull update task.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection, otherwise ESP_FAIL to close it.
+ */
+static esp_err_t handlePullUpdate(httpd_req_t* req)
+{
+    esp_err_t           result = ESP_OK;
+    const UploadTarget* target = static_cast<const UploadTarget*>(req->user_ctx);
+    char                body[PullUpdate::URL_MAX_LENGTH + 1U];
+    size_t              len    = 0U;
+
+    if (PullUpdate::URL_MAX_LENGTH < req->content_len)
+    {
+        sendText(req, STATUS_CODE_PAYLOAD_TOO_LARGE, "URL too long.");
+        result = ESP_FAIL;
+    }
+    else
+    {
+        while ((ESP_OK == result) && (req->content_len > len))
+        {
+            int received = receive(req, reinterpret_cast<uint8_t*>(&body[len]), req->content_len - len);
+
+            if (0 >= received)
+            {
+                result = ESP_FAIL;
+            }
+            else
+            {
+                len += static_cast<size_t>(received);
+            }
+        }
+    }
+
+    if (ESP_OK == result)
+    {
+        const char* error = nullptr;
+        String      url;
+        String      imageHash;
+
+        body[len] = '\0';
+        url       = body;
+        url.trim();
+
+        getHeader(req, UploadHandler::IMAGE_HASH_HEADER, imageHash);
+
+        if (false == PullUpdate::start(url, target->cmd, imageHash, error))
+        {
+            sendText(req, STATUS_CODE_BAD_REQUEST, error);
+        }
+        else
+        {
+            sendText(req, STATUS_CODE_ACCEPTED, "Download started.");
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Handle the pull update status request.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handlePullStatus(httpd_req_t* req)
+{
+    String json;
+
+    PullUpdate::getStatus(json);
+
+    (void)httpd_resp_set_type(req, "application/json");
+    (void)httpd_resp_send(req, json.c_str(), json.length());
+
+    return ESP_OK;
+}
+
+/**
+ * Handle the metrics request.
+ * It is served while an upload is running, without waiting for the upload
+ * handler, otherwise a busy flash would delay it.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleMetrics(httpd_req_t* req)
+{
+    String text;
+
+    UploadMetrics::getMetrics(text);
+
+    (void)httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    (void)httpd_resp_send(req, text.c_str(), text.length());
+
+    return ESP_OK;
+}
+
+/**
+ * Handle the boot trace request.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleBootTrace(httpd_req_t* req)
+{
+    String text;
+
+    BootTrace::getTrace(text);
+
+    (void)httpd_resp_set_type(req, "text/plain");
+    (void)httpd_resp_send(req, text.c_str(), text.length());
+
+    return ESP_OK;
+}
+
+/**
+ * Handle the partition size request.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handlePartitionSize(httpd_req_t* req)
+{
+    UploadHandler::Request request;
+    uint32_t               size = 0U;
+
+    getRequest(req, request);
+
+    UploadHandler::lock();
+    size = UploadHandler::getPartitionSize(request);
+    UploadHandler::unlock();
+
+    if (0U != size)
+    {
+        sendText(req, STATUS_CODE_OK, String(size).c_str());
+    }
+    else
+    {
+        sendText(req, STATUS_CODE_INTERNAL_SERVER_ERROR, "Partition not found!");
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * Handle the partition info request.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handlePartitionInfo(httpd_req_t* req)
+{
+    String json;
+
+    UploadHandler::lock();
+    PartitionInfo::getInfo(json);
+    UploadHandler::unlock();
+
+    (void)httpd_resp_set_type(req, "application/json");
+    (void)httpd_resp_send(req, json.c_str(), json.length());
+
+    return ESP_OK;
+}
+
+/**
+ * Handle a partition download request. The partition or the requested
+ * range of it is sent block by block with chunked transfer encoding.
+ * The HTTP server task is busy until the download is finished.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection, otherwise ESP_FAIL to close it.
+ */
+static esp_err_t handlePartitionDownload(httpd_req_t* req)
+{
+    esp_err_t       result     = ESP_OK;
+    const char*     query      = strchr(req->uri, '?');
+    size_t          len        = (nullptr == query) ? strlen(req->uri) : static_cast<size_t>(query - req->uri);
+    String          label      = String(req->uri).substring(strlen(PARTITION_URI_PREFIX), len);
+    PartitionReader reader;
+    const char*     error      = nullptr;
+    HTTPStatusCode  statusCode = STATUS_CODE_OK;
+    String          range;
+    String          contentRange;
+    String          contentDisposition;
+
+    getHeader(req, RANGE_HEADER, range);
+    statusCode = reader.open(label, range, error);
+    reader.getContentRange(contentRange);
+
+    if (nullptr != error)
+    {
+        if (STATUS_CODE_RANGE_NOT_SATISFIABLE == statusCode)
+        {
+            (void)httpd_resp_set_hdr(req, "Content-Range", contentRange.c_str());
+        }
+
+        sendText(req, statusCode, error);
+    }
+    else
+    {
+        uint8_t* buffer = new (std::nothrow) uint8_t[PartitionReader::BLOCK_SIZE];
+
+        if (nullptr == buffer)
+        {
+            sendText(req, STATUS_CODE_INTERNAL_SERVER_ERROR, "Out of memory!");
+        }
+        else
+        {
+            size_t size = 0U;
+
+            contentDisposition  = "attachment; filename=\"";
+            contentDisposition += reader.getLabel();
+            contentDisposition += ".bin\"";
+
+            (void)httpd_resp_set_status(req, getStatusLine(statusCode));
+            (void)httpd_resp_set_type(req, "application/octet-stream");
+            (void)httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+            (void)httpd_resp_set_hdr(req, "Content-Disposition", contentDisposition.c_str());
+
+            if (STATUS_CODE_PARTIAL_CONTENT == statusCode)
+            {
+                (void)httpd_resp_set_hdr(req, "Content-Range", contentRange.c_str());
+            }
+
+            do
+            {
+                size = reader.read(buffer, PartitionReader::BLOCK_SIZE);
+
+                if ((0U < size) && (ESP_OK != httpd_resp_send_chunk(req, reinterpret_cast<const char*>(buffer), size)))
+                {
+                    result = ESP_FAIL;
+                }
+            }
+            while ((0U < size) && (ESP_OK == result));
+
+            /* A flash error or a lost connection ends the download early. The client
+             * detects it by the missing final chunk, therefore it is not sent.
+             */
+            if (ESP_OK != result)
+            {
+                ESP_LOGW(LOG_TAG, "Download of %s aborted.", reader.getLabel());
+            }
+            else
+            {
+                (void)httpd_resp_send_chunk(req, nullptr, 0);
+            }
+
+            delete[] buffer;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Handle an upload request. It is handed over to the upload task, so the
+ * HTTP server task continues to serve the other clients, while the request
+ * body is received.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleUpload(httpd_req_t* req)
+{
+    httpd_req_t* asyncReq = nullptr;
+
+    if (ESP_OK != httpd_req_async_handler_begin(req, &asyncReq))
+    {
+        sendText(req, STATUS_CODE_INTERNAL_SERVER_ERROR, "Failed to begin file upload.");
+    }
+    else if (pdTRUE != xQueueSend(gUploadQueue, &asyncReq, 0U))
+    {
+        sendText(asyncReq, STATUS_CODE_SERVICE_UNAVAILABLE, "Upload in progress.");
+        (void)httpd_req_async_handler_complete(asyncReq);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * Handle the request of an embedded file. The root is served by the
+ * root page directly. Unknown files are redirected to the root.
+ *
+ * @param[in] req   Request
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleEmbeddedFile(httpd_req_t* req)
+{
+    const char*         query = strchr(req->uri, '?');
+    size_t              len   = (nullptr == query) ? strlen(req->uri) : static_cast<size_t>(query - req->uri);
+    const EmbeddedFile* file  = EmbeddedFiles_find(req->uri, len);
+
+    if (nullptr == file)
+    {
+        sendRedirect(req, "/");
+    }
+    else
+    {
+        const char* etag = file->getETag();
+        String      ifNoneMatch;
+
+        getHeader(req, IF_NONE_MATCH_HEADER, ifNoneMatch);
+
+        (void)httpd_resp_set_type(req, file->getMimeType());
+        (void)httpd_resp_set_hdr(req, "ETag", etag);
+        (void)httpd_resp_set_hdr(req, "Cache-Control", file->getCacheControl());
+
+        /* Browser has the same content already cached? */
+        if ((ifNoneMatch == "*") || (0 <= ifNoneMatch.indexOf(etag)))
+        {
+            (void)httpd_resp_set_status(req, getStatusLine(STATUS_CODE_NOT_MODIFIED));
+            (void)httpd_resp_send(req, nullptr, 0);
+        }
+        else
+        {
+            size_t         size    = 0U;
+            const uint8_t* content = file->getFile(&size);
+
+            if (true == file->isCompressed())
+            {
+                (void)httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+            }
+
+            (void)httpd_resp_send(req, reinterpret_cast<const char*>(content), size);
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * Handle requests with unknown URI, which are redirected to the root.
+ *
+ * @param[in] req   Request
+ * @param[in] error Error code
+ *
+ * @return ESP_OK to keep the connection.
+ */
+static esp_err_t handleNotFound(httpd_req_t* req, httpd_err_code_t error)
+{
+    (void)error;
+
+    sendRedirect(req, "/");
+
+    return ESP_OK;
+}
+
+/**
+ * The upload task receives the body of the upload requests one after another.
+ *
+ * @param[in] parameters    Task parameters (not used)
+ */
+static void uploadTask(void* parameters)
+{
+    (void)parameters;
+
+    for (;;)
+    {
+        httpd_req_t* req = nullptr;
+
+        if (pdTRUE == xQueueReceive(gUploadQueue, &req, portMAX_DELAY))
+        {
+            const UploadTarget* target = static_cast<const UploadTarget*>(req->user_ctx);
+
+            if (true == target->isForm)
+            {
+                processFormUpload(req);
+            }
+            else
+            {
+                processRawUpload(req, target->cmd);
+            }
+
+            (void)httpd_req_async_handler_complete(req);
+        }
+    }
+}
+
+/**
+ * Receive the body of a raw upload request and pass it to the upload handler.
+ *
+ * @param[in] req   Request
+ * @param[in] cmd   U_FLASH for firmware, U_SPIFFS for filesystem or UploadHandler::CMD_BUNDLE.
+ */
+static void processRawUpload(httpd_req_t* req, int cmd)
+{
+    UploadHandler::Request request;
+    size_t                 remaining = req->content_len;
+    bool                   isAborted = false;
+
+    getRequest(req, request);
+
+    UploadHandler::lock();
+    UploadHandler::beginRaw(request, cmd);
+    UploadHandler::unlock();
+
+    while ((0U < remaining) && (false == isAborted))
+    {
+        int len = receive(req, gRecvBuffer, (RECV_BUFFER_SIZE < remaining) ? RECV_BUFFER_SIZE : remaining);
+
+        UploadHandler::lock();
+
+        if (0 >= len)
+        {
+            UploadHandler::abort();
+            isAborted = true;
+        }
+        else
+        {
+            UploadHandler::write(gRecvBuffer, static_cast<size_t>(len));
+            remaining -= static_cast<size_t>(len);
+        }
+
+        UploadHandler::unlock();
+    }
+
+    /* The connection is lost, therefore no response. */
+    if (false == isAborted)
+    {
+        UploadHandler::lock();
+        UploadHandler::end();
+        UploadHandler::unlock();
+
+        sendUploadResponse(req);
+    }
+}
+
+/**
+ * Receive the body of a form upload request (multipart/form-data) and pass
+ * the data of its first part to the upload handler.
+ *
+ * @param[in] req   Request
+ */
+static void processFormUpload(httpd_req_t* req)
+{
+    UploadHandler::Request request;
+    size_t                 remaining = req->content_len;
+    bool                   isAborted = false;
+
+    getRequest(req, request);
+
+    if (false == beginMultipart(req))
+    {
+        sendText(req, STATUS_CODE_BAD_REQUEST, "Missing multipart boundary.");
+    }
+    else
+    {
+        while ((0U < remaining) && (false == isAborted))
+        {
+            int len = receive(req, gRecvBuffer, (RECV_BUFFER_SIZE < remaining) ? RECV_BUFFER_SIZE : remaining);
+
+            if (0 >= len)
+            {
+                isAborted = true;
+            }
+            else
+            {
+                parseFormData(gRecvBuffer, static_cast<size_t>(len), request);
+                remaining -= static_cast<size_t>(len);
+            }
+        }
+
+        /* The file data ended without delimiter, therefore the image is incomplete. */
+        if (MULTIPART_STATE_DATA == gMultipartState)
+        {
+            UploadHandler::lock();
+            UploadHandler::abort();
+            UploadHandler::unlock();
+        }
+
+        /* The connection is lost, therefore no response. */
+        if (true == isAborted)
+        {
+            ESP_LOGI(LOG_TAG, "Form upload aborted.");
+        }
+        else if (MULTIPART_STATE_DONE == gMultipartState)
+        {
+            sendUploadResponse(req);
+        }
+        else
+        {
+            sendText(req, STATUS_CODE_BAD_REQUEST, "Invalid multipart body.");
+        }
+    }
+}
+
+/**
+ * Parse received multipart/form-data. The file data of the first part is
+ * passed to the upload handler, until the delimiter is found. A tail of the
+ * data, which may be the begin of the delimiter, is kept for the next call.
+ *
+ * @param[in] data      Received data
+ * @param[in] size      Data size in byte
+ * @param[in] request   Request headers
+ */
+static void parseFormData(const uint8_t* data, size_t size, const UploadHandler::Request& request)
+{
+    static const uint8_t HEADER_END[] = { '\r', '\n', '\r', '\n' };
+    size_t               idx          = 0U;
+
+    /* The headers of the part end with an empty line. */
+    while ((MULTIPART_STATE_HEADER == gMultipartState) && (size > idx))
+    {
+        if (MULTIPART_HEADER_MAX_SIZE <= (gMultipartHeaderLen + 1U))
+        {
+            gMultipartState = MULTIPART_STATE_ERROR;
+        }
+        else
+        {
+            gMultipartHeader[gMultipartHeaderLen] = static_cast<char>(data[idx]);
+            ++gMultipartHeaderLen;
+
+            if ((sizeof(HEADER_END) <= gMultipartHeaderLen) &&
+                (0 == memcmp(&gMultipartHeader[gMultipartHeaderLen - sizeof(HEADER_END)], HEADER_END, sizeof(HEADER_END))))
+            {
+                const char* fileName = nullptr;
+                const char* end      = nullptr;
+
+                gMultipartHeader[gMultipartHeaderLen] = '\0';
+
+                /* The file name is only used for logging. */
+                fileName                              = strstr(gMultipartHeader, "filename=\"");
+
+                if (nullptr != fileName)
+                {
+                    fileName += strlen("filename=\"");
+                    end       = strchr(fileName, '"');
+
+                    if (nullptr != end)
+                    {
+                        *const_cast<char*>(end) = '\0';
+                    }
+                }
+
+                UploadHandler::lock();
+                UploadHandler::beginForm(request, (nullptr == fileName) ? "" : fileName);
+                UploadHandler::unlock();
+
+                gMultipartState = MULTIPART_STATE_DATA;
+            }
+        }
+
+        ++idx;
+    }
+
+    if ((MULTIPART_STATE_DATA == gMultipartState) && (size > idx))
+    {
+        size_t         dataLen   = gMultipartTailLen + (size - idx);
+        const uint8_t* delimiter = nullptr;
+
+        memcpy(&gMultipartData[gMultipartTailLen], &data[idx], size - idx);
+
+        delimiter = findSequence(gMultipartData, dataLen, gMultipartDelimiter, gMultipartDelimiterLen);
+
+        UploadHandler::lock();
+
+        if (nullptr != delimiter)
+        {
+            UploadHandler::write(gMultipartData, static_cast<size_t>(delimiter - gMultipartData));
+            UploadHandler::end();
+
+            gMultipartState = MULTIPART_STATE_DONE;
+        }
+        else
+        {
+            /* Keep a tail, which may be the begin of the delimiter. */
+            size_t tailLen = (dataLen < gMultipartDelimiterLen) ? dataLen : (gMultipartDelimiterLen - 1U);
+
+            UploadHandler::write(gMultipartData, dataLen - tailLen);
+
+            memmove(gMultipartData, &gMultipartData[dataLen - tailLen], tailLen);
+            gMultipartTailLen = tailLen;
+        }
+
+        UploadHandler::unlock();
+    }
+}
+
+/**
+ * Prepare the multipart parser for a new request. The delimiter is derived
+ * from the boundary of the content type header.
+ *
+ * @param[in] req   Request
+ *
+ * @return If the boundary is valid, it will return true otherwise false.
+ */
+static bool beginMultipart(httpd_req_t* req)
+{
+    bool   isSuccessful = false;
+    String contentType;
+    String boundary;
+    int    idx          = -1;
+
+    getHeader(req, "Content-Type", contentType);
+
+    idx = contentType.indexOf("boundary=");
+
+    gMultipartState        = MULTIPART_STATE_HEADER;
+    gMultipartHeaderLen    = 0U;
+    gMultipartTailLen      = 0U;
+    gMultipartDelimiterLen = 0U;
+
+    if (0 <= idx)
+    {
+        boundary = contentType.substring(idx + strlen("boundary="));
+
+        /* The boundary may be quoted. */
+        boundary.replace("\"", "");
+
+        if ((false == boundary.isEmpty()) && ((MULTIPART_DELIMITER_MAX_SIZE - 4U) >= boundary.length()))
+        {
+            gMultipartDelimiter[0] = '\r';
+            gMultipartDelimiter[1] = '\n';
+            gMultipartDelimiter[2] = '-';
+            gMultipartDelimiter[3] = '-';
+            memcpy(&gMultipartDelimiter[4], boundary.c_str(), boundary.length());
+
+            gMultipartDelimiterLen = 4U + boundary.length();
+            isSuccessful           = true;
+        }
+    }
+
+    return isSuccessful;
+}
+
+/**
+ * Receive request body data. Timeouts are retried a few times.
+ *
+ * @param[in]   req     Request
+ * @param[out]  buffer  Receive buffer
+ * @param[in]   size    Max. number of bytes to receive
+ *
+ * @return Number of received bytes or a value <= 0 on error.
+ */
+static int receive(httpd_req_t* req, uint8_t* buffer, size_t size)
+{
+    int     len     = HTTPD_SOCK_ERR_TIMEOUT;
+    uint8_t retries = 0U;
+
+    while ((HTTPD_SOCK_ERR_TIMEOUT == len) && (RECV_TIMEOUT_RETRIES > retries))
+    {
+        len = httpd_req_recv(req, reinterpret_cast<char*>(buffer), size);
+        ++retries;
+    }
+
+    return len;
+}
+
+/**
+ * Send the response of a form or raw upload request.
+ * A bundle, which activated app0, restarts the device afterwards.
+ *
+ * @param[in] req   Request
+ */
+static void sendUploadResponse(httpd_req_t* req)
+{
+    UploadHandler::Response response;
+    String                  uploadOffset;
+
+    UploadHandler::lock();
+    UploadHandler::getResponse(response);
+    UploadHandler::unlock();
+
+    /* The header value must be valid until the response is sent. */
+    if (true == response.hasUploadOffset)
+    {
+        uploadOffset = String(response.uploadOffset);
+        (void)httpd_resp_set_hdr(req, UploadHandler::UPLOAD_OFFSET_HEADER, uploadOffset.c_str());
+    }
+
+    sendText(req, response.statusCode, response.message);
+
+    if (true == UploadHandler::isRestartRequested())
+    {
+        restart();
+    }
+}
+
+/**
+ * Send a plain text response.
+ *
+ * @param[in] req           Request
+ * @param[in] statusCode    HTTP status code
+ * @param[in] text          Response text
+ */
+static void sendText(httpd_req_t* req, HTTPStatusCode statusCode, const char* text)
+{
+    (void)httpd_resp_set_status(req, getStatusLine(statusCode));
+    (void)httpd_resp_set_type(req, "text/plain");
+    (void)httpd_resp_send(req, text, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * Send a redirect response.
+ *
+ * @param[in] req       Request
+ * @param[in] location  Redirect location
+ */
+static void sendRedirect(httpd_req_t* req, const char* location)
+{
+    (void)httpd_resp_set_hdr(req, "Location", location);
+    sendText(req, STATUS_CODE_FOUND, "");
+}
+
+/**
+ * Get the HTTP status line of the status codes, which are used by the web server.
+ *
+ * @param[in] statusCode    HTTP status code
+ *
+ * @return HTTP status line, e.g. "200 OK".
+ */
+static const char* getStatusLine(HTTPStatusCode statusCode)
+{
+    const char* statusLine = "500 Internal Server Error";
+
+    switch (statusCode)
+    {
+    case STATUS_CODE_OK:
+        statusLine = "200 OK";
+        break;
+
+    case STATUS_CODE_ACCEPTED:
+        statusLine = "202 Accepted";
+        break;
+
+    case STATUS_CODE_PARTIAL_CONTENT:
+        statusLine = "206 Partial Content";
+        break;
+
+    case STATUS_CODE_FOUND:
+        statusLine = "302 Found";
+        break;
+
+    case STATUS_CODE_NOT_MODIFIED:
+        statusLine = "304 Not Modified";
+        break;
+
+    case STATUS_CODE_BAD_REQUEST:
+        statusLine = "400 Bad Request";
+        break;
+
+    case STATUS_CODE_FORBIDDEN:
+        statusLine = "403 Forbidden";
+        break;
+
+    case STATUS_CODE_NOT_FOUND:
+        statusLine = "404 Not Found";
+        break;
+
+    case STATUS_CODE_CONFLICT:
+        statusLine = "409 Conflict";
+        break;
+
+    case STATUS_CODE_PAYLOAD_TOO_LARGE:
+        statusLine = "413 Payload Too Large";
+        break;
+
+    case STATUS_CODE_RANGE_NOT_SATISFIABLE:
+        statusLine = "416 Range Not Satisfiable";
+        break;
+
+    case STATUS_CODE_SERVICE_UNAVAILABLE:
+        statusLine = "503 Service Unavailable";
+        break;
+
+    case STATUS_CODE_INTERNAL_SERVER_ERROR:
+    default:
+        break;
+    }
+
+    return statusLine;
+}
+
+/**
+ * Get the value of a request header.
+ *
+ * @param[in]   req     Request
+ * @param[in]   name    Header name
+ * @param[out]  value   Header value, which is empty if not available or too long.
+ */
+static void getHeader(httpd_req_t* req, const char* name, String& value)
+{
+    char buffer[HEADER_VALUE_SIZE];
+
+    if (ESP_OK == httpd_req_get_hdr_value_str(req, name, buffer, sizeof(buffer)))
+    {
+        value = buffer;
+    }
+    else
+    {
+        value.clear();
+    }
+}
+
+/**
+ * Get the upload related headers of a request.
+ *
+ * @param[in]   req     Request
+ * @param[out]  request Request headers
+ */
+static void getRequest(httpd_req_t* req, UploadHandler::Request& request)
+{
+    getHeader(req, UploadHandler::FIRMWARE_SIZE_HEADER, request.firmwareSize);
+    getHeader(req, UploadHandler::FILESYSTEM_SIZE_HEADER, request.filesystemSize);
+    getHeader(req, UploadHandler::CONTENT_LENGTH_HEADER, request.contentLength);
+    getHeader(req, UploadHandler::IMAGE_HASH_HEADER, request.imageHash);
+    getHeader(req, UploadHandler::CHUNK_OFFSET_HEADER, request.chunkOffset);
+    getHeader(req, UploadHandler::CHUNK_CRC32_HEADER, request.chunkCrc);
+    getHeader(req, UploadHandler::PRE_ERASE_HEADER, request.preErase);
+}
+
+/**
+ * Find a byte sequence in data.
+ *
+ * @param[in] data          Data
+ * @param[in] size          Data size in byte
+ * @param[in] sequence      Byte sequence
+ * @param[in] sequenceSize  Byte sequence size in byte
+ *
+ * @return Begin of the sequence in the data or nullptr, if not found.
+ */
+static const uint8_t* findSequence(const uint8_t* data, size_t size, const uint8_t* sequence, size_t sequenceSize)
+{
+    const uint8_t* found = nullptr;
+    size_t         idx   = 0U;
+
+    for (idx = 0U; ((idx + sequenceSize) <= size) && (nullptr == found); ++idx)
+    {
+        if ((sequence[0] == data[idx]) && (0 == memcmp(&data[idx], sequence, sequenceSize)))
+        {
+            found = &data[idx];
+        }
+    }
+
+    return found;
+}
+
+#endif /* (0 != CONFIG_WEB_SERVER_ASYNC) */
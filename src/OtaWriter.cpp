@@ -0,0 +1,735 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   OtaWriter.cpp
+ * @brief  Pipelined writer for firmware and filesystem images.
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "OtaWriter.h"
+#include "GzipInflater.h"
+#include "DeltaPatcher.h"
+#include "PartitionWriter.h"
+#include <Arduino.h>
+#include <Update.h>
+#include <algorithm>
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/**
+ * A write job is one buffer of the ring, which is handed over between the
+ * receiving side and the writer task.
+ */
+typedef struct
+{
+    uint8_t* data; /**< Buffer */
+    size_t   size; /**< Number of used bytes in the buffer */
+
+} WriteJob;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void writerTask(void* parameters);
+static void waitUntilIdle();
+static void preEraseNext();
+static size_t stopPreErase(const esp_partition_t* partition);
+static const esp_partition_t* getPartition(int cmd);
+static bool startDecompression();
+static bool writeImage(const uint8_t* data, size_t size);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char        LOG_TAG[]       = "OtaWriter";
+
+/** Number of buffers in the ring. At least two are required for pipelining. */
+static const size_t      BUFFER_COUNT    = 3U;
+
+/** Size of a single buffer in byte. It is aligned to the flash sector size. */
+static const size_t      BUFFER_SIZE     = SPI_FLASH_SEC_SIZE;
+
+/** Writer task stack size in byte. */
+static const uint32_t    TASK_STACK_SIZE = 4096U;
+
+/** Writer task priority. It is higher than the loop() task, but lower than the network tasks. */
+static const UBaseType_t TASK_PRIORITY   = 2U;
+
+#if CONFIG_FREERTOS_UNICORE
+
+/** Writer task core */
+static const BaseType_t TASK_CORE = 0;
+
+#else /* CONFIG_FREERTOS_UNICORE */
+
+/** Writer task core, which is the other one than the loop() task runs on. */
+static const BaseType_t TASK_CORE = (0 == ARDUINO_RUNNING_CORE) ? 1 : 0;
+
+#endif /* CONFIG_FREERTOS_UNICORE */
+
+/** The buffer ring, used by write jobs. */
+static uint8_t         gBuffers[BUFFER_COUNT][BUFFER_SIZE] __attribute__((aligned(4)));
+
+/** Queue with write jobs, which are free to be filled. */
+static QueueHandle_t   gFreeQueue      = nullptr;
+
+/** Queue with write jobs, which are filled and wait to be written to flash. */
+static QueueHandle_t   gFullQueue      = nullptr;
+
+/** The write job, which is currently filled by the receiving side. */
+static WriteJob        gCurrentJob     = { nullptr, 0U };
+
+/** Is an image write in progress? */
+static bool            gIsRunning      = false;
+
+/** Shall the writer task drop the queued write jobs? */
+static volatile bool   gIsAborted      = false;
+
+/** Did the writer task fail to write to flash? */
+static volatile bool   gHasError       = false;
+
+/** Error description of the last failed image write. */
+static const char*     gErrorString    = nullptr;
+
+/** Update command, which is U_FLASH or U_SPIFFS. */
+static int             gCommand        = U_FLASH;
+
+/** Was the first data of the image already received? */
+static bool            gIsFirstData    = true;
+
+/** Is the image gzip compressed? */
+static bool            gIsCompressed   = false;
+
+/** Was the first image data already passed to the writer task output? */
+static bool            gIsFirstOutput  = true;
+
+/** Is the image a delta patch? */
+static bool            gIsPatch        = false;
+
+/** Inflater for gzip compressed images. */
+static GzipInflater    gInflater;
+
+/** Patcher for delta patch images. */
+static DeltaPatcher    gPatcher;
+
+/** Writes the image to the target partition. */
+static PartitionWriter gPartitionWriter;
+
+/** Size in byte, which is erased at once in the background. */
+static const size_t            PRE_ERASE_BLOCK_SIZE = 16U * PartitionWriter::SECTOR_SIZE;
+
+/** Protects the background erase state, which is shared with the writer task. */
+static SemaphoreHandle_t       gPreEraseMutex       = nullptr;
+
+/** Is a background erase in progress? */
+static volatile bool           gIsPreErasing        = false;
+
+/** Partition, which is erased in the background. */
+static const esp_partition_t* gPreErasePartition   = nullptr;
+
+/** Size in byte, which shall be erased in the background. */
+static size_t                  gPreEraseSize        = 0U;
+
+/** Size in byte, which is erased in the background. */
+static size_t                  gPreErasedSize       = 0U;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+bool OtaWriter::init()
+{
+    bool isSuccessful = false;
+
+    gFreeQueue        = xQueueCreate(BUFFER_COUNT, sizeof(WriteJob));
+    gFullQueue        = xQueueCreate(BUFFER_COUNT, sizeof(WriteJob));
+    gPreEraseMutex    = xSemaphoreCreateMutex();
+
+    if ((nullptr == gFreeQueue) || (nullptr == gFullQueue) || (nullptr == gPreEraseMutex))
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create queues.");
+    }
+    else
+    {
+        size_t idx = 0U;
+
+        for (idx = 0U; BUFFER_COUNT > idx; ++idx)
+        {
+            WriteJob job = { gBuffers[idx], 0U };
+
+            (void)xQueueSend(gFreeQueue, &job, 0U);
+        }
+
+        if (pdPASS != xTaskCreatePinnedToCore(writerTask, "otaWriter", TASK_STACK_SIZE, nullptr, TASK_PRIORITY, nullptr, TASK_CORE))
+        {
+            ESP_LOGE(LOG_TAG, "Failed to create writer task.");
+        }
+        else
+        {
+            isSuccessful = true;
+        }
+    }
+
+    return isSuccessful;
+}
+
+bool OtaWriter::begin(size_t size, int cmd)
+{
+    bool                   isSuccessful = false;
+    const esp_partition_t* partition    = getPartition(cmd);
+
+    /* If there is a pending image write, abort it. */
+    if (true == gIsRunning)
+    {
+        abort();
+        ESP_LOGW(LOG_TAG, "Aborted pending image write.");
+    }
+
+    if (nullptr == gFreeQueue)
+    {
+        ESP_LOGE(LOG_TAG, "Not initialized.");
+    }
+    /* The writer task is idle, therefore it is safe to access the partition writer here. */
+    else if (false == gPartitionWriter.begin(partition, (UPDATE_SIZE_UNKNOWN == size) ? PartitionWriter::SIZE_UNKNOWN : size))
+    {
+        (void)stopPreErase(nullptr);
+        ESP_LOGE(LOG_TAG, "Failed to begin: %s", gPartitionWriter.getErrorString());
+    }
+    else
+    {
+        (void)gPartitionWriter.setErasedSize(stopPreErase(partition));
+
+        gIsAborted     = false;
+        gHasError      = false;
+        gErrorString   = nullptr;
+        gCommand       = cmd;
+        gIsFirstData   = true;
+        gIsCompressed  = false;
+        gIsFirstOutput = true;
+        gIsPatch       = false;
+        gIsRunning     = true;
+        isSuccessful   = true;
+    }
+
+    return isSuccessful;
+}
+
+bool OtaWriter::preErase(size_t size, int cmd)
+{
+    bool                   isSuccessful = false;
+    const esp_partition_t* partition    = getPartition(cmd);
+
+    if ((nullptr == gPreEraseMutex) || (true == gIsRunning) || (nullptr == partition) || (partition->size < size))
+    {
+        ESP_LOGW(LOG_TAG, "Background erase not possible.");
+    }
+    else
+    {
+        WriteJob wakeUp = { nullptr, 0U };
+
+        (void)xSemaphoreTake(gPreEraseMutex, portMAX_DELAY);
+
+        /* Continue a background erase of the same partition. */
+        if (partition != gPreErasePartition)
+        {
+            gPreErasePartition = partition;
+            gPreErasedSize     = 0U;
+        }
+
+        gPreEraseSize = ((size + PartitionWriter::SECTOR_SIZE - 1U) / PartitionWriter::SECTOR_SIZE) * PartitionWriter::SECTOR_SIZE;
+        gIsPreErasing = (gPreErasedSize < gPreEraseSize);
+
+        (void)xSemaphoreGive(gPreEraseMutex);
+
+        /* The writer task waits for write jobs, an empty one wakes it up. */
+        (void)xQueueSend(gFullQueue, &wakeUp, 0U);
+
+        ESP_LOGI(LOG_TAG, "Background erase of %u bytes in '%s' started.", gPreEraseSize, partition->label);
+        isSuccessful = true;
+    }
+
+    return isSuccessful;
+}
+
+bool OtaWriter::setExpectedHash(const uint8_t* hash)
+{
+    bool isSuccessful = false;
+
+    /* The writer task is idle until the first data is written. */
+    if ((true == gIsRunning) && (true == gIsFirstData) && (nullptr != hash))
+    {
+        isSuccessful = gPartitionWriter.setExpectedHash(hash);
+    }
+
+    return isSuccessful;
+}
+
+bool OtaWriter::write(const uint8_t* data, size_t size)
+{
+    bool isSuccessful = false;
+
+    if ((true == gIsRunning) && (nullptr != data))
+    {
+        size_t offset = 0U;
+
+        /* A compressed image is recognized by its magic bytes. */
+        if (true == gIsFirstData)
+        {
+            gIsFirstData = false;
+
+            if ((true == GzipInflater::isGzip(data, size)) &&
+                (false == startDecompression()))
+            {
+                gHasError = true;
+            }
+        }
+
+        while ((size > offset) && (false == gHasError))
+        {
+            size_t chunkSize = 0U;
+
+            /* Get a free buffer. Blocks as long as the writer task is busy with all of them. */
+            if (nullptr == gCurrentJob.data)
+            {
+                (void)xQueueReceive(gFreeQueue, &gCurrentJob, portMAX_DELAY);
+                gCurrentJob.size = 0U;
+            }
+
+            chunkSize = std::min(BUFFER_SIZE - gCurrentJob.size, size - offset);
+
+            memcpy(&gCurrentJob.data[gCurrentJob.size], &data[offset], chunkSize);
+            gCurrentJob.size += chunkSize;
+            offset           += chunkSize;
+
+            /* Hand over a full buffer to the writer task. */
+            if (BUFFER_SIZE == gCurrentJob.size)
+            {
+                (void)xQueueSend(gFullQueue, &gCurrentJob, portMAX_DELAY);
+                gCurrentJob.data = nullptr;
+            }
+        }
+
+        isSuccessful = (false == gHasError);
+    }
+
+    return isSuccessful;
+}
+
+bool OtaWriter::end()
+{
+    bool isSuccessful = false;
+
+    if (true == gIsRunning)
+    {
+        /* Hand over the remaining data. */
+        if ((nullptr != gCurrentJob.data) && (0U < gCurrentJob.size))
+        {
+            (void)xQueueSend(gFullQueue, &gCurrentJob, portMAX_DELAY);
+            gCurrentJob.data = nullptr;
+        }
+
+        waitUntilIdle();
+
+        if (true == gHasError)
+        {
+            if (nullptr == gErrorString)
+            {
+                gErrorString = gPartitionWriter.getErrorString();
+            }
+
+            ESP_LOGE(LOG_TAG, "Failed to write: %s", gErrorString);
+            gPartitionWriter.abort();
+        }
+        else if ((true == gIsCompressed) && (false == gInflater.end()))
+        {
+            gErrorString = "Invalid compressed image";
+            ESP_LOGE(LOG_TAG, "Failed to end: %s", gErrorString);
+            gPartitionWriter.abort();
+        }
+        else if ((true == gIsPatch) && (false == gPatcher.end()))
+        {
+            gErrorString = "Incomplete patch";
+            ESP_LOGE(LOG_TAG, "Failed to end: %s", gErrorString);
+            gPartitionWriter.abort();
+        }
+        else if (false == gPartitionWriter.end())
+        {
+            gErrorString = gPartitionWriter.getErrorString();
+            ESP_LOGE(LOG_TAG, "Failed to end: %s", gErrorString);
+        }
+        else
+        {
+            if (true == gIsCompressed)
+            {
+                ESP_LOGI(LOG_TAG, "Decompressed image size: %u bytes", gInflater.getOutputSize());
+            }
+
+            if (true == gIsPatch)
+            {
+                ESP_LOGI(LOG_TAG, "Patched image size: %u bytes", gPatcher.getTargetSize());
+            }
+
+            isSuccessful = true;
+        }
+
+        gInflater.release();
+        gIsRunning = false;
+    }
+
+    return isSuccessful;
+}
+
+void OtaWriter::abort()
+{
+    if (true == gIsRunning)
+    {
+        /* Writer task shall drop all queued data. */
+        gIsAborted = true;
+
+        waitUntilIdle();
+
+        /* Keep the reason, which caused the abort. */
+        if ((nullptr == gErrorString) && (PartitionWriter::ERROR_NONE != gPartitionWriter.getError()))
+        {
+            gErrorString = gPartitionWriter.getErrorString();
+        }
+
+        gPartitionWriter.abort();
+        (void)gPatcher.end();
+        gInflater.release();
+
+        gIsRunning = false;
+    }
+}
+
+bool OtaWriter::isRunning()
+{
+    return gIsRunning;
+}
+
+const char* OtaWriter::getErrorString()
+{
+    return (nullptr != gErrorString) ? gErrorString : gPartitionWriter.getErrorString();
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * The writer task takes the filled buffers and writes them to flash.
+ * Afterwards the buffers are given back to be filled again.
+ *
+ * @param[in] parameters    Task parameters (not used)
+ */
+static void writerTask(void* parameters)
+{
+    (void)parameters;
+
+    for (;;)
+    {
+        WriteJob   job;
+        TickType_t timeout = (true == gIsPreErasing) ? 0U : portMAX_DELAY;
+
+        if (pdTRUE != xQueueReceive(gFullQueue, &job, timeout))
+        {
+            /* Erase in the background, as long as there is nothing to write. */
+            preEraseNext();
+        }
+        else if (nullptr == job.data)
+        {
+            /* Wake up only, to start the background erase. */
+        }
+        else
+        {
+            if ((false == gIsAborted) && (false == gHasError))
+            {
+                bool isSuccessful = false;
+
+                if (true == gIsCompressed)
+                {
+                    isSuccessful = gInflater.write(job.data, job.size);
+                }
+                else
+                {
+                    isSuccessful = writeImage(job.data, job.size);
+                }
+
+                if (false == isSuccessful)
+                {
+                    if (PartitionWriter::ERROR_NONE != gPartitionWriter.getError())
+                    {
+                        gErrorString = gPartitionWriter.getErrorString();
+                    }
+                    else if (true == gIsPatch)
+                    {
+                        gErrorString = "Invalid patch";
+                    }
+                    else if (true == gIsCompressed)
+                    {
+                        gErrorString = "Decompression failed";
+                    }
+
+                    gHasError = true;
+                }
+            }
+
+            job.size = 0U;
+            (void)xQueueSend(gFreeQueue, &job, portMAX_DELAY);
+        }
+    }
+}
+
+/**
+ * Wait until the writer task processed all write jobs.
+ * The write job in filling is dropped.
+ */
+static void waitUntilIdle()
+{
+    WriteJob jobs[BUFFER_COUNT];
+    size_t   idx = 0U;
+
+    /* Give the buffer in filling back, without writing it. */
+    if (nullptr != gCurrentJob.data)
+    {
+        gCurrentJob.size = 0U;
+        (void)xQueueSend(gFreeQueue, &gCurrentJob, portMAX_DELAY);
+        gCurrentJob.data = nullptr;
+    }
+
+    /* The writer task is idle, as soon as all buffers are free. */
+    for (idx = 0U; BUFFER_COUNT > idx; ++idx)
+    {
+        (void)xQueueReceive(gFreeQueue, &jobs[idx], portMAX_DELAY);
+    }
+
+    for (idx = 0U; BUFFER_COUNT > idx; ++idx)
+    {
+        (void)xQueueSend(gFreeQueue, &jobs[idx], portMAX_DELAY);
+    }
+}
+
+/**
+ * Erase the next block of the background erase.
+ * It runs in the writer task context.
+ */
+static void preEraseNext()
+{
+    (void)xSemaphoreTake(gPreEraseMutex, portMAX_DELAY);
+
+    if ((true == gIsPreErasing) && (nullptr != gPreErasePartition))
+    {
+        size_t eraseSize = PartitionWriter::SECTOR_SIZE;
+
+        /* Aligned blocks are erased faster than the single sectors. */
+        if ((0U == (gPreErasedSize % PRE_ERASE_BLOCK_SIZE)) && (PRE_ERASE_BLOCK_SIZE <= (gPreEraseSize - gPreErasedSize)))
+        {
+            eraseSize = PRE_ERASE_BLOCK_SIZE;
+        }
+
+        if (ESP_OK != esp_partition_erase_range(gPreErasePartition, gPreErasedSize, eraseSize))
+        {
+            ESP_LOGE(LOG_TAG, "Background erase failed at 0x%08X.", gPreErasedSize);
+            gIsPreErasing = false;
+        }
+        else
+        {
+            gPreErasedSize += eraseSize;
+
+            if (gPreEraseSize <= gPreErasedSize)
+            {
+                ESP_LOGI(LOG_TAG, "Background erase of %u bytes finished.", gPreErasedSize);
+                gIsPreErasing = false;
+            }
+        }
+    }
+
+    (void)xSemaphoreGive(gPreEraseMutex);
+}
+
+/**
+ * Stop the background erase.
+ * The erased size is given to the caller at most once, because the
+ * erased sectors are written afterwards.
+ *
+ * @param[in] partition Partition, which will be written or nullptr.
+ *
+ * @return Erased size in byte of the partition.
+ */
+static size_t stopPreErase(const esp_partition_t* partition)
+{
+    size_t erasedSize = 0U;
+
+    /* Wait until the writer task finished the current erase. */
+    (void)xSemaphoreTake(gPreEraseMutex, portMAX_DELAY);
+
+    if ((nullptr != partition) && (partition == gPreErasePartition))
+    {
+        erasedSize = gPreErasedSize;
+    }
+
+    gIsPreErasing      = false;
+    gPreErasePartition = nullptr;
+    gPreEraseSize      = 0U;
+    gPreErasedSize     = 0U;
+
+    (void)xSemaphoreGive(gPreEraseMutex);
+
+    return erasedSize;
+}
+
+/**
+ * Get the target partition of an update command.
+ *
+ * @param[in] cmd   Update command, which is U_FLASH or U_SPIFFS.
+ *
+ * @return Partition or nullptr, if not found.
+ */
+static const esp_partition_t* getPartition(int cmd)
+{
+    const esp_partition_t* partition = nullptr;
+
+    if (U_FLASH == cmd)
+    {
+        partition = esp_partition_find_first(
+            esp_partition_type_t::ESP_PARTITION_TYPE_APP,
+            esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_APP_OTA_0,
+            nullptr);
+    }
+    else if (U_SPIFFS == cmd)
+    {
+        partition = esp_partition_find_first(
+            esp_partition_type_t::ESP_PARTITION_TYPE_DATA,
+            esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+            nullptr);
+    }
+
+    return partition;
+}
+
+/**
+ * Start decompression of a gzip compressed image.
+ * It must be called before the first data is handed over to the writer task.
+ *
+ * @return If successful, it will return true otherwise false.
+ */
+static bool startDecompression()
+{
+    bool isSuccessful = false;
+
+    /* The decompressed image size is unknown, therefore the whole partition is available. */
+    if (false == gPartitionWriter.setImageSize(PartitionWriter::SIZE_UNKNOWN))
+    {
+        ESP_LOGE(LOG_TAG, "Failed to begin: %s", gPartitionWriter.getErrorString());
+    }
+    else if (false == gInflater.begin(writeImage))
+    {
+        gErrorString = "Out of memory";
+    }
+    else
+    {
+        ESP_LOGI(LOG_TAG, "Compressed image detected.");
+        gIsCompressed = true;
+        isSuccessful  = true;
+    }
+
+    return isSuccessful;
+}
+
+/**
+ * Write image data to the target partition. It runs in the writer task context.
+ * A delta patch is recognized by its magic bytes and applied to the partition
+ * content, otherwise the data is written as it is.
+ *
+ * @param[in] data  Image data
+ * @param[in] size  Image data size in byte
+ *
+ * @return If successful, it will return true otherwise false.
+ */
+static bool writeImage(const uint8_t* data, size_t size)
+{
+    bool isSuccessful = false;
+
+    if (true == gIsFirstOutput)
+    {
+        gIsFirstOutput = false;
+
+        if ((true == DeltaPatcher::isPatch(data, size)) &&
+            (true == gPatcher.begin(&gPartitionWriter)))
+        {
+            ESP_LOGI(LOG_TAG, "Delta patch detected.");
+            gIsPatch = true;
+        }
+    }
+
+    if (true == gIsPatch)
+    {
+        isSuccessful = gPatcher.write(data, size);
+    }
+    else
+    {
+        isSuccessful = gPartitionWriter.write(data, size);
+    }
+
+    return isSuccessful;
+}
@@ -0,0 +1,158 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   OtaWriter.h
+ * @brief  Pipelined writer for firmware and filesystem images.
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef OTA_WRITER_H
+#define OTA_WRITER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The OTA writer decouples receiving of image data from writing it to flash.
+ * The received data is copied into a ring of sector sized buffers, which are
+ * written to flash by a dedicated task. This way the network can be read
+ * while the flash is erased and programmed.
+ */
+namespace OtaWriter
+{
+    /**
+     * Initialize the OTA writer and start the writer task.
+     * Call it once before any other function.
+     *
+     * @return If successful initialized, it will return true otherwise false.
+     */
+    bool init();
+
+    /**
+     * Begin writing a new image.
+     * A pending image write will be aborted.
+     *
+     * @param[in] size  Image size in byte or UPDATE_SIZE_UNKNOWN.
+     * @param[in] cmd   U_FLASH for firmware or U_SPIFFS for filesystem.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool begin(size_t size, int cmd);
+
+    /**
+     * Erase the target partition in the background for an announced image.
+     * A following begin() for the same partition writes the erased sectors
+     * without erasing them again. The background erase stops with begin().
+     *
+     * Note, the partition content is lost, therefore it can not be used
+     * for a delta patch or to skip unchanged sectors.
+     *
+     * @param[in] size  Announced image size in byte
+     * @param[in] cmd   U_FLASH for firmware or U_SPIFFS for filesystem.
+     *
+     * @return If the background erase started, it will return true otherwise false.
+     */
+    bool preErase(size_t size, int cmd);
+
+    /**
+     * Set the expected SHA-256 hash of the image. The hash is calculated
+     * while the image is written and verified, before it is set bootable.
+     * It must be called after begin() and before the first data is written.
+     *
+     * @param[in] hash  SHA-256 hash with 32 bytes
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool setExpectedHash(const uint8_t* hash);
+
+    /**
+     * Write image data.
+     * The data is copied, therefore the caller can reuse the buffer right
+     * after returning. It blocks only if all buffers are in use.
+     *
+     * @param[in] data  Image data
+     * @param[in] size  Image data size in byte
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool write(const uint8_t* data, size_t size);
+
+    /**
+     * Finish writing the image.
+     * It waits until all buffered data is written to flash.
+     *
+     * @return If image is complete and valid, it will return true otherwise false.
+     */
+    bool end();
+
+    /**
+     * Abort writing the image.
+     */
+    void abort();
+
+    /**
+     * Is an image write in progress?
+     *
+     * @return If an image write is in progress, it will return true otherwise false.
+     */
+    bool isRunning();
+
+    /**
+     * Get a user friendly description of the last error.
+     *
+     * @return Error description
+     */
+    const char* getErrorString();
+
+} /* namespace OtaWriter */
+
+#endif /* OTA_WRITER_H */
+
+/** @} */
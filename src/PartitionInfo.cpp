@@ -0,0 +1,538 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PartitionInfo.cpp
+ * @brief  Partition table and installed images
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "PartitionInfo.h"
+#include <inttypes.h>
+
+#include <esp_image_format.h>
+#include <esp_log.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include <algorithm>
+#include <new>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/**
+ * Name of a partition subtype, like in the partition table CSV.
+ */
+typedef struct
+{
+    esp_partition_type_t type;    /**< Partition type */
+    uint8_t              subtype; /**< Partition subtype */
+    const char*          name;    /**< Subtype name */
+
+} SubtypeName;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void collect(String& json);
+static void appendPartitions(String& json);
+static void appendLabel(String& json, const char* key, const esp_partition_t* partition);
+static void appendApp(String& json);
+static void appendFilesystem(String& json);
+static void appendString(String& json, const char* key, const char* value, size_t maxLength);
+static void appendHash(String& json, const char* key, const uint8_t* hash);
+static void getTypeName(const esp_partition_t* partition, char* buffer, size_t size);
+static void getSubtypeName(const esp_partition_t* partition, char* buffer, size_t size);
+static bool hashPartition(const esp_partition_t* partition, size_t size, uint8_t* hash);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char        LOG_TAG[]        = "PartitionInfo";
+
+/** SHA-256 hash size in byte. */
+static const size_t      HASH_SIZE        = 32U;
+
+/** Size in byte of the buffer, which is used to read the partitions. */
+static const size_t      READ_BUFFER_SIZE = SPI_FLASH_SEC_SIZE;
+
+/** First application subtype of the OTA partitions. */
+static const uint8_t     APP_OTA_MIN      = 0x10U;
+
+/** Last application subtype of the OTA partitions. */
+static const uint8_t     APP_OTA_MAX      = 0x1FU;
+
+/** Known partition subtype names, except the OTA application partitions. */
+static const SubtypeName SUBTYPE_NAMES[]  = {
+    { ESP_PARTITION_TYPE_APP, 0x00U, "factory" },
+    { ESP_PARTITION_TYPE_APP, 0x20U, "test" },
+    { ESP_PARTITION_TYPE_DATA, 0x00U, "ota" },
+    { ESP_PARTITION_TYPE_DATA, 0x01U, "phy" },
+    { ESP_PARTITION_TYPE_DATA, 0x02U, "nvs" },
+    { ESP_PARTITION_TYPE_DATA, 0x03U, "coredump" },
+    { ESP_PARTITION_TYPE_DATA, 0x04U, "nvs_keys" },
+    { ESP_PARTITION_TYPE_DATA, 0x05U, "efuse" },
+    { ESP_PARTITION_TYPE_DATA, 0x80U, "esphttpd" },
+    { ESP_PARTITION_TYPE_DATA, 0x81U, "fat" },
+    { ESP_PARTITION_TYPE_DATA, 0x82U, "spiffs" },
+    { ESP_PARTITION_TYPE_DATA, 0x83U, "littlefs" }
+};
+
+/** Cached partition information. */
+static String            gInfo;
+
+/** Is the cached partition information valid? */
+static bool              gIsValid         = false;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+void PartitionInfo::getInfo(String& json)
+{
+    if (false == gIsValid)
+    {
+        uint32_t startTime = millis();
+
+        collect(gInfo);
+        gIsValid = true;
+
+        ESP_LOGI(LOG_TAG, "Partition info collected in %" PRIu32 " ms.", static_cast<uint32_t>(millis() - startTime));
+    }
+
+    json = gInfo;
+}
+
+void PartitionInfo::invalidate()
+{
+    gIsValid = false;
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * Collect the partition information.
+ *
+ * @param[out] json Partition information
+ */
+static void collect(String& json)
+{
+    json  = "{";
+    appendPartitions(json);
+    json += ",";
+    appendLabel(json, "boot", esp_ota_get_boot_partition());
+    json += ",";
+    appendLabel(json, "running", esp_ota_get_running_partition());
+    json += ",";
+    appendApp(json);
+    json += ",";
+    appendFilesystem(json);
+    json += "}";
+}
+
+/**
+ * Append the partition table.
+ *
+ * @param[in,out] json  JSON
+ */
+static void appendPartitions(String& json)
+{
+    esp_partition_iterator_t it      = esp_partition_find(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, nullptr);
+    bool                     isFirst = true;
+
+    json += "\"partitions\":[";
+
+    while (nullptr != it)
+    {
+        const esp_partition_t* partition = esp_partition_get(it);
+        char                   type[8];
+        char                   subtype[16];
+
+        getTypeName(partition, type, sizeof(type));
+        getSubtypeName(partition, subtype, sizeof(subtype));
+
+        if (false == isFirst)
+        {
+            json += ",";
+        }
+
+        json += "{";
+        appendString(json, "label", partition->label, sizeof(partition->label));
+        json += ",";
+        appendString(json, "type", type, sizeof(type));
+        json += ",";
+        appendString(json, "subtype", subtype, sizeof(subtype));
+        json += ",\"offset\":";
+        json += partition->address;
+        json += ",\"size\":";
+        json += partition->size;
+        json += "}";
+
+        isFirst = false;
+        it      = esp_partition_next(it);
+    }
+
+    json += "]";
+}
+
+/**
+ * Append the label of a partition or null, if it is not available.
+ *
+ * @param[in,out]   json        JSON
+ * @param[in]       key         Key
+ * @param[in]       partition   Partition, may be nullptr.
+ */
+static void appendLabel(String& json, const char* key, const esp_partition_t* partition)
+{
+    if (nullptr == partition)
+    {
+        json += "\"";
+        json += key;
+        json += "\":null";
+    }
+    else
+    {
+        appendString(json, key, partition->label, sizeof(partition->label));
+    }
+}
+
+/**
+ * Append the installed application in app0. If a valid application is
+ * installed, its descriptor and the SHA-256 hash of the image are added.
+ * The hash is the one of the firmware binary.
+ *
+ * @param[in,out] json  JSON
+ */
+static void appendApp(String& json)
+{
+    const esp_partition_t* partition = esp_partition_find_first(
+        esp_partition_type_t::ESP_PARTITION_TYPE_APP,
+        esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_APP_OTA_0,
+        nullptr);
+
+    json += "\"app0\":";
+
+    if (nullptr == partition)
+    {
+        json += "null";
+    }
+    else
+    {
+        esp_app_desc_t       desc;
+        esp_image_metadata_t metadata;
+        esp_partition_pos_t  position = { partition->address, partition->size };
+        uint8_t              hash[HASH_SIZE];
+
+        json += "{";
+        appendString(json, "label", partition->label, sizeof(partition->label));
+        json += ",\"size\":";
+        json += partition->size;
+
+        if (ESP_OK != esp_ota_get_partition_description(partition, &desc))
+        {
+            ESP_LOGI(LOG_TAG, "No application in %s.", partition->label);
+        }
+        else
+        {
+            json += ",";
+            appendString(json, "version", desc.version, sizeof(desc.version));
+            json += ",";
+            appendString(json, "project", desc.project_name, sizeof(desc.project_name));
+            json += ",";
+            appendString(json, "date", desc.date, sizeof(desc.date));
+            json += ",";
+            appendString(json, "time", desc.time, sizeof(desc.time));
+            json += ",";
+            appendString(json, "idf", desc.idf_ver, sizeof(desc.idf_ver));
+            json += ",";
+            appendHash(json, "elfSha256", desc.app_elf_sha256);
+
+            if (ESP_OK != esp_image_get_metadata(&position, &metadata))
+            {
+                ESP_LOGW(LOG_TAG, "Failed to get image metadata of %s.", partition->label);
+            }
+            else if (false == hashPartition(partition, metadata.image_len, hash))
+            {
+                ESP_LOGW(LOG_TAG, "Failed to hash %s.", partition->label);
+            }
+            else
+            {
+                json += ",\"imageSize\":";
+                json += metadata.image_len;
+                json += ",";
+                appendHash(json, "sha256", hash);
+            }
+        }
+
+        json += "}";
+    }
+}
+
+/**
+ * Append the filesystem partition. The SHA-256 hash covers the whole
+ * partition, which is the size of a filesystem image.
+ *
+ * @param[in,out] json  JSON
+ */
+static void appendFilesystem(String& json)
+{
+    const esp_partition_t* partition = esp_partition_find_first(
+        esp_partition_type_t::ESP_PARTITION_TYPE_DATA,
+        esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+        nullptr);
+
+    json += "\"filesystem\":";
+
+    if (nullptr == partition)
+    {
+        json += "null";
+    }
+    else
+    {
+        uint8_t hash[HASH_SIZE];
+
+        json += "{";
+        appendString(json, "label", partition->label, sizeof(partition->label));
+        json += ",\"size\":";
+        json += partition->size;
+
+        if (false == hashPartition(partition, partition->size, hash))
+        {
+            ESP_LOGW(LOG_TAG, "Failed to hash %s.", partition->label);
+        }
+        else
+        {
+            json += ",";
+            appendHash(json, "sha256", hash);
+        }
+
+        json += "}";
+    }
+}
+
+/**
+ * Append a string value. The value ends at its string termination or at
+ * its maximum length, because the fixed size fields of the application
+ * descriptor and the partition label may be used completely.
+ *
+ * @param[in,out]   json        JSON
+ * @param[in]       key         Key
+ * @param[in]       value       Value
+ * @param[in]       maxLength   Maximum value length in characters
+ */
+static void appendString(String& json, const char* key, const char* value, size_t maxLength)
+{
+    size_t idx = 0U;
+
+    json += "\"";
+    json += key;
+    json += "\":\"";
+
+    for (idx = 0U; (maxLength > idx) && ('\0' != value[idx]); ++idx)
+    {
+        /* Skip characters, which would need to be escaped. */
+        if (('"' != value[idx]) && ('\\' != value[idx]) && (' ' <= value[idx]))
+        {
+            json += value[idx];
+        }
+    }
+
+    json += "\"";
+}
+
+/**
+ * Append a SHA-256 hash as hex string.
+ *
+ * @param[in,out]   json    JSON
+ * @param[in]       key     Key
+ * @param[in]       hash    Hash with HASH_SIZE bytes
+ */
+static void appendHash(String& json, const char* key, const uint8_t* hash)
+{
+    char   hex[2U * HASH_SIZE + 1U];
+    size_t idx = 0U;
+
+    for (idx = 0U; idx < HASH_SIZE; ++idx)
+    {
+        (void)snprintf(&hex[2U * idx], sizeof(hex) - 2U * idx, "%02x", hash[idx]);
+    }
+
+    json += "\"";
+    json += key;
+    json += "\":\"";
+    json += hex;
+    json += "\"";
+}
+
+/**
+ * Get the name of the partition type, like in the partition table CSV.
+ * Unknown types are provided as hex value.
+ *
+ * @param[in]   partition   Partition
+ * @param[out]  buffer      Buffer for the name
+ * @param[in]   size        Buffer size in byte
+ */
+static void getTypeName(const esp_partition_t* partition, char* buffer, size_t size)
+{
+    if (ESP_PARTITION_TYPE_APP == partition->type)
+    {
+        (void)snprintf(buffer, size, "app");
+    }
+    else if (ESP_PARTITION_TYPE_DATA == partition->type)
+    {
+        (void)snprintf(buffer, size, "data");
+    }
+    else
+    {
+        (void)snprintf(buffer, size, "0x%02x", static_cast<unsigned int>(partition->type));
+    }
+}
+
+/**
+ * Get the name of the partition subtype, like in the partition table CSV.
+ * Unknown subtypes are provided as hex value.
+ *
+ * @param[in]   partition   Partition
+ * @param[out]  buffer      Buffer for the name
+ * @param[in]   size        Buffer size in byte
+ */
+static void getSubtypeName(const esp_partition_t* partition, char* buffer, size_t size)
+{
+    uint8_t subtype = static_cast<uint8_t>(partition->subtype);
+    size_t  idx     = 0U;
+    bool    isFound = false;
+
+    if ((ESP_PARTITION_TYPE_APP == partition->type) && (APP_OTA_MIN <= subtype) && (APP_OTA_MAX >= subtype))
+    {
+        (void)snprintf(buffer, size, "ota_%u", static_cast<unsigned int>(subtype - APP_OTA_MIN));
+        isFound = true;
+    }
+
+    while ((false == isFound) && ((sizeof(SUBTYPE_NAMES) / sizeof(SUBTYPE_NAMES[0])) > idx))
+    {
+        if ((SUBTYPE_NAMES[idx].type == partition->type) && (SUBTYPE_NAMES[idx].subtype == subtype))
+        {
+            (void)snprintf(buffer, size, "%s", SUBTYPE_NAMES[idx].name);
+            isFound = true;
+        }
+
+        ++idx;
+    }
+
+    if (false == isFound)
+    {
+        (void)snprintf(buffer, size, "0x%02x", static_cast<unsigned int>(subtype));
+    }
+}
+
+/**
+ * Calculate the SHA-256 hash of the beginning of a partition.
+ *
+ * @param[in]   partition   Partition
+ * @param[in]   size        Size in byte, which is hashed.
+ * @param[out]  hash        Hash with HASH_SIZE bytes
+ *
+ * @return If successful, it will return true otherwise false.
+ */
+static bool hashPartition(const esp_partition_t* partition, size_t size, uint8_t* hash)
+{
+    bool     isSuccessful = false;
+    uint8_t* buffer       = nullptr;
+
+    if (partition->size >= size)
+    {
+        buffer = new (std::nothrow) uint8_t[READ_BUFFER_SIZE];
+    }
+
+    if (nullptr != buffer)
+    {
+        mbedtls_sha256_context context;
+        size_t                 offset = 0U;
+
+        isSuccessful = true;
+
+        /* The SHA peripheral is used by mbedTLS, if available. */
+        mbedtls_sha256_init(&context);
+        (void)mbedtls_sha256_starts(&context, 0);
+
+        while ((size > offset) && (true == isSuccessful))
+        {
+            size_t readSize = std::min(READ_BUFFER_SIZE, size - offset);
+
+            if (ESP_OK != esp_partition_read(partition, offset, buffer, readSize))
+            {
+                isSuccessful = false;
+            }
+            else
+            {
+                (void)mbedtls_sha256_update(&context, buffer, readSize);
+                offset += readSize;
+            }
+        }
+
+        if (true == isSuccessful)
+        {
+            isSuccessful = (0 == mbedtls_sha256_finish(&context, hash));
+        }
+
+        mbedtls_sha256_free(&context);
+        delete[] buffer;
+    }
+
+    return isSuccessful;
+}
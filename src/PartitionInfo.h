@@ -0,0 +1,93 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PartitionInfo.h
+ * @brief  Partition table and installed images
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef PARTITION_INFO_H
+#define PARTITION_INFO_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <Arduino.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The partition information describes the partition table, the boot and
+ * running partition, the application descriptor of the installed app0
+ * and the SHA-256 hashes of the installed images. With the hashes, a
+ * client can skip the upload of an image, which is already installed.
+ *
+ * Reading the images takes a while, therefore the information is
+ * calculated once and cached until the next write. The upload handler
+ * invalidates it, whenever an upload starts or finishes.
+ *
+ * All functions must be called with the upload handler lock held.
+ */
+namespace PartitionInfo
+{
+    /**
+     * Get the partition information as JSON. It is calculated, if it is
+     * not in the cache.
+     *
+     * @param[out] json Partition information
+     */
+    void getInfo(String& json);
+
+    /**
+     * Invalidate the cached partition information, because a partition
+     * is written.
+     */
+    void invalidate();
+
+} /* namespace PartitionInfo */
+
+#endif /* PARTITION_INFO_H */
+
+/** @} */
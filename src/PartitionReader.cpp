@@ -0,0 +1,288 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PartitionReader.cpp
+ * @brief  Partition reader for downloads
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "PartitionReader.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <esp_log.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char    LOG_TAG[]                = "PartitionReader";
+
+/** Unit of the supported ranges. */
+static const char    RANGE_UNIT[]             = "bytes=";
+
+/** Readable data partition subtypes: coredump, fat, spiffs and littlefs. */
+static const uint8_t READABLE_DATA_SUBTYPES[] = { 0x03U, 0x81U, 0x82U, 0x83U };
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+HTTPStatusCode PartitionReader::open(const String& label, const String& range, const char*& error)
+{
+    HTTPStatusCode statusCode = STATUS_CODE_OK;
+
+    m_partition = nullptr;
+    m_start     = 0U;
+    m_end       = 0U;
+    m_offset    = 0U;
+    error       = nullptr;
+
+    if (true == label.isEmpty())
+    {
+        statusCode = STATUS_CODE_NOT_FOUND;
+        error      = "Partition not found!";
+    }
+    else
+    {
+        m_partition = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, label.c_str());
+
+        if (nullptr == m_partition)
+        {
+            statusCode = STATUS_CODE_NOT_FOUND;
+            error      = "Partition not found!";
+        }
+        else if (false == isReadable(m_partition))
+        {
+            m_partition = nullptr;
+            statusCode  = STATUS_CODE_FORBIDDEN;
+            error       = "Partition is not readable!";
+        }
+        else if (true == range.isEmpty())
+        {
+            m_end = m_partition->size;
+        }
+        else if (false == parseRange(range, m_partition->size, m_start, m_end))
+        {
+            /* The partition is kept, because the response contains its size. */
+            statusCode = STATUS_CODE_RANGE_NOT_SATISFIABLE;
+            error      = "Range not satisfiable!";
+        }
+        else
+        {
+            statusCode = STATUS_CODE_PARTIAL_CONTENT;
+        }
+    }
+
+    if (nullptr == error)
+    {
+        m_offset = m_start;
+
+        ESP_LOGI(LOG_TAG, "Reading %s at offset %u (%u bytes).", m_partition->label, m_start, getSize());
+    }
+
+    return statusCode;
+}
+
+size_t PartitionReader::read(uint8_t* buffer, size_t size)
+{
+    size_t readSize = 0U;
+
+    if ((nullptr != m_partition) && (m_end > m_offset) && (nullptr != buffer))
+    {
+        /* Read up to the next block boundary. */
+        readSize = std::min(size, BLOCK_SIZE - (m_offset % BLOCK_SIZE));
+        readSize = std::min(readSize, m_end - m_offset);
+
+        if (ESP_OK != esp_partition_read(m_partition, m_offset, buffer, readSize))
+        {
+            ESP_LOGE(LOG_TAG, "Failed to read %s at offset %u.", m_partition->label, m_offset);
+
+            /* Stop reading. */
+            m_end    = m_offset;
+            readSize = 0U;
+        }
+        else
+        {
+            m_offset += readSize;
+        }
+    }
+
+    return readSize;
+}
+
+void PartitionReader::getContentRange(String& value) const
+{
+    value.clear();
+
+    if (nullptr == m_partition)
+    {
+        /* No partition. */
+    }
+    /* Unsatisfiable range */
+    else if (m_start == m_end)
+    {
+        value  = "bytes */";
+        value += m_partition->size;
+    }
+    else
+    {
+        value  = "bytes ";
+        value += m_start;
+        value += "-";
+        value += m_end - 1U;
+        value += "/";
+        value += m_partition->size;
+    }
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+bool PartitionReader::isReadable(const esp_partition_t* partition)
+{
+    bool   isReadable = (ESP_PARTITION_TYPE_APP == partition->type);
+    size_t idx        = 0U;
+
+    if (ESP_PARTITION_TYPE_DATA == partition->type)
+    {
+        for (idx = 0U; (false == isReadable) && (sizeof(READABLE_DATA_SUBTYPES) > idx); ++idx)
+        {
+            isReadable = (READABLE_DATA_SUBTYPES[idx] == static_cast<uint8_t>(partition->subtype));
+        }
+    }
+
+    return isReadable;
+}
+
+bool PartitionReader::parseRange(const String& range, size_t size, size_t& start, size_t& end)
+{
+    bool        isValid = false;
+    const char* spec    = range.c_str();
+    char*       next    = nullptr;
+
+    if ((0U == size) || (0 != strncmp(spec, RANGE_UNIT, strlen(RANGE_UNIT))))
+    {
+        /* Unsupported range unit. */
+    }
+    else
+    {
+        spec += strlen(RANGE_UNIT);
+
+        /* Suffix range, e.g. "-4096" for the last 4096 bytes. */
+        if ('-' == spec[0])
+        {
+            unsigned long suffix = 0U;
+
+            if (0 != isdigit(spec[1]))
+            {
+                suffix = strtoul(&spec[1], &next, 10);
+
+                if (('\0' == *next) && (0U < suffix))
+                {
+                    start   = (size > suffix) ? (size - suffix) : 0U;
+                    end     = size;
+                    isValid = true;
+                }
+            }
+        }
+        /* Range with start and optional end, e.g. "0-4095" or "4096-". */
+        else if (0 != isdigit(spec[0]))
+        {
+            unsigned long first = strtoul(spec, &next, 10);
+
+            if (('-' != *next) || (size <= first))
+            {
+                /* Invalid or not satisfiable. */
+            }
+            else if ('\0' == next[1])
+            {
+                start   = first;
+                end     = size;
+                isValid = true;
+            }
+            else if (0 != isdigit(next[1]))
+            {
+                const char*   lastSpec = &next[1];
+                unsigned long last     = strtoul(lastSpec, &next, 10);
+
+                if (('\0' == *next) && (first <= last))
+                {
+                    start   = first;
+                    end     = std::min(static_cast<size_t>(last), size - 1U) + 1U;
+                    isValid = true;
+                }
+            }
+            else
+            {
+                /* Invalid range end. */
+            }
+        }
+        else
+        {
+            /* Invalid range, e.g. multiple ranges are not supported. */
+        }
+    }
+
+    return isValid;
+}
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
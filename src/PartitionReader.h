@@ -0,0 +1,188 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PartitionReader.h
+ * @brief  Partition reader for downloads
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef PARTITION_READER_H
+#define PARTITION_READER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+#include <esp_partition.h>
+
+#include "HttpStatus.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Reads a partition or a byte range of it for a download, e.g. a coredump
+ * or a backup of the filesystem. The data is read block by block, aligned
+ * to the flash sectors, so a partition is never buffered completely.
+ *
+ * Only application partitions and the data partitions with a coredump or
+ * a filesystem can be read. The others are refused, because e.g. the NVS
+ * contains the wifi credentials.
+ */
+class PartitionReader
+{
+public:
+
+    /** Size of a read block in byte. Reads are aligned to it. */
+    static const size_t BLOCK_SIZE = SPI_FLASH_SEC_SIZE;
+
+    /**
+     * Constructs the partition reader.
+     */
+    PartitionReader() :
+        m_partition(nullptr),
+        m_start(0U),
+        m_end(0U),
+        m_offset(0U)
+    {
+    }
+
+    /**
+     * Destroys the partition reader.
+     */
+    ~PartitionReader()
+    {
+    }
+
+    /**
+     * Open a partition for reading.
+     *
+     * @param[in]   label   Partition label
+     * @param[in]   range   Value of the Range request header, empty for the whole partition.
+     *                      A single byte range is supported, e.g. "bytes=0-4095", "bytes=4096-" or "bytes=-4096".
+     * @param[out]  error   Error description, if not successful.
+     *
+     * @return STATUS_CODE_OK for the whole partition, STATUS_CODE_PARTIAL_CONTENT for
+     *         a range, otherwise the error status code.
+     */
+    HTTPStatusCode open(const String& label, const String& range, const char*& error);
+
+    /**
+     * Read the next block. The first block of a range ends at a block boundary,
+     * which aligns all further reads.
+     *
+     * @param[out]  buffer  Buffer
+     * @param[in]   size    Buffer size in byte, should be BLOCK_SIZE.
+     *
+     * @return Number of read bytes. 0 if all are read or on a flash error.
+     */
+    size_t read(uint8_t* buffer, size_t size);
+
+    /**
+     * Get the number of bytes, which will be read in total.
+     *
+     * @return Size in byte
+     */
+    size_t getSize() const
+    {
+        return m_end - m_start;
+    }
+
+    /**
+     * Get the value of the Content-Range response header. Without partition
+     * it is empty, for an unsatisfiable range it contains the partition size only.
+     * It is used for partial content and for an unsatisfiable range.
+     *
+     * @param[out] value    Header value, e.g. "bytes 0-4095/65536".
+     */
+    void getContentRange(String& value) const;
+
+    /**
+     * Get the label of the opened partition.
+     *
+     * @return Partition label or an empty string.
+     */
+    const char* getLabel() const
+    {
+        return (nullptr == m_partition) ? "" : m_partition->label;
+    }
+
+private:
+
+    const esp_partition_t* m_partition; /**< Opened partition */
+    size_t                 m_start;     /**< Start offset in the partition in byte */
+    size_t                 m_end;       /**< End offset in the partition in byte, exclusive */
+    size_t                 m_offset;    /**< Offset of the next read */
+
+    /* An instance shall not be copied. */
+    PartitionReader(const PartitionReader& reader);
+    PartitionReader& operator=(const PartitionReader& reader);
+
+    /**
+     * Is the partition readable?
+     *
+     * @param[in] partition Partition
+     *
+     * @return If readable, it will return true otherwise false.
+     */
+    static bool isReadable(const esp_partition_t* partition);
+
+    /**
+     * Parse a single byte range.
+     *
+     * @param[in]   range   Value of the Range request header
+     * @param[in]   size    Partition size in byte
+     * @param[out]  start   Start offset in byte
+     * @param[out]  end     End offset in byte, exclusive
+     *
+     * @return If the range is valid and satisfiable, it will return true otherwise false.
+     */
+    static bool parseRange(const String& range, size_t size, size_t& start, size_t& end);
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif /* PARTITION_READER_H */
+
+/** @} */
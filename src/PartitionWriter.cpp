@@ -0,0 +1,609 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PartitionWriter.cpp
+ * @brief  Sector wise writing of an image to a flash partition.
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "PartitionWriter.h"
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <new>
+
+#include <esp_log.h>
+#include <esp_ota_ops.h>
+#include <esp_image_format.h>
+#include <esp_timer.h>
+
+#include "UploadMetrics.h"
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char LOG_TAG[] = "PartitionWriter";
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+bool PartitionWriter::begin(const esp_partition_t* partition, size_t imageSize)
+{
+    bool isSuccessful = false;
+
+    abort();
+
+    m_error = ERROR_NONE;
+
+    if (nullptr == partition)
+    {
+        m_error = ERROR_PARTITION_NOT_FOUND;
+    }
+    else if ((SIZE_UNKNOWN != imageSize) && (partition->size < imageSize))
+    {
+        ESP_LOGE(LOG_TAG, "Image size %u exceeds partition '%s' size %" PRIu32 ".", imageSize, partition->label, partition->size);
+        m_error = ERROR_SIZE;
+    }
+    else
+    {
+        m_partition        = partition;
+        m_imageSize        = imageSize;
+        m_written          = 0U;
+        m_bufferSize       = 0U;
+        m_unchangedSectors = 0U;
+        m_erasedSize       = 0U;
+        m_isRunning        = true;
+        isSuccessful       = true;
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::setImageSize(size_t imageSize)
+{
+    bool isSuccessful = false;
+
+    if ((true == m_isRunning) && (0U == m_written))
+    {
+        if ((SIZE_UNKNOWN != imageSize) && (m_partition->size < imageSize))
+        {
+            ESP_LOGE(LOG_TAG, "Image size %u exceeds partition '%s' size %" PRIu32 ".", imageSize, m_partition->label, m_partition->size);
+            m_error = ERROR_SIZE;
+        }
+        else
+        {
+            m_imageSize  = imageSize;
+            isSuccessful = true;
+        }
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::enableBackup(size_t sectors)
+{
+    bool isSuccessful = false;
+
+    if ((true == m_isRunning) && (0U == m_written))
+    {
+        releaseBackup();
+
+        if (0U == sectors)
+        {
+            isSuccessful = true;
+        }
+        else
+        {
+            m_backup = new (std::nothrow) uint8_t[sectors * SECTOR_SIZE];
+
+            if (nullptr == m_backup)
+            {
+                ESP_LOGE(LOG_TAG, "No memory for %u backup sectors.", sectors);
+                m_error = ERROR_NO_MEMORY;
+            }
+            else
+            {
+                m_backupSectors = sectors;
+                isSuccessful    = true;
+            }
+        }
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::setErasedSize(size_t size)
+{
+    bool isSuccessful = false;
+
+    if ((true == m_isRunning) && (0U == m_written))
+    {
+        m_erasedSize = std::min(size, static_cast<size_t>(m_partition->size));
+        isSuccessful = true;
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::setExpectedHash(const uint8_t* hash)
+{
+    bool isSuccessful = false;
+
+    if ((true == m_isRunning) && (0U == m_written))
+    {
+        releaseHash();
+
+        if (nullptr != hash)
+        {
+            /* The SHA peripheral is used by mbedTLS, if available. */
+            mbedtls_sha256_init(&m_hashContext);
+            (void)mbedtls_sha256_starts(&m_hashContext, 0);
+            memcpy(m_expectedHash, hash, HASH_SIZE);
+            m_isHashEnabled = true;
+        }
+
+        isSuccessful = true;
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::write(const uint8_t* data, size_t size)
+{
+    bool isSuccessful = false;
+
+    if ((true == m_isRunning) && (ERROR_NONE == m_error) && (nullptr != data))
+    {
+        size_t maxSize = (SIZE_UNKNOWN == m_imageSize) ? m_partition->size : m_imageSize;
+        size_t offset  = 0U;
+
+        if ((maxSize - m_written) < size)
+        {
+            ESP_LOGE(LOG_TAG, "Image exceeds its size of %u bytes.", maxSize);
+            m_error = ERROR_SIZE;
+        }
+        /* A firmware image always starts with the magic byte. */
+        else if ((true == isApp()) && (0U == m_written) && (0U < size) && (ESP_IMAGE_HEADER_MAGIC != data[0]))
+        {
+            ESP_LOGE(LOG_TAG, "Wrong magic byte 0x%02X.", data[0]);
+            m_error = ERROR_MAGIC_BYTE;
+        }
+        else
+        {
+            if (true == m_isHashEnabled)
+            {
+                (void)mbedtls_sha256_update(&m_hashContext, data, size);
+            }
+
+            while ((size > offset) && (ERROR_NONE == m_error))
+            {
+                size_t chunkSize = std::min(SECTOR_SIZE - m_bufferSize, size - offset);
+
+                memcpy(&m_buffer[m_bufferSize], &data[offset], chunkSize);
+                m_bufferSize += chunkSize;
+                m_written    += chunkSize;
+                offset       += chunkSize;
+
+                if (SECTOR_SIZE == m_bufferSize)
+                {
+                    (void)flushSector();
+                }
+            }
+        }
+
+        isSuccessful = (ERROR_NONE == m_error);
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::readOriginal(size_t offset, uint8_t* data, size_t size)
+{
+    bool isSuccessful = false;
+
+    if ((nullptr != m_partition) && (nullptr != data) && (m_partition->size >= offset) && ((m_partition->size - offset) >= size))
+    {
+        size_t currentSector = (true == m_isRunning) ? getCurrentSector() : 0U;
+        size_t dataOffset    = 0U;
+
+        isSuccessful         = true;
+
+        while ((size > dataOffset) && (true == isSuccessful))
+        {
+            size_t sector         = offset / SECTOR_SIZE;
+            size_t sectorOffset   = offset % SECTOR_SIZE;
+            size_t chunkSize      = std::min(SECTOR_SIZE - sectorOffset, size - dataOffset);
+
+            /* Not written yet, the flash has still its original content. */
+            if (sector >= currentSector)
+            {
+                if (ESP_OK != esp_partition_read(m_partition, offset, &data[dataOffset], chunkSize))
+                {
+                    isSuccessful = false;
+                }
+            }
+            /* Already written, but its original content is kept in RAM. */
+            else if ((nullptr != m_backup) && (m_backupSectors >= (currentSector - sector)))
+            {
+                const uint8_t* backupSector = &m_backup[(sector % m_backupSectors) * SECTOR_SIZE];
+
+                memcpy(&data[dataOffset], &backupSector[sectorOffset], chunkSize);
+            }
+            else
+            {
+                ESP_LOGE(LOG_TAG, "Original content of sector %u is not available anymore.", sector);
+                isSuccessful = false;
+            }
+
+            offset     += chunkSize;
+            dataOffset += chunkSize;
+        }
+
+        if ((false == isSuccessful) && (true == m_isRunning))
+        {
+            m_error = ERROR_READ;
+        }
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::end()
+{
+    bool isSuccessful = false;
+
+    if (true == m_isRunning)
+    {
+        if ((ERROR_NONE == m_error) && (0U < m_bufferSize))
+        {
+            (void)flushSector();
+        }
+
+        if (ERROR_NONE != m_error)
+        {
+            /* Error already set. */
+        }
+        else if ((0U == m_written) ||
+                 ((SIZE_UNKNOWN != m_imageSize) && (m_imageSize != m_written)))
+        {
+            ESP_LOGE(LOG_TAG, "Image incomplete, %u bytes written.", m_written);
+            m_error = ERROR_INCOMPLETE;
+        }
+        else if (false == verifyHash())
+        {
+            ESP_LOGE(LOG_TAG, "Image hash mismatch.");
+            m_error = ERROR_HASH;
+        }
+        else if (false == isApp())
+        {
+            ESP_LOGI(LOG_TAG, "%u sectors unchanged.", m_unchangedSectors);
+            isSuccessful = true;
+        }
+        /* Make the firmware image bootable by writing its header. */
+        else if (ESP_OK != esp_partition_write(m_partition, 0U, m_header, std::min(HEADER_SIZE, m_written)))
+        {
+            m_error = ERROR_WRITE;
+        }
+        /* The boot partition is only changed, if the image is valid. */
+        else if (ESP_OK != esp_ota_set_boot_partition(m_partition))
+        {
+            ESP_LOGE(LOG_TAG, "Firmware image in '%s' is invalid.", m_partition->label);
+            m_error = ERROR_ACTIVATE;
+        }
+        else
+        {
+            ESP_LOGI(LOG_TAG, "%u sectors unchanged.", m_unchangedSectors);
+            isSuccessful = true;
+        }
+
+        releaseBackup();
+        releaseHash();
+        m_bufferSize = 0U;
+        m_isRunning  = false;
+    }
+
+    return isSuccessful;
+}
+
+void PartitionWriter::abort()
+{
+    releaseBackup();
+    releaseHash();
+    m_bufferSize = 0U;
+    m_isRunning  = false;
+}
+
+const char* PartitionWriter::getErrorString() const
+{
+    const char* errorString = "Unknown error";
+
+    switch (m_error)
+    {
+    case ERROR_NONE:
+        errorString = "No error";
+        break;
+
+    case ERROR_PARTITION_NOT_FOUND:
+        errorString = "Partition not found";
+        break;
+
+    case ERROR_SIZE:
+        errorString = "Image doesn't fit";
+        break;
+
+    case ERROR_MAGIC_BYTE:
+        errorString = "Wrong magic byte";
+        break;
+
+    case ERROR_ERASE:
+        errorString = "Flash erase failed";
+        break;
+
+    case ERROR_WRITE:
+        errorString = "Flash write failed";
+        break;
+
+    case ERROR_READ:
+        errorString = "Flash read failed";
+        break;
+
+    case ERROR_NO_MEMORY:
+        errorString = "Out of memory";
+        break;
+
+    case ERROR_INCOMPLETE:
+        errorString = "Image incomplete";
+        break;
+
+    case ERROR_ACTIVATE:
+        errorString = "Image not bootable";
+        break;
+
+    case ERROR_HASH:
+        errorString = "Image hash mismatch";
+        break;
+
+    default:
+        break;
+    }
+
+    return errorString;
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+bool PartitionWriter::compareSector(size_t address, const uint8_t* original, bool& isEqual, bool& isErased) const
+{
+    bool   isSuccessful = true;
+    size_t offset       = 0U;
+
+    isEqual             = true;
+    isErased            = true;
+
+    while ((SECTOR_SIZE > offset) && ((true == isEqual) || (true == isErased)) && (true == isSuccessful))
+    {
+        uint8_t        chunk[COMPARE_SIZE];
+        const uint8_t* content = nullptr;
+        size_t         idx     = 0U;
+
+        if (nullptr != original)
+        {
+            content = &original[offset];
+        }
+        else if (ESP_OK == esp_partition_read(m_partition, address + offset, chunk, COMPARE_SIZE))
+        {
+            content = chunk;
+        }
+        else
+        {
+            isSuccessful = false;
+        }
+
+        if (nullptr != content)
+        {
+            if (0 != memcmp(content, &m_buffer[offset], COMPARE_SIZE))
+            {
+                isEqual = false;
+            }
+
+            for (idx = 0U; (COMPARE_SIZE > idx) && (true == isErased); ++idx)
+            {
+                if (0xFFU != content[idx])
+                {
+                    isErased = false;
+                }
+            }
+        }
+
+        offset += COMPARE_SIZE;
+    }
+
+    return isSuccessful;
+}
+
+bool PartitionWriter::flushSector()
+{
+    size_t   sector   = getCurrentSector();
+    size_t   address  = sector * SECTOR_SIZE;
+    size_t   skip      = 0U;
+    bool     isEqual   = false;
+    bool     isErased  = false;
+    uint8_t* original  = (nullptr != m_backup) ? &m_backup[(sector % m_backupSectors) * SECTOR_SIZE] : nullptr;
+    uint32_t eraseTime = 0U;
+    uint32_t writeTime = 0U;
+    size_t   written   = 0U;
+
+    /* The rest of a partial sector shall be erased. */
+    memset(&m_buffer[m_bufferSize], 0xFF, SECTOR_SIZE - m_bufferSize);
+
+    /* Keep the original content, before its lost. */
+    if ((nullptr != original) &&
+        (ESP_OK != esp_partition_read(m_partition, address, original, SECTOR_SIZE)))
+    {
+        m_error = ERROR_READ;
+    }
+    /* A pre-erased sector needs no comparison. */
+    else if (m_erasedSize > address)
+    {
+        isErased = true;
+    }
+    else if (false == compareSector(address, original, isEqual, isErased))
+    {
+        m_error = ERROR_READ;
+    }
+    else
+    {
+        /* Compared successful. */
+    }
+
+    if (ERROR_NONE != m_error)
+    {
+        /* Error already set. */
+    }
+    /* The first sector of a firmware image is always written, because its header is written at the end. */
+    else if ((true == isEqual) && ((false == isApp()) || (0U != sector)))
+    {
+        ++m_unchangedSectors;
+    }
+    else
+    {
+        int64_t startTime = esp_timer_get_time();
+
+        if ((false == isErased) &&
+            (ESP_OK != esp_partition_erase_range(m_partition, address, SECTOR_SIZE)))
+        {
+            ESP_LOGE(LOG_TAG, "Failed to erase sector at 0x%08X.", address);
+            m_error = ERROR_ERASE;
+        }
+        else
+        {
+            int64_t writeStartTime = esp_timer_get_time();
+
+            eraseTime = (false == isErased) ? static_cast<uint32_t>(writeStartTime - startTime) : 0U;
+
+            /* The firmware image header is written at the end. */
+            if ((true == isApp()) && (0U == sector))
+            {
+                skip = std::min(HEADER_SIZE, m_bufferSize);
+                memcpy(m_header, m_buffer, skip);
+            }
+
+            if (m_bufferSize > skip)
+            {
+                if (ESP_OK != esp_partition_write(m_partition, address + skip, &m_buffer[skip], m_bufferSize - skip))
+                {
+                    ESP_LOGE(LOG_TAG, "Failed to write sector at 0x%08X.", address);
+                    m_error = ERROR_WRITE;
+                }
+                else
+                {
+                    written = m_bufferSize - skip;
+                }
+            }
+
+            writeTime = static_cast<uint32_t>(esp_timer_get_time() - writeStartTime);
+        }
+    }
+
+    if (ERROR_NONE == m_error)
+    {
+        UploadMetrics::addSector(eraseTime, writeTime, written);
+    }
+
+    m_bufferSize = 0U;
+
+    return (ERROR_NONE == m_error);
+}
+
+void PartitionWriter::releaseBackup()
+{
+    delete[] m_backup;
+    m_backup        = nullptr;
+    m_backupSectors = 0U;
+}
+
+bool PartitionWriter::verifyHash()
+{
+    bool isSuccessful = true;
+
+    if (true == m_isHashEnabled)
+    {
+        uint8_t hash[HASH_SIZE];
+
+        isSuccessful = (0 == mbedtls_sha256_finish(&m_hashContext, hash)) &&
+                       (0 == memcmp(hash, m_expectedHash, HASH_SIZE));
+    }
+
+    return isSuccessful;
+}
+
+void PartitionWriter::releaseHash()
+{
+    if (true == m_isHashEnabled)
+    {
+        mbedtls_sha256_free(&m_hashContext);
+        m_isHashEnabled = false;
+    }
+}
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
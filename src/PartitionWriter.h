@@ -0,0 +1,380 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PartitionWriter.h
+ * @brief  Sector wise writing of an image to a flash partition.
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef PARTITION_WRITER_H
+#define PARTITION_WRITER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Writes an image sequentially to a flash partition.
+ *
+ * Unlike the Arduino updater, only the sector which is written next is erased.
+ * All sectors after the current write position keep their original content,
+ * which can be read back during the image write. Optional the original content
+ * of the last written sectors is kept in RAM too. This allows to patch the
+ * partition content in place.
+ *
+ * Sectors, which already have the same content, are neither erased nor written.
+ * This saves time and flash wear, e.g. if only a few files of a filesystem
+ * image changed.
+ *
+ * A firmware image becomes bootable not until it is completely written.
+ * If a SHA-256 hash is expected, it is calculated over the written image and
+ * must match too.
+ */
+class PartitionWriter
+{
+public:
+
+    /** Image size, if its not known in advance. */
+    static const size_t SIZE_UNKNOWN = 0xFFFFFFFFU;
+
+    /** Flash sector size in byte. */
+    static const size_t SECTOR_SIZE  = SPI_FLASH_SEC_SIZE;
+
+    /** SHA-256 hash size in byte. */
+    static const size_t HASH_SIZE    = 32U;
+
+    /**
+     * Error reasons.
+     */
+    enum Error
+    {
+        ERROR_NONE = 0,            /**< No error */
+        ERROR_PARTITION_NOT_FOUND, /**< Partition not found */
+        ERROR_SIZE,                /**< Image doesn't fit into partition */
+        ERROR_MAGIC_BYTE,          /**< Firmware image magic byte is wrong */
+        ERROR_ERASE,               /**< Flash erase failed */
+        ERROR_WRITE,               /**< Flash write failed */
+        ERROR_READ,                /**< Flash read failed */
+        ERROR_NO_MEMORY,           /**< Out of memory */
+        ERROR_INCOMPLETE,          /**< Image is incomplete */
+        ERROR_ACTIVATE,            /**< Firmware image is not bootable */
+        ERROR_HASH                 /**< Image hash mismatch */
+    };
+
+    /**
+     * Constructs the partition writer.
+     */
+    PartitionWriter() :
+        m_partition(nullptr),
+        m_imageSize(SIZE_UNKNOWN),
+        m_written(0U),
+        m_buffer(),
+        m_bufferSize(0U),
+        m_header(),
+        m_backup(nullptr),
+        m_backupSectors(0U),
+        m_unchangedSectors(0U),
+        m_erasedSize(0U),
+        m_hashContext(),
+        m_isHashEnabled(false),
+        m_expectedHash(),
+        m_isRunning(false),
+        m_error(ERROR_NONE)
+    {
+    }
+
+    /**
+     * Destroys the partition writer.
+     */
+    ~PartitionWriter()
+    {
+        abort();
+    }
+
+    /**
+     * Begin writing a new image into the partition.
+     *
+     * @param[in] partition Target partition
+     * @param[in] imageSize Image size in byte or SIZE_UNKNOWN.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool begin(const esp_partition_t* partition, size_t imageSize);
+
+    /**
+     * Change the expected image size. This is only possible before the
+     * first data is written.
+     *
+     * @param[in] imageSize Image size in byte or SIZE_UNKNOWN.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool setImageSize(size_t imageSize);
+
+    /**
+     * Keep the original content of the last written sectors in RAM, so they
+     * can be read back with readOriginal(). This must be enabled before the
+     * first data is written.
+     *
+     * @param[in] sectors   Number of sectors to keep.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool enableBackup(size_t sectors);
+
+    /**
+     * Tell that the partition is already erased from its begin up to the
+     * given size, e.g. by a background erase before the upload started.
+     * These sectors are written without erase and comparison. This must be
+     * set before the first data is written.
+     *
+     * @param[in] size  Erased size in byte, a multiple of the sector size.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool setErasedSize(size_t size);
+
+    /**
+     * Set the expected SHA-256 hash of the image. It is verified at the end,
+     * before a firmware image is set bootable. This must be set before the
+     * first data is written.
+     *
+     * @param[in] hash  Hash with HASH_SIZE bytes or nullptr to disable the verification.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool setExpectedHash(const uint8_t* hash);
+
+    /**
+     * Write the next image data.
+     *
+     * @param[in] data  Image data
+     * @param[in] size  Image data size in byte
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool write(const uint8_t* data, size_t size);
+
+    /**
+     * Read the original partition content, as it was before the image write
+     * began. This is possible for all sectors, which are not written yet and
+     * for the backup sectors.
+     *
+     * @param[in]  offset    Offset in the partition
+     * @param[out] data      Buffer for the content
+     * @param[in]  size      Number of bytes to read
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool readOriginal(size_t offset, uint8_t* data, size_t size);
+
+    /**
+     * Finish writing the image.
+     * A firmware image is verified and set as boot partition.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool end();
+
+    /**
+     * Abort writing the image.
+     */
+    void abort();
+
+    /**
+     * Is an image write in progress?
+     *
+     * @return If an image write is in progress, it will return true otherwise false.
+     */
+    bool isRunning() const
+    {
+        return m_isRunning;
+    }
+
+    /**
+     * Get the target partition.
+     *
+     * @return Partition or nullptr, if no image write was started.
+     */
+    const esp_partition_t* getPartition() const
+    {
+        return m_partition;
+    }
+
+    /**
+     * Get number of image bytes, which are written.
+     *
+     * @return Image size in byte
+     */
+    size_t getWrittenSize() const
+    {
+        return m_written;
+    }
+
+    /**
+     * Get number of sectors, which were skipped because their content was unchanged.
+     *
+     * @return Number of unchanged sectors
+     */
+    size_t getUnchangedSectors() const
+    {
+        return m_unchangedSectors;
+    }
+
+    /**
+     * Get the last error.
+     *
+     * @return Error
+     */
+    Error getError() const
+    {
+        return m_error;
+    }
+
+    /**
+     * Get a user friendly description of the last error.
+     *
+     * @return Error description
+     */
+    const char* getErrorString() const;
+
+private:
+
+    /**
+     * Number of bytes at the begin of a firmware image, which are written
+     * at the end. Until then the image is not bootable.
+     */
+    static const size_t HEADER_SIZE  = 16U;
+
+    /** Chunk size in byte, used to compare a sector with the flash content. */
+    static const size_t COMPARE_SIZE = 256U;
+
+    const esp_partition_t* m_partition;               /**< Target partition */
+    size_t                 m_imageSize;               /**< Expected image size in byte */
+    size_t                 m_written;                 /**< Number of image bytes written to the sector buffer. */
+    uint8_t                m_buffer[SECTOR_SIZE];     /**< Sector buffer */
+    size_t                 m_bufferSize;              /**< Number of bytes in the sector buffer. */
+    uint8_t                m_header[HEADER_SIZE];     /**< Firmware image header, which is written at the end. */
+    uint8_t*               m_backup;                  /**< Original content of the last written sectors. */
+    size_t                 m_backupSectors;           /**< Number of backup sectors. */
+    size_t                 m_unchangedSectors;        /**< Number of skipped unchanged sectors. */
+    size_t                 m_erasedSize;              /**< Size of the already erased area at the partition begin. */
+    mbedtls_sha256_context m_hashContext;             /**< Image hash calculation, hardware accelerated. */
+    bool                   m_isHashEnabled;           /**< Is the image hash verified? */
+    uint8_t                m_expectedHash[HASH_SIZE]; /**< Expected image hash */
+    bool                   m_isRunning;               /**< Is an image write in progress? */
+    Error                  m_error;                   /**< Last error */
+
+    /* An instance shall not be copied. */
+    PartitionWriter(const PartitionWriter& writer);
+    PartitionWriter& operator=(const PartitionWriter& writer);
+
+    /**
+     * Is the target partition an application partition?
+     *
+     * @return If application partition, it will return true otherwise false.
+     */
+    bool isApp() const
+    {
+        return (nullptr != m_partition) && (ESP_PARTITION_TYPE_APP == m_partition->type);
+    }
+
+    /**
+     * Get the index of the sector, which is filled in the sector buffer.
+     * All sectors before are already written.
+     *
+     * @return Sector index
+     */
+    size_t getCurrentSector() const
+    {
+        return (m_written - m_bufferSize) / SECTOR_SIZE;
+    }
+
+    /**
+     * Compare the sector buffer with the sector content.
+     *
+     * @param[in]  address   Sector address in the partition
+     * @param[in]  original  Sector content or nullptr to read it from flash.
+     * @param[out] isEqual   Is the sector content equal to the sector buffer?
+     * @param[out] isErased  Is the sector erased?
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool compareSector(size_t address, const uint8_t* original, bool& isEqual, bool& isErased) const;
+
+    /**
+     * Write the sector buffer to flash.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool flushSector();
+
+    /**
+     * Release the backup sectors.
+     */
+    void releaseBackup();
+
+    /**
+     * Finish the image hash calculation and verify it.
+     *
+     * @return If the hash matches, it will return true otherwise false.
+     */
+    bool verifyHash();
+
+    /**
+     * Stop the image hash calculation.
+     */
+    void releaseHash();
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif /* PARTITION_WRITER_H */
+
+/** @} */
@@ -0,0 +1,627 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PullUpdate.cpp
+ * @brief  Download firmware and filesystem images from a URL
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "PullUpdate.h"
+#include <Update.h>
+#include <esp_log.h>
+#include <esp_http_client.h>
+#include <esp_crt_bundle.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "UploadHandler.h"
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/** Download states */
+typedef enum
+{
+    PULL_STATE_IDLE = 0, /**< No download started yet */
+    PULL_STATE_RUNNING,  /**< Download is running */
+    PULL_STATE_FINISHED, /**< Download finished and image is written */
+    PULL_STATE_FAILED    /**< Download failed */
+
+} PullState;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void pullTask(void* parameters);
+static const char* download();
+static const char* openConnection(esp_http_client_handle_t client, bool& isConnected);
+static bool isRedirect(int statusCode);
+static const char* beginUpload(int64_t contentLength);
+static const char* writeUpload(const uint8_t* data, size_t size);
+static void finish(const char* error);
+static const char* getStateName(PullState state);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char           LOG_TAG[]           = "PullUpdate";
+
+/** Download task stack size in byte. TLS needs a large stack. */
+static const uint32_t       TASK_STACK_SIZE     = 8192U;
+
+/** Download task priority. It is the same as the one of the writer task. */
+static const UBaseType_t    TASK_PRIORITY       = 2U;
+
+/** Receive buffer size in byte. */
+static const size_t         BUFFER_SIZE         = 4096U;
+
+/** HTTP timeout in ms. */
+static const int            HTTP_TIMEOUT_MS     = 10000;
+
+/** Max. number of connection retries in a row without progress. */
+static const uint32_t       MAX_RETRIES         = 5U;
+
+/** Delay in ms before a connection is retried. */
+static const uint32_t       RETRY_DELAY_MS      = 2000U;
+
+/** Max. number of followed redirects per connection. */
+static const uint32_t       MAX_REDIRECTS       = 5U;
+
+/** Receive buffer. It is only used by the download task. */
+static uint8_t              gBuffer[BUFFER_SIZE];
+
+/** Current download state. */
+static volatile PullState   gState              = PULL_STATE_IDLE;
+
+/** URL of the image. */
+static String               gUrl;
+
+/** Expected SHA-256 of the written image as hex string or empty. */
+static String               gImageHash;
+
+/** Update command, which is U_FLASH or U_SPIFFS. */
+static int                  gCmd                = U_FLASH;
+
+/** Upload id of the upload, which is fed by the download. */
+static uint32_t             gUploadId           = 0U;
+
+/** Number of received bytes, which is the offset where a download resumes. */
+static volatile size_t      gOffset             = 0U;
+
+/** Image size in byte or 0 if unknown. */
+static volatile size_t      gSize               = 0U;
+
+/** Number of connection retries of the whole download. */
+static volatile uint32_t    gRetries            = 0U;
+
+/** Error description of the last failed download. */
+static const char* volatile gError              = nullptr;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+bool PullUpdate::start(const String& url, int cmd, const String& imageHash, const char*& error)
+{
+    bool isSuccessful = false;
+
+    if ((false == url.startsWith("http://")) && (false == url.startsWith("https://")))
+    {
+        error = "Invalid URL.";
+    }
+    else if (URL_MAX_LENGTH < url.length())
+    {
+        error = "URL too long.";
+    }
+    else
+    {
+        /* The upload handler lock serializes the start requests of the web server and the terminal. */
+        UploadHandler::lock();
+
+        if (true == isRunning())
+        {
+            error = "Download in progress.";
+        }
+        else if (true == UploadHandler::isUploadRunning())
+        {
+            error = "Upload in progress.";
+        }
+        else
+        {
+            gUrl       = url;
+            gImageHash = imageHash;
+            gCmd       = cmd;
+            gOffset    = 0U;
+            gSize      = 0U;
+            gRetries   = 0U;
+            gError     = nullptr;
+            gState     = PULL_STATE_RUNNING;
+
+            if (pdPASS != xTaskCreatePinnedToCore(pullTask, "pullUpdate", TASK_STACK_SIZE, nullptr, TASK_PRIORITY, nullptr, tskNO_AFFINITY))
+            {
+                gState = PULL_STATE_FAILED;
+                gError = "Failed to create download task.";
+                error  = gError;
+
+                ESP_LOGE(LOG_TAG, "%s", gError);
+            }
+            else
+            {
+                isSuccessful = true;
+
+                ESP_LOGI(LOG_TAG, "Download started: %s", gUrl.c_str());
+            }
+        }
+
+        UploadHandler::unlock();
+    }
+
+    return isSuccessful;
+}
+
+bool PullUpdate::isRunning()
+{
+    return (PULL_STATE_RUNNING == gState);
+}
+
+void PullUpdate::getStatus(String& json)
+{
+    PullState   state   = gState;
+    size_t      offset  = gOffset;
+    size_t      size    = gSize;
+    uint32_t    retries = gRetries;
+    const char* error   = (PULL_STATE_FAILED == state) ? gError : nullptr;
+
+    json  = "{\"state\":\"";
+    json += getStateName(state);
+    json += "\",\"target\":\"";
+    json += (U_SPIFFS == gCmd) ? "filesystem" : "firmware";
+    json += "\",\"offset\":";
+    json += offset;
+    json += ",\"size\":";
+    json += size;
+    json += ",\"retries\":";
+    json += retries;
+
+    if (nullptr != error)
+    {
+        json += ",\"error\":\"";
+        json += error;
+        json += "\"";
+    }
+
+    json += "}";
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * Download task, which runs once per download.
+ *
+ * @param[in] parameters    Task parameters, not used.
+ */
+static void pullTask(void* parameters)
+{
+    (void)parameters;
+
+    finish(download());
+
+    vTaskDelete(nullptr);
+}
+
+/**
+ * Download the image and pass it to the upload handler. A lost connection
+ * is resumed at the received offset.
+ *
+ * @return If successful, it will return nullptr otherwise the error description.
+ */
+static const char* download()
+{
+    const char*              error   = nullptr;
+    uint32_t                 retries = 0U;
+    bool                     isDone  = false;
+    esp_http_client_config_t config  = {};
+    esp_http_client_handle_t client  = nullptr;
+
+    config.url               = gUrl.c_str();
+    config.timeout_ms        = HTTP_TIMEOUT_MS;
+    config.buffer_size       = BUFFER_SIZE;
+    config.method            = HTTP_METHOD_GET;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+
+    client = esp_http_client_init(&config);
+
+    if (nullptr == client)
+    {
+        error = "Failed to initialize HTTP client.";
+    }
+
+    while ((nullptr == error) && (false == isDone))
+    {
+        bool isConnected = false;
+        bool isLost      = false;
+
+        error            = openConnection(client, isConnected);
+        isLost           = (false == isConnected);
+
+        /* Receive until the connection is lost or the image is complete. */
+        while ((nullptr == error) && (false == isDone))
+        {
+            int len = esp_http_client_read(client, reinterpret_cast<char*>(gBuffer), BUFFER_SIZE);
+
+            if (0 < len)
+            {
+                error   = writeUpload(gBuffer, static_cast<size_t>(len));
+                retries = 0U;
+            }
+            else if ((0 == len) && (true == esp_http_client_is_complete_data_received(client)))
+            {
+                isDone = true;
+            }
+            else
+            {
+                error  = "Connection lost.";
+                isLost = true;
+            }
+        }
+
+        (void)esp_http_client_close(client);
+
+        /* Only a lost connection is retried, but not a rejected image. */
+        if ((true == isLost) && (0U < gOffset) && (MAX_RETRIES > retries))
+        {
+            ESP_LOGW(LOG_TAG, "%s Resume at %u bytes.", error, gOffset);
+
+            ++retries;
+            ++gRetries;
+
+            vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
+            error = nullptr;
+        }
+    }
+
+    if (nullptr != client)
+    {
+        (void)esp_http_client_cleanup(client);
+    }
+
+    return error;
+}
+
+/**
+ * Open the connection and request the image from the received offset on.
+ * The upload is started with the first response.
+ *
+ * @param[in]   client      HTTP client
+ * @param[out]  isConnected Is the connection established?
+ *
+ * @return If successful, it will return nullptr otherwise the error description.
+ */
+static const char* openConnection(esp_http_client_handle_t client, bool& isConnected)
+{
+    const char* error  = nullptr;
+    size_t      offset = gOffset;
+    String      range  = String("bytes=") + offset + "-";
+
+    if (0U < offset)
+    {
+        (void)esp_http_client_set_header(client, "Range", range.c_str());
+    }
+
+    if (ESP_OK != esp_http_client_open(client, 0))
+    {
+        error = "Failed to connect.";
+    }
+    else
+    {
+        uint32_t redirects     = 0U;
+        int64_t  contentLength = esp_http_client_fetch_headers(client);
+        int      statusCode    = esp_http_client_get_status_code(client);
+
+        /* Unlike esp_http_client_perform(), a redirect must be followed explicit. */
+        while ((nullptr == error) && (true == isRedirect(statusCode)) && (MAX_REDIRECTS > redirects))
+        {
+            ++redirects;
+
+            /* The location of the response becomes the new URL. */
+            if (ESP_OK != esp_http_client_set_redirection(client))
+            {
+                error = "Invalid redirect.";
+            }
+            else
+            {
+                (void)esp_http_client_close(client);
+
+                if (ESP_OK != esp_http_client_open(client, 0))
+                {
+                    error      = "Failed to connect.";
+                    statusCode = 0;
+                }
+                else
+                {
+                    contentLength = esp_http_client_fetch_headers(client);
+                    statusCode    = esp_http_client_get_status_code(client);
+
+                    ESP_LOGI(LOG_TAG, "Redirected (status %d).", statusCode);
+                }
+            }
+        }
+
+        /* Without a valid response, the connection was lost meanwhile. */
+        isConnected           = (0 < statusCode);
+
+        if (nullptr != error)
+        {
+            /* Error already set. */
+        }
+        else if (0U == offset)
+        {
+            if (200 != statusCode)
+            {
+                error = "Download rejected by server.";
+            }
+            else
+            {
+                error = beginUpload(contentLength);
+            }
+        }
+        /* The server must continue at the offset, otherwise the image would be corrupted. */
+        else if (206 != statusCode)
+        {
+            error = "Server doesn't support range requests.";
+        }
+        else
+        {
+            /* Resume at the offset. */
+        }
+
+        if (nullptr == error)
+        {
+            ESP_LOGI(LOG_TAG, "Connected (status %d, offset %u).", statusCode, offset);
+        }
+    }
+
+    return error;
+}
+
+/**
+ * Is the HTTP status code a redirect, which provides a new location?
+ *
+ * @param[in] statusCode    HTTP status code
+ *
+ * @return If redirect, it will return true otherwise false.
+ */
+static bool isRedirect(int statusCode)
+{
+    return (301 == statusCode) || (302 == statusCode) || (303 == statusCode) ||
+           (307 == statusCode) || (308 == statusCode);
+}
+
+/**
+ * Begin the upload, which writes the downloaded image.
+ *
+ * @param[in] contentLength Content length of the response or a negative value if unknown.
+ *
+ * @return If successful, it will return nullptr otherwise the error description.
+ */
+static const char* beginUpload(int64_t contentLength)
+{
+    const char*             error = nullptr;
+    UploadHandler::Request  request;
+    UploadHandler::Response response;
+
+    if (0 < contentLength)
+    {
+        request.contentLength = String(static_cast<uint32_t>(contentLength));
+        gSize                 = static_cast<size_t>(contentLength);
+    }
+
+    request.imageHash = gImageHash;
+
+    UploadHandler::lock();
+
+    if (true == UploadHandler::isUploadRunning())
+    {
+        error = "Upload in progress.";
+    }
+    else
+    {
+        UploadHandler::beginRaw(request, gCmd);
+        UploadHandler::getResponse(response);
+
+        if (STATUS_CODE_OK != response.statusCode)
+        {
+            error = response.message;
+        }
+        else
+        {
+            gUploadId = UploadHandler::getUploadId();
+        }
+    }
+
+    UploadHandler::unlock();
+
+    return error;
+}
+
+/**
+ * Pass downloaded data to the upload.
+ *
+ * @param[in] data  Data
+ * @param[in] size  Data size in byte
+ *
+ * @return If successful, it will return nullptr otherwise the error description.
+ */
+static const char* writeUpload(const uint8_t* data, size_t size)
+{
+    const char* error = nullptr;
+
+    UploadHandler::lock();
+
+    if (gUploadId != UploadHandler::getUploadId())
+    {
+        error = "Upload replaced by another upload.";
+    }
+    else
+    {
+        UploadHandler::Response response;
+
+        UploadHandler::write(data, size);
+        UploadHandler::getResponse(response);
+
+        if (STATUS_CODE_OK != response.statusCode)
+        {
+            error = response.message;
+        }
+    }
+
+    UploadHandler::unlock();
+
+    /* Only written data is skipped, if the download resumes. */
+    if (nullptr == error)
+    {
+        gOffset += size;
+    }
+
+    return error;
+}
+
+/**
+ * Finish the upload and set the download result.
+ *
+ * @param[in] error Error description or nullptr if download was successful.
+ */
+static void finish(const char* error)
+{
+    const char* message      = error;
+    bool        isSuccessful = false;
+
+    UploadHandler::lock();
+
+    /* Don't touch an upload, which replaced this one. */
+    if ((0U != gUploadId) && (gUploadId != UploadHandler::getUploadId()))
+    {
+        message = "Upload replaced by another upload.";
+    }
+    else if (nullptr != error)
+    {
+        if (0U != gUploadId)
+        {
+            UploadHandler::abort();
+        }
+    }
+    else
+    {
+        UploadHandler::Response response;
+
+        UploadHandler::end();
+        UploadHandler::getResponse(response);
+
+        message      = response.message;
+        isSuccessful = (STATUS_CODE_OK == response.statusCode);
+    }
+
+    UploadHandler::unlock();
+
+    gUploadId = 0U;
+
+    /* The error is set first, because the state tells the status readers that it is valid. */
+    gError = (true == isSuccessful) ? nullptr : message;
+    gState = (true == isSuccessful) ? PULL_STATE_FINISHED : PULL_STATE_FAILED;
+
+    if (true == isSuccessful)
+    {
+        ESP_LOGI(LOG_TAG, "Download finished (%u bytes).", gOffset);
+    }
+    else
+    {
+        ESP_LOGE(LOG_TAG, "Download failed: %s", message);
+    }
+}
+
+/**
+ * Get the name of a download state, as used in the status.
+ *
+ * @param[in] state Download state
+ *
+ * @return State name
+ */
+static const char* getStateName(PullState state)
+{
+    const char* name = "idle";
+
+    switch (state)
+    {
+    case PULL_STATE_RUNNING:
+        name = "running";
+        break;
+
+    case PULL_STATE_FINISHED:
+        name = "finished";
+        break;
+
+    case PULL_STATE_FAILED:
+        name = "failed";
+        break;
+
+    case PULL_STATE_IDLE:
+    default:
+        break;
+    }
+
+    return name;
+}
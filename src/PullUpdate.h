@@ -0,0 +1,107 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   PullUpdate.h
+ * @brief  Download firmware and filesystem images from a URL
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef PULL_UPDATE_H
+#define PULL_UPDATE_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The pull update downloads an image via HTTP or HTTPS in a dedicated task
+ * and passes it to the upload handler. Therefore it uses the same pipeline
+ * as an upload, including decompression, delta patches and the hash check.
+ * A lost connection is resumed with a range request.
+ *
+ * Only one download can run at a time and it is not started, while an
+ * upload is running. An upload, which is started later, replaces it.
+ */
+namespace PullUpdate
+{
+    /** Max. URL length in byte, without string termination. */
+    static const size_t URL_MAX_LENGTH = 256U;
+
+    /**
+     * Start downloading an image.
+     *
+     * @param[in]   url         HTTP or HTTPS URL of the image
+     * @param[in]   cmd         U_FLASH for firmware or U_SPIFFS for filesystem.
+     * @param[in]   imageHash   Expected SHA-256 of the written image as hex string or empty.
+     * @param[out]  error       Error description, if start failed.
+     *
+     * @return If the download started, it will return true otherwise false.
+     */
+    bool start(const String& url, int cmd, const String& imageHash, const char*& error);
+
+    /**
+     * Is a download running?
+     *
+     * @return If running, it will return true otherwise false.
+     */
+    bool isRunning();
+
+    /**
+     * Get the status of the last download as JSON.
+     *
+     * @param[out] json Status with state, target, offset, size, retries and error.
+     */
+    void getStatus(String& json);
+
+} /* namespace PullUpdate */
+
+#endif /* PULL_UPDATE_H */
+
+/** @} */
@@ -0,0 +1,406 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   SerialUpload.cpp
+ * @brief  Binary upload via serial interface
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "SerialUpload.h"
+#include <Update.h>
+
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+
+#include "UploadHandler.h"
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static uint16_t getUInt16(const uint8_t* data);
+static uint32_t getUInt32(const uint8_t* data);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char LOG_TAG[] = "SerialUpload";
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+bool SerialUpload::begin(int cmd, size_t size, const String& imageHash, const char*& error)
+{
+    bool isSuccessful = false;
+
+    UploadHandler::lock();
+
+    if (true == UploadHandler::isUploadRunning())
+    {
+        error = "Upload in progress.";
+    }
+    else
+    {
+        UploadHandler::Request  request;
+        UploadHandler::Response response;
+
+        if (U_SPIFFS == cmd)
+        {
+            request.filesystemSize = String(size);
+        }
+        else
+        {
+            request.firmwareSize = String(size);
+        }
+
+        request.imageHash = imageHash;
+
+        UploadHandler::beginRaw(request, cmd);
+        UploadHandler::getResponse(response);
+
+        if (STATUS_CODE_OK != response.statusCode)
+        {
+            error = response.message;
+        }
+        else
+        {
+            m_uploadId                = UploadHandler::getUploadId();
+            m_size                    = size;
+            m_receivedSize            = 0U;
+            m_expectedSeq             = 0U;
+            m_isNakSent               = false;
+            m_frameLen                = 0U;
+            m_lastReceiveTime         = millis();
+            m_isBaudRateSwitchPending = (nullptr != m_baudRateHandler);
+            m_isRunning               = true;
+            isSuccessful              = true;
+
+            ESP_LOGI(LOG_TAG, "Serial upload started (%u bytes).", size);
+        }
+    }
+
+    UploadHandler::unlock();
+
+    return isSuccessful;
+}
+
+void SerialUpload::process()
+{
+    /* The baudrate is changed after the response to the upload command is sent. */
+    if ((true == m_isRunning) && (true == m_isBaudRateSwitchPending))
+    {
+        m_stream.flush();
+        m_baudRateHandler(UPLOAD_BAUDRATE);
+
+        m_isBaudRateSwitchPending = false;
+        m_lastReceiveTime         = millis();
+    }
+
+    while ((true == m_isRunning) && (0 < m_stream.available()))
+    {
+        size_t needed = 1U;
+        size_t read   = 0U;
+
+        /* Read only the missing part of the current frame. */
+        if (FRAME_HEADER_SIZE > m_frameLen)
+        {
+            needed = (0U == m_frameLen) ? 1U : (FRAME_HEADER_SIZE - m_frameLen);
+        }
+        else
+        {
+            needed = FRAME_HEADER_SIZE + getUInt16(&m_frame[3]) + FRAME_CRC_SIZE - m_frameLen;
+        }
+
+        read              = m_stream.readBytes(&m_frame[m_frameLen], needed);
+        m_lastReceiveTime = millis();
+
+        if ((0U == m_frameLen) && (SYNC != m_frame[0]))
+        {
+            /* Skip everything until the start of a frame. */
+        }
+        else
+        {
+            m_frameLen += read;
+
+            if (FRAME_HEADER_SIZE == m_frameLen)
+            {
+                /* A corrupted length would overflow the frame buffer. */
+                if (BLOCK_SIZE < getUInt16(&m_frame[3]))
+                {
+                    if (false == m_isNakSent)
+                    {
+                        writeResponse(NAK, m_expectedSeq);
+                    }
+
+                    m_frameLen = 0U;
+                }
+            }
+            else if ((FRAME_HEADER_SIZE < m_frameLen) &&
+                     ((FRAME_HEADER_SIZE + getUInt16(&m_frame[3]) + FRAME_CRC_SIZE) == m_frameLen))
+            {
+                handleFrame();
+                m_frameLen = 0U;
+            }
+            else
+            {
+                /* Wait for the rest of the frame. */
+            }
+        }
+    }
+
+    if (true == m_isRunning)
+    {
+        uint32_t gap = millis() - m_lastReceiveTime;
+
+        if (RECEIVE_TIMEOUT_MS <= gap)
+        {
+            finish("Upload timeout.");
+        }
+        /* The sender pauses after a NAK, so a partial frame is garbage. Request the
+         * expected frame again, in case the NAK was lost.
+         */
+        else if ((0U < m_frameLen) && (FRAME_GAP_TIMEOUT_MS <= gap))
+        {
+            m_frameLen = 0U;
+            writeResponse(NAK, m_expectedSeq);
+        }
+        else
+        {
+            /* Wait for data. */
+        }
+    }
+}
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+void SerialUpload::handleFrame()
+{
+    uint16_t       seq     = getUInt16(&m_frame[1]);
+    uint16_t       len     = getUInt16(&m_frame[3]);
+    const uint8_t* payload = &m_frame[FRAME_HEADER_SIZE];
+    uint32_t       crc     = getUInt32(&payload[len]);
+
+    if (esp_rom_crc32_le(0U, &m_frame[1], FRAME_HEADER_SIZE - 1U + len) != crc)
+    {
+        ESP_LOGW(LOG_TAG, "Frame %u corrupted.", seq);
+
+        if (false == m_isNakSent)
+        {
+            writeResponse(NAK, m_expectedSeq);
+        }
+    }
+    else if (seq == m_expectedSeq)
+    {
+        ++m_expectedSeq;
+        m_isNakSent = false;
+
+        if (0U == len)
+        {
+            writeResponse(ACK, m_expectedSeq);
+
+            if (m_size != m_receivedSize)
+            {
+                finish("Binary is smaller than announced.");
+            }
+            else
+            {
+                finish(nullptr);
+            }
+        }
+        else if (m_size < (m_receivedSize + len))
+        {
+            finish("Binary is larger than announced.");
+        }
+        else
+        {
+            bool isReplaced = false;
+
+            UploadHandler::lock();
+
+            /* A web upload may replace the serial upload. */
+            if (m_uploadId != UploadHandler::getUploadId())
+            {
+                isReplaced = true;
+            }
+            else
+            {
+                UploadHandler::write(payload, len);
+            }
+
+            UploadHandler::unlock();
+
+            if (true == isReplaced)
+            {
+                finish("Upload replaced by another upload.");
+            }
+            else
+            {
+                m_receivedSize += len;
+                writeResponse(ACK, m_expectedSeq);
+            }
+        }
+    }
+    /* Already received frame, whose ACK was lost? */
+    else if (WINDOW_SIZE >= static_cast<uint16_t>(m_expectedSeq - seq))
+    {
+        writeResponse(ACK, m_expectedSeq);
+    }
+    /* A frame in between is missing. */
+    else if (false == m_isNakSent)
+    {
+        writeResponse(NAK, m_expectedSeq);
+    }
+    else
+    {
+        /* NAK already sent, skip until the sender continues at the expected frame. */
+    }
+}
+
+void SerialUpload::writeResponse(uint8_t type, uint16_t seq)
+{
+    const uint8_t response[] = { type, static_cast<uint8_t>(seq & 0xFFU), static_cast<uint8_t>((seq >> 8U) & 0xFFU) };
+
+    if (NAK == type)
+    {
+        m_isNakSent = true;
+    }
+
+    (void)m_stream.write(response, sizeof(response));
+}
+
+void SerialUpload::finish(const char* error)
+{
+    const char* message      = error;
+    bool        isSuccessful = false;
+
+    UploadHandler::lock();
+
+    /* Don't touch an upload, which replaced this one. */
+    if (m_uploadId != UploadHandler::getUploadId())
+    {
+        message = "Upload replaced by another upload.";
+    }
+    else if (nullptr != error)
+    {
+        UploadHandler::abort();
+    }
+    else
+    {
+        UploadHandler::Response response;
+
+        UploadHandler::end();
+        UploadHandler::getResponse(response);
+
+        message      = response.message;
+        isSuccessful = (STATUS_CODE_OK == response.statusCode);
+    }
+
+    UploadHandler::unlock();
+
+    if (true == isSuccessful)
+    {
+        ESP_LOGI(LOG_TAG, "Serial upload finished.");
+    }
+    else
+    {
+        ESP_LOGE(LOG_TAG, "Serial upload failed: %s", message);
+    }
+
+    /* The result is sent with the upload baudrate. */
+    (void)m_stream.write(message);
+    (void)m_stream.write((true == isSuccessful) ? "\nOK\n" : "\nERR\n");
+
+    if ((nullptr != m_baudRateHandler) && (false == m_isBaudRateSwitchPending))
+    {
+        m_stream.flush();
+        m_baudRateHandler(m_defaultBaudRate);
+    }
+
+    m_isBaudRateSwitchPending = false;
+    m_isRunning               = false;
+}
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * Get a little endian uint16_t value.
+ *
+ * @param[in] data  Data
+ *
+ * @return Value
+ */
+static uint16_t getUInt16(const uint8_t* data)
+{
+    return static_cast<uint16_t>(data[0]) | static_cast<uint16_t>(static_cast<uint16_t>(data[1]) << 8U);
+}
+
+/**
+ * Get a little endian uint32_t value.
+ *
+ * @param[in] data  Data
+ *
+ * @return Value
+ */
+static uint32_t getUInt32(const uint8_t* data)
+{
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8U) |
+           (static_cast<uint32_t>(data[2]) << 16U) |
+           (static_cast<uint32_t>(data[3]) << 24U);
+}
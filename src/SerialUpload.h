@@ -0,0 +1,229 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   SerialUpload.h
+ * @brief  Binary upload via serial interface
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef SERIAL_UPLOAD_H
+#define SERIAL_UPLOAD_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <Arduino.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * Receives a firmware or filesystem binary in CRC checked frames via a
+ * stream and feeds it to the upload handler, like the web upload.
+ *
+ * Frame: SYNC (0xA5), sequence number (uint16), payload length (uint16),
+ * payload, CRC32 (uint32) over sequence number, length and payload. All
+ * numbers are little endian. A frame without payload ends the upload.
+ *
+ * Every frame in sequence is acknowledged with ACK (0x06) and the next
+ * expected sequence number. A corrupted or missing frame is answered once
+ * with NAK (0x15) and the expected sequence number. The sender may have
+ * WINDOW_SIZE frames unacknowledged in flight. After a NAK it pauses
+ * (FRAME_GAP_TIMEOUT_MS), then continues at the expected sequence number
+ * (go-back-N).
+ */
+class SerialUpload
+{
+public:
+
+    /**
+     * Function to change the baudrate of the serial interface.
+     *
+     * @param[in] baudRate  Baudrate
+     */
+    typedef void (*BaudRateHandler)(uint32_t baudRate);
+
+    /** Baudrate during the upload, if the baudrate can be changed. */
+    static const uint32_t UPLOAD_BAUDRATE = 921600U;
+
+    /** Max. payload size of a frame in byte. */
+    static const size_t   BLOCK_SIZE      = 1024U;
+
+    /** Max. number of unacknowledged frames. The serial receive buffer must hold them. */
+    static const size_t   WINDOW_SIZE     = 3U;
+
+    /**
+     * Construct the serial upload instance.
+     *
+     * @param[in] stream    In-/Out-stream
+     */
+    SerialUpload(Stream& stream) :
+        m_stream(stream),
+        m_baudRateHandler(nullptr),
+        m_defaultBaudRate(0U),
+        m_isRunning(false),
+        m_isBaudRateSwitchPending(false),
+        m_uploadId(0U),
+        m_size(0U),
+        m_receivedSize(0U),
+        m_expectedSeq(0U),
+        m_isNakSent(false),
+        m_lastReceiveTime(0U),
+        m_frameLen(0U),
+        m_frame()
+    {
+    }
+
+    /**
+     * Destroys the instance.
+     */
+    ~SerialUpload()
+    {
+    }
+
+    /**
+     * Set the function to change the baudrate. Without it, the baudrate is
+     * kept, which is the case for USB CDC.
+     *
+     * @param[in] handler           Function to change the baudrate
+     * @param[in] defaultBaudRate   Baudrate, which is restored after the upload.
+     */
+    void setBaudRateHandler(BaudRateHandler handler, uint32_t defaultBaudRate)
+    {
+        m_baudRateHandler = handler;
+        m_defaultBaudRate = defaultBaudRate;
+    }
+
+    /**
+     * Get the baudrate during the upload.
+     *
+     * @return Baudrate or 0, if the baudrate is kept.
+     */
+    uint32_t getUploadBaudRate() const
+    {
+        return (nullptr == m_baudRateHandler) ? 0U : UPLOAD_BAUDRATE;
+    }
+
+    /**
+     * Begin an upload. After the response to the command is written, the
+     * baudrate is changed by the next process() call.
+     *
+     * @param[in] cmd       U_FLASH for firmware or U_SPIFFS for filesystem.
+     * @param[in] size      Binary size in byte.
+     * @param[in] imageHash Expected SHA-256 of the image as 64 digit hex value or empty.
+     * @param[out] error    Error message, if failed.
+     *
+     * @return If successful started, it will return true otherwise false.
+     */
+    bool begin(int cmd, size_t size, const String& imageHash, const char*& error);
+
+    /**
+     * Process the received frames.
+     * When the upload ends, the result is written.
+     */
+    void process();
+
+    /**
+     * Is an upload running?
+     *
+     * @return If running, it will return true otherwise false.
+     */
+    bool isRunning() const
+    {
+        return m_isRunning;
+    }
+
+private:
+
+    static const uint8_t  SYNC                 = 0xA5U;   /**< Start of frame */
+    static const uint8_t  ACK                  = 0x06U;   /**< Acknowledge */
+    static const uint8_t  NAK                  = 0x15U;   /**< Negative acknowledge */
+    static const size_t   FRAME_HEADER_SIZE    = 5U;      /**< Sync, sequence number and length in byte. */
+    static const size_t   FRAME_CRC_SIZE       = 4U;      /**< CRC32 size in byte. */
+    static const size_t   FRAME_MAX_SIZE       = FRAME_HEADER_SIZE + BLOCK_SIZE + FRAME_CRC_SIZE; /**< Max. frame size in byte. */
+    static const uint32_t RECEIVE_TIMEOUT_MS   = 5000U;   /**< Upload is aborted, if nothing is received for this time. */
+    static const uint32_t FRAME_GAP_TIMEOUT_MS = 50U;     /**< A partial frame is dropped, if nothing is received for this time. */
+
+    Stream&         m_stream;                   /**< In/Out-stream. */
+    BaudRateHandler m_baudRateHandler;          /**< Function to change the baudrate. */
+    uint32_t        m_defaultBaudRate;          /**< Baudrate after the upload. */
+    bool            m_isRunning;                /**< Is the upload running? */
+    bool            m_isBaudRateSwitchPending;  /**< Shall the baudrate be changed to the upload baudrate? */
+    uint32_t        m_uploadId;                 /**< Id of the upload at the upload handler. */
+    size_t          m_size;                     /**< Binary size in byte. */
+    size_t          m_receivedSize;             /**< Number of received binary bytes. */
+    uint16_t        m_expectedSeq;              /**< Expected sequence number of the next frame. */
+    bool            m_isNakSent;                /**< Is a NAK for the expected frame already sent? */
+    uint32_t        m_lastReceiveTime;          /**< Timestamp in ms of the last received data. */
+    size_t          m_frameLen;                 /**< Number of received frame bytes. */
+    uint8_t         m_frame[FRAME_MAX_SIZE];    /**< Frame buffer */
+
+    /**
+     * Handle a completely received frame.
+     */
+    void handleFrame();
+
+    /**
+     * Write a response to the sender.
+     *
+     * @param[in] type  ACK or NAK
+     * @param[in] seq   Expected sequence number
+     */
+    void writeResponse(uint8_t type, uint16_t seq);
+
+    /**
+     * End the upload, write the result and restore the baudrate.
+     *
+     * @param[in] error Error message or nullptr, if the upload handler shall be ended.
+     */
+    void finish(const char* error);
+
+    /* An instance shall not be copied. */
+    SerialUpload(const SerialUpload& upload);
+    SerialUpload& operator=(const SerialUpload& upload);
+};
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+#endif  /* SERIAL_UPLOAD_H */
+
+/** @} */
@@ -0,0 +1,186 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   UpdateMode.cpp
+ * @brief  WiFi settings for the update
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "UpdateMode.h"
+
+#include <WiFi.h>
+#include <esp_log.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#ifndef CONFIG_UPDATE_MODE_ENABLED
+#define CONFIG_UPDATE_MODE_ENABLED  (1)
+#endif /* CONFIG_UPDATE_MODE_ENABLED */
+
+#ifndef CONFIG_UPDATE_MODE_TX_POWER
+#define CONFIG_UPDATE_MODE_TX_POWER (WIFI_POWER_19_5dBm)
+#endif /* CONFIG_UPDATE_MODE_TX_POWER */
+
+/* The TCP receive window is only known, if the sdkconfig provides it. */
+#ifdef CONFIG_LWIP_TCP_WND_DEFAULT
+#define TCP_RECEIVE_WINDOW          (CONFIG_LWIP_TCP_WND_DEFAULT)
+#else
+#define TCP_RECEIVE_WINDOW          (0)
+#endif /* CONFIG_LWIP_TCP_WND_DEFAULT */
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char     LOG_TAG[]        = "UpdateMode";
+
+/** Is the update mode active? */
+static bool           gIsActive        = false;
+
+/** Power save mode before the update mode was entered. */
+static wifi_ps_type_t gSleepMode       = WIFI_PS_MIN_MODEM;
+
+/** TX power before the update mode was entered. */
+static wifi_power_t   gTxPower         = WIFI_POWER_19_5dBm;
+
+/** Was the TX power raised by the update mode? */
+static bool           gIsTxPowerRaised = false;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+void UpdateMode::enter()
+{
+    if ((0 == CONFIG_UPDATE_MODE_ENABLED) || (true == gIsActive))
+    {
+        /* Nothing to do. */
+    }
+    /* A serial upload may run without WiFi. */
+    else if (WIFI_MODE_NULL == WiFi.getMode())
+    {
+        ESP_LOGD(LOG_TAG, "WiFi is off, update mode not entered.");
+    }
+    else
+    {
+        wifi_power_t txPower = static_cast<wifi_power_t>(CONFIG_UPDATE_MODE_TX_POWER);
+
+        gSleepMode       = WiFi.getSleep();
+        gTxPower         = WiFi.getTxPower();
+        gIsTxPowerRaised = false;
+
+        if (false == WiFi.setSleep(WIFI_PS_NONE))
+        {
+            ESP_LOGW(LOG_TAG, "Failed to disable modem sleep.");
+        }
+
+        /* The TX power is only raised, a higher one is kept. */
+        if (gTxPower >= txPower)
+        {
+            /* Keep TX power. */
+        }
+        else if (false == WiFi.setTxPower(txPower))
+        {
+            ESP_LOGW(LOG_TAG, "Failed to set TX power.");
+        }
+        else
+        {
+            gIsTxPowerRaised = true;
+        }
+
+        ESP_LOGI(LOG_TAG, "Update mode entered (TX power %d, TCP receive window %d bytes).", WiFi.getTxPower(), TCP_RECEIVE_WINDOW);
+
+        gIsActive = true;
+    }
+}
+
+void UpdateMode::leave()
+{
+    if (false == gIsActive)
+    {
+        /* Nothing to do. */
+    }
+    else
+    {
+        if (false == WiFi.setSleep(gSleepMode))
+        {
+            ESP_LOGW(LOG_TAG, "Failed to restore modem sleep.");
+        }
+
+        if ((true == gIsTxPowerRaised) &&
+            (false == WiFi.setTxPower(gTxPower)))
+        {
+            ESP_LOGW(LOG_TAG, "Failed to restore TX power.");
+        }
+
+        ESP_LOGI(LOG_TAG, "Update mode left.");
+
+        gIsTxPowerRaised = false;
+        gIsActive        = false;
+    }
+}
+
+bool UpdateMode::isActive()
+{
+    return gIsActive;
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
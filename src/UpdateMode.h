@@ -0,0 +1,101 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   UpdateMode.h
+ * @brief  WiFi settings for the update
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef UPDATE_MODE_H
+#define UPDATE_MODE_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The update mode tunes the WiFi for throughput while an upload is running.
+ * The modem sleep is disabled, which otherwise delays received frames up to
+ * the DTIM interval of the access point, and the TX power is raised to keep
+ * the TCP acknowledgements flowing. After the upload the previous settings
+ * are restored.
+ *
+ * The settings can be changed per environment via build flags in the
+ * platformio.ini:
+ * - CONFIG_UPDATE_MODE_ENABLED: Set it to 0 to disable the update mode.
+ * - CONFIG_UPDATE_MODE_TX_POWER: TX power as wifi_power_t value, e.g. WIFI_POWER_8_5dBm.
+ *
+ * The TCP receive window is a lwIP setting, which can not be changed at
+ * runtime. It is set via custom_sdkconfig in the platformio.ini.
+ *
+ * The functions are called by the upload handler with its lock held.
+ */
+namespace UpdateMode
+{
+    /**
+     * Enter the update mode. If it is already active, nothing happens.
+     */
+    void enter();
+
+    /**
+     * Leave the update mode and restore the previous WiFi settings.
+     * If it is not active, nothing happens.
+     */
+    void leave();
+
+    /**
+     * Is the update mode active?
+     *
+     * @return If active, it will return true otherwise false.
+     */
+    bool isActive();
+
+} /* namespace UpdateMode */
+
+#endif /* UPDATE_MODE_H */
+
+/** @} */
@@ -0,0 +1,913 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   UploadHandler.cpp
+ * @brief  Upload handling, independent of the web server backend.
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "UploadHandler.h"
+#include <Update.h>
+
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <new>
+
+#include "BootPartition.h"
+#include "BundleParser.h"
+#include "OtaWriter.h"
+#include "PartitionInfo.h"
+#include "UpdateMode.h"
+#include "UploadMetrics.h"
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/**
+ * State of a chunked upload session.
+ */
+typedef enum
+{
+    UPLOAD_STATE_IDLE = 0, /**< No chunked upload */
+    UPLOAD_STATE_RUNNING,  /**< Chunked upload in progress, waiting for the next chunk. */
+    UPLOAD_STATE_FINISHED, /**< Chunked upload finished successful. */
+    UPLOAD_STATE_FAILED    /**< Chunked upload failed and must be started from the begin. */
+
+} UploadState;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void beginImage(const UploadHandler::Request& request, size_t imageSize, int cmd);
+static void writeChunk(const uint8_t* data, size_t size);
+static void beginChunk(const UploadHandler::Request& request, int cmd, const char* sizeHeader, const String& sizeValue);
+static void beginBundle(const UploadHandler::Request& request);
+static void endBundle();
+static void endChunk();
+static void stopChunkedUpload(UploadState state);
+static size_t parseFileSize(const String& value);
+static bool setImageHash(const String& value);
+static bool writeImage(const uint8_t* data, size_t size);
+static void startUpload();
+static void finishUpload(bool isSuccessful);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char LOG_TAG[]             = "UploadHandler";
+
+/** Max. chunk size in byte. A chunk is kept in RAM until its CRC is verified. */
+static const size_t CHUNK_MAX_SIZE      = 16384U;
+
+/**
+ * Time in ms without a chunk, after which a chunked upload session is dropped.
+ * It is longer than all retries of script/upload.py.
+ */
+static const uint32_t CHUNK_TIMEOUT     = 600000U;
+
+/** Error message of the current upload. If no error happened, it will be nullptr. */
+static const char* gUploadError         = nullptr;
+
+/** HTTP status code, which is sent in case of an upload error. */
+static HTTPStatusCode gUploadStatusCode = STATUS_CODE_INTERNAL_SERVER_ERROR;
+
+/** Is the current upload a form upload? */
+static bool gIsFormUpload               = false;
+
+/** Is the current upload a chunk of a chunked upload? */
+static bool gIsChunkedUpload            = false;
+
+/** Number of received bytes of the current upload request. */
+static size_t gReceivedSize             = 0U;
+
+/** State of the chunked upload session. */
+static UploadState gUploadState         = UPLOAD_STATE_IDLE;
+
+/** Chunked upload command, which is U_FLASH or U_SPIFFS. */
+static int gUploadCmd                   = U_FLASH;
+
+/** Image size of the chunked upload in byte. */
+static size_t gUploadSize               = 0U;
+
+/** Number of image bytes of the chunked upload, which are committed. */
+static size_t gUploadOffset             = 0U;
+
+/** Buffer for the chunk, which is received. */
+static uint8_t* gChunkBuffer            = nullptr;
+
+/** Number of received chunk bytes. */
+static size_t gChunkSize                = 0U;
+
+/** Expected chunk CRC32 */
+static uint32_t gChunkCrc               = 0U;
+
+/** Id of the current upload, which is incremented with every begin. */
+static uint32_t gUploadId               = 0U;
+
+/** Serializes the access of several tasks. */
+static SemaphoreHandle_t gMutex         = nullptr;
+
+/** Timestamp in us, when the last received data was handled. */
+static uint32_t gLastWriteTime          = 0U;
+
+/** Is the current upload a bundle? */
+static bool gIsBundleUpload             = false;
+
+/** Shall the device restart after the response, because app0 was activated? */
+static bool gIsRestartRequested         = false;
+
+/** Splits a bundle into its images. */
+static BundleParser gBundleParser;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+bool UploadHandler::init()
+{
+    if (nullptr == gMutex)
+    {
+        gMutex = xSemaphoreCreateMutex();
+    }
+
+    return (nullptr != gMutex);
+}
+
+void UploadHandler::lock()
+{
+    (void)xSemaphoreTake(gMutex, portMAX_DELAY);
+}
+
+void UploadHandler::unlock()
+{
+    (void)xSemaphoreGive(gMutex);
+}
+
+void UploadHandler::beginForm(const Request& request, const char* fileName)
+{
+    ++gUploadId;
+
+    gIsFormUpload       = true;
+    gIsChunkedUpload    = false;
+    gReceivedSize       = 0U;
+    gLastWriteTime      = micros();
+    gUploadStatusCode   = STATUS_CODE_INTERNAL_SERVER_ERROR;
+    gUploadError        = nullptr;
+    gIsBundleUpload     = false;
+    gIsRestartRequested = false;
+
+    /* If there is a pending upload, abort it. */
+    gBundleParser.abort();
+
+    if (true == OtaWriter::isRunning())
+    {
+        OtaWriter::abort();
+        ESP_LOGW(LOG_TAG, "Aborted pending upload.");
+    }
+
+    stopChunkedUpload(UPLOAD_STATE_IDLE);
+
+    /* Upload firmware or filesystem? */
+    if (false == request.firmwareSize.isEmpty())
+    {
+        beginImage(request, parseFileSize(request.firmwareSize), U_FLASH);
+    }
+    else if (false == request.filesystemSize.isEmpty())
+    {
+        beginImage(request, parseFileSize(request.filesystemSize), U_SPIFFS);
+    }
+    else
+    {
+        ESP_LOGE(LOG_TAG, "Could not find %s or %s header. Cannot upload file!", FIRMWARE_SIZE_HEADER, FILESYSTEM_SIZE_HEADER);
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Missing size header in request!";
+    }
+
+    if (nullptr == gUploadError)
+    {
+        ESP_LOGI(LOG_TAG, "File upload started: %s", fileName);
+    }
+}
+
+void UploadHandler::beginRaw(const Request& request, int cmd)
+{
+    const char* sizeHeader = (U_SPIFFS == cmd) ? FILESYSTEM_SIZE_HEADER : FIRMWARE_SIZE_HEADER;
+    String      sizeValue  = (U_SPIFFS == cmd) ? request.filesystemSize : request.firmwareSize;
+
+    ++gUploadId;
+
+    gIsFormUpload          = false;
+    gIsChunkedUpload       = (false == request.chunkOffset.isEmpty());
+    gIsBundleUpload        = (CMD_BUNDLE == cmd);
+    gIsRestartRequested    = false;
+    gReceivedSize          = 0U;
+    gLastWriteTime         = micros();
+    gUploadStatusCode      = STATUS_CODE_INTERNAL_SERVER_ERROR;
+    gUploadError           = nullptr;
+
+    if ((true == gIsBundleUpload) && (true == gIsChunkedUpload))
+    {
+        ESP_LOGE(LOG_TAG, "Chunked bundle upload not supported.");
+        gIsChunkedUpload  = false;
+        gIsBundleUpload   = false;
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Bundle can't be uploaded in chunks.";
+    }
+    else if (true == gIsBundleUpload)
+    {
+        stopChunkedUpload(UPLOAD_STATE_IDLE);
+        beginBundle(request);
+    }
+    else if (true == gIsChunkedUpload)
+    {
+        beginChunk(request, cmd, sizeHeader, sizeValue);
+    }
+    else
+    {
+        /* Without size header, the whole body is the image. */
+        if (true == sizeValue.isEmpty())
+        {
+            sizeValue = request.contentLength;
+        }
+
+        stopChunkedUpload(UPLOAD_STATE_IDLE);
+        beginImage(request, parseFileSize(sizeValue), cmd);
+
+        if (nullptr == gUploadError)
+        {
+            ESP_LOGI(LOG_TAG, "Raw upload started.");
+        }
+    }
+}
+
+void UploadHandler::write(const uint8_t* data, size_t size)
+{
+    gReceivedSize += size;
+
+    /* The time since the last data was handled, is spent waiting for the network. */
+    UploadMetrics::addReceived(size, micros() - gLastWriteTime);
+
+    if (nullptr != gUploadError)
+    {
+        /* Error already reported. */
+    }
+    else if (true == gIsChunkedUpload)
+    {
+        writeChunk(data, size);
+    }
+    else if (true == gIsBundleUpload)
+    {
+        if (false == gBundleParser.write(data, size))
+        {
+            ESP_LOGE(LOG_TAG, "Bundle error: %s", gBundleParser.getErrorString());
+            gBundleParser.abort();
+            finishUpload(false);
+            gUploadError = "Failed to write bundle upload.";
+        }
+    }
+    else if (false == writeImage(data, size))
+    {
+        ESP_LOGE(LOG_TAG, "Upload error: %s", OtaWriter::getErrorString());
+        OtaWriter::abort();
+        finishUpload(false);
+        gUploadError = "Failed to write file upload.";
+    }
+
+    gLastWriteTime = micros();
+}
+
+void UploadHandler::end()
+{
+    if (nullptr != gUploadError)
+    {
+        /* Error already reported. */
+    }
+    else if (true == gIsChunkedUpload)
+    {
+        endChunk();
+    }
+    else if (true == gIsBundleUpload)
+    {
+        endBundle();
+    }
+    else if (false == OtaWriter::end())
+    {
+        ESP_LOGE(LOG_TAG, "Upload error: %s", OtaWriter::getErrorString());
+        finishUpload(false);
+        gUploadError = "Failed to end file upload.";
+    }
+    else
+    {
+        ESP_LOGI(LOG_TAG, "Upload finished (%u bytes)", gReceivedSize);
+        finishUpload(true);
+    }
+}
+
+void UploadHandler::abort()
+{
+    if (true == gIsChunkedUpload)
+    {
+        /* Keep the upload session, the chunk can be sent again. */
+        ESP_LOGI(LOG_TAG, "Chunk at offset %u aborted.", gUploadOffset);
+        gUploadError = "Chunk aborted.";
+        gChunkSize   = 0U;
+    }
+    else
+    {
+        ESP_LOGI(LOG_TAG, "Upload aborted.");
+        gBundleParser.abort();
+        OtaWriter::abort();
+        finishUpload(false);
+        gUploadError = "File upload aborted.";
+    }
+}
+
+void UploadHandler::getResponse(Response& response)
+{
+    /* The client resumes a chunked upload at the committed offset. */
+    response.hasUploadOffset = gIsChunkedUpload;
+    response.uploadOffset    = gUploadOffset;
+
+    if (nullptr != gUploadError)
+    {
+        response.statusCode = gUploadStatusCode;
+        response.message    = gUploadError;
+    }
+    else if ((true == gIsChunkedUpload) && (UPLOAD_STATE_RUNNING == gUploadState))
+    {
+        response.statusCode = STATUS_CODE_OK;
+        response.message    = "Chunk received.";
+    }
+    else if (true == gIsRestartRequested)
+    {
+        response.statusCode = STATUS_CODE_OK;
+        response.message    = "File upload successful. Restarting...";
+    }
+    else
+    {
+        response.statusCode = STATUS_CODE_OK;
+        response.message    = "File upload successful.";
+    }
+}
+
+void UploadHandler::getStatus(String& json)
+{
+    const char* state  = "idle";
+    const char* target = (U_SPIFFS == gUploadCmd) ? "filesystem" : "firmware";
+
+    switch (gUploadState)
+    {
+    case UPLOAD_STATE_RUNNING:
+        state = "running";
+        break;
+
+    case UPLOAD_STATE_FINISHED:
+        state = "finished";
+        break;
+
+    case UPLOAD_STATE_FAILED:
+        state = "failed";
+        break;
+
+    case UPLOAD_STATE_IDLE:
+    default:
+        break;
+    }
+
+    json  = "{\"state\":\"";
+    json += state;
+    json += "\",\"target\":\"";
+    json += target;
+    json += "\",\"offset\":";
+    json += gUploadOffset;
+    json += ",\"size\":";
+    json += gUploadSize;
+    json += ",\"chunkMaxSize\":";
+    json += CHUNK_MAX_SIZE;
+    json += "}";
+}
+
+uint32_t UploadHandler::getPartitionSize(const Request& request)
+{
+    uint32_t               size      = 0U;
+    int                    cmd       = U_FLASH;
+    const esp_partition_t* partition = nullptr;
+    String                 headerXFileSize;
+
+    /* Firmware or filesystem? */
+    if (false == request.firmwareSize.isEmpty())
+    {
+        headerXFileSize = request.firmwareSize;
+        cmd             = U_FLASH;
+        partition       = esp_partition_find_first(
+            esp_partition_type_t::ESP_PARTITION_TYPE_APP,
+            esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_APP_OTA_0,
+            nullptr);
+    }
+    else if (false == request.filesystemSize.isEmpty())
+    {
+        headerXFileSize = request.filesystemSize;
+        cmd             = U_SPIFFS;
+        partition       = esp_partition_find_first(
+            esp_partition_type_t::ESP_PARTITION_TYPE_DATA,
+            esp_partition_subtype_t::ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+            nullptr);
+    }
+
+    if (nullptr != partition)
+    {
+        size_t fileSize = parseFileSize(headerXFileSize);
+
+        size            = partition->size;
+
+        /* Only on request, an announced image, which fits, is erased in the background until its upload starts. */
+        if ((request.preErase == "1") &&
+            (UPDATE_SIZE_UNKNOWN != fileSize) && (size >= fileSize) && (false == OtaWriter::isRunning()))
+        {
+            PartitionInfo::invalidate();
+            (void)OtaWriter::preErase(fileSize, cmd);
+        }
+    }
+
+    return size;
+}
+
+bool UploadHandler::isChunkedUploadRunning()
+{
+    return (UPLOAD_STATE_RUNNING == gUploadState);
+}
+
+bool UploadHandler::isUploadRunning()
+{
+    return (true == OtaWriter::isRunning()) || (true == isChunkedUploadRunning()) || (true == gBundleParser.isRunning());
+}
+
+uint32_t UploadHandler::getUploadId()
+{
+    return gUploadId;
+}
+
+bool UploadHandler::isRestartRequested()
+{
+    return gIsRestartRequested;
+}
+
+void UploadHandler::process()
+{
+    /* The receive timestamp wraps around after 71 minutes, which is longer than the timeout. */
+    if ((UPLOAD_STATE_RUNNING == gUploadState) &&
+        ((CHUNK_TIMEOUT * 1000U) <= (micros() - gLastWriteTime)))
+    {
+        ESP_LOGW(LOG_TAG, "Chunked upload timed out at offset %u.", gUploadOffset);
+        OtaWriter::abort();
+        stopChunkedUpload(UPLOAD_STATE_FAILED);
+    }
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * Begin writing the image of a form or raw upload.
+ *
+ * @param[in] request   Request headers
+ * @param[in] imageSize Image size in byte or UPDATE_SIZE_UNKNOWN
+ * @param[in] cmd       U_FLASH for firmware or U_SPIFFS for filesystem.
+ */
+static void beginImage(const UploadHandler::Request& request, size_t imageSize, int cmd)
+{
+    startUpload();
+
+    if (false == OtaWriter::begin(imageSize, cmd))
+    {
+        ESP_LOGE(LOG_TAG, "Failed to begin upload.");
+        finishUpload(false);
+        gUploadError = "Failed to begin file upload.";
+    }
+    else if (false == setImageHash(request.imageHash))
+    {
+        OtaWriter::abort();
+        finishUpload(false);
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Invalid image hash in request!";
+    }
+}
+
+/**
+ * Collect the data of a chunk in RAM. It is only passed to the OTA writer,
+ * after its CRC is verified. A lost connection drops the incomplete chunk
+ * only, the upload can be resumed with it.
+ *
+ * @param[in] data  Received data
+ * @param[in] size  Data size in byte
+ */
+static void writeChunk(const uint8_t* data, size_t size)
+{
+    if ((CHUNK_MAX_SIZE - gChunkSize) < size)
+    {
+        ESP_LOGE(LOG_TAG, "Chunk exceeds %u bytes.", CHUNK_MAX_SIZE);
+        gUploadStatusCode = STATUS_CODE_PAYLOAD_TOO_LARGE;
+        gUploadError      = "Chunk too large.";
+    }
+    else
+    {
+        memcpy(&gChunkBuffer[gChunkSize], data, size);
+        gChunkSize += size;
+    }
+}
+
+/**
+ * Handle the start of a chunk. A chunk at offset 0 starts a new chunked upload,
+ * all others must continue the pending one at its committed offset.
+ *
+ * @param[in] request       Request headers
+ * @param[in] cmd           U_FLASH for firmware or U_SPIFFS for filesystem.
+ * @param[in] sizeHeader    Name of the request header with the image size.
+ * @param[in] sizeValue     Value of the request header with the image size.
+ */
+static void beginChunk(const UploadHandler::Request& request, int cmd, const char* sizeHeader, const String& sizeValue)
+{
+    size_t offset    = static_cast<size_t>(strtoul(request.chunkOffset.c_str(), nullptr, 10));
+    size_t imageSize = parseFileSize(sizeValue);
+
+    gChunkSize       = 0U;
+    gChunkCrc        = static_cast<uint32_t>(strtoul(request.chunkCrc.c_str(), nullptr, 16));
+
+    if ((UPDATE_SIZE_UNKNOWN == imageSize) || (true == request.chunkCrc.isEmpty()))
+    {
+        ESP_LOGE(LOG_TAG, "Chunk without %s or %s header.", sizeHeader, UploadHandler::CHUNK_CRC32_HEADER);
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Missing size or CRC header in request!";
+    }
+    else if (0U == offset)
+    {
+        if (true == OtaWriter::isRunning())
+        {
+            OtaWriter::abort();
+            ESP_LOGW(LOG_TAG, "Aborted pending upload.");
+        }
+
+        stopChunkedUpload(UPLOAD_STATE_IDLE);
+
+        gChunkBuffer = new (std::nothrow) uint8_t[CHUNK_MAX_SIZE];
+
+        if (nullptr == gChunkBuffer)
+        {
+            ESP_LOGE(LOG_TAG, "No memory for chunk buffer.");
+            gUploadError = "Failed to begin file upload.";
+        }
+        else
+        {
+            beginImage(request, imageSize, cmd);
+
+            if (nullptr != gUploadError)
+            {
+                stopChunkedUpload(UPLOAD_STATE_FAILED);
+            }
+            else
+            {
+                ESP_LOGI(LOG_TAG, "Chunked upload started.");
+                gUploadState  = UPLOAD_STATE_RUNNING;
+                gUploadCmd    = cmd;
+                gUploadSize   = imageSize;
+                gUploadOffset = 0U;
+            }
+        }
+    }
+    else if ((UPLOAD_STATE_RUNNING != gUploadState) || (cmd != gUploadCmd) || (imageSize != gUploadSize))
+    {
+        ESP_LOGE(LOG_TAG, "No chunked upload to continue.");
+        gUploadStatusCode = STATUS_CODE_CONFLICT;
+        gUploadError      = "No upload to continue, start at offset 0.";
+    }
+    else if (offset != gUploadOffset)
+    {
+        ESP_LOGW(LOG_TAG, "Chunk offset %u, expected %u.", offset, gUploadOffset);
+        gUploadStatusCode = STATUS_CODE_CONFLICT;
+        gUploadError      = "Wrong chunk offset.";
+    }
+}
+
+/**
+ * Handle the end of a chunk. A valid chunk is committed and the last chunk
+ * finishes the upload.
+ */
+static void endChunk()
+{
+    if (0U == gChunkSize)
+    {
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Empty chunk.";
+    }
+    else if (esp_rom_crc32_le(0U, gChunkBuffer, gChunkSize) != gChunkCrc)
+    {
+        ESP_LOGW(LOG_TAG, "Chunk at offset %u has wrong CRC.", gUploadOffset);
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Chunk CRC mismatch.";
+    }
+    else if ((gUploadSize - gUploadOffset) < gChunkSize)
+    {
+        gUploadStatusCode = STATUS_CODE_BAD_REQUEST;
+        gUploadError      = "Chunk exceeds the image size.";
+    }
+    else if (false == writeImage(gChunkBuffer, gChunkSize))
+    {
+        ESP_LOGE(LOG_TAG, "Upload error: %s", OtaWriter::getErrorString());
+        OtaWriter::abort();
+        stopChunkedUpload(UPLOAD_STATE_FAILED);
+        gUploadError = "Failed to write file upload.";
+    }
+    else
+    {
+        gUploadOffset += gChunkSize;
+
+        if (gUploadSize == gUploadOffset)
+        {
+            if (false == OtaWriter::end())
+            {
+                ESP_LOGE(LOG_TAG, "Upload error: %s", OtaWriter::getErrorString());
+                stopChunkedUpload(UPLOAD_STATE_FAILED);
+                gUploadError = "Failed to end file upload.";
+            }
+            else
+            {
+                ESP_LOGI(LOG_TAG, "Chunked upload finished (%u bytes)", gUploadSize);
+                stopChunkedUpload(UPLOAD_STATE_FINISHED);
+            }
+        }
+    }
+
+    gChunkSize = 0U;
+}
+
+/**
+ * Begin a bundle upload. The images are written one after another, as
+ * their segments are received.
+ *
+ * @param[in] request   Request headers
+ */
+static void beginBundle(const UploadHandler::Request& request)
+{
+    size_t bundleSize = parseFileSize(request.contentLength);
+
+    startUpload();
+
+    if (true == OtaWriter::isRunning())
+    {
+        OtaWriter::abort();
+        ESP_LOGW(LOG_TAG, "Aborted pending upload.");
+    }
+
+    if (false == gBundleParser.begin((UPDATE_SIZE_UNKNOWN == bundleSize) ? 0U : bundleSize, writeImage))
+    {
+        finishUpload(false);
+        gUploadError = "Failed to begin bundle upload.";
+    }
+    else
+    {
+        ESP_LOGI(LOG_TAG, "Bundle upload started.");
+    }
+}
+
+/**
+ * End a bundle upload and activate app0, if requested by the bundle.
+ */
+static void endBundle()
+{
+    bool isActivationRequested = gBundleParser.isActivationRequested();
+
+    if (false == gBundleParser.end())
+    {
+        ESP_LOGE(LOG_TAG, "Bundle error: %s", gBundleParser.getErrorString());
+        finishUpload(false);
+        gUploadError = "Failed to end bundle upload.";
+    }
+    else
+    {
+        ESP_LOGI(LOG_TAG, "Bundle upload finished (%u bytes)", gReceivedSize);
+        finishUpload(true);
+
+        if (false == isActivationRequested)
+        {
+            /* Nothing to activate. */
+        }
+        else if (BootPartition::BOOT_SUCCESS != BootPartition::setApp0())
+        {
+            gUploadError = "Failed to set app0 partition as boot partition!";
+        }
+        else
+        {
+            gIsRestartRequested = true;
+        }
+    }
+}
+
+/**
+ * Stop the chunked upload session and release its chunk buffer.
+ * The OTA writer is not touched.
+ *
+ * @param[in] state New upload state
+ */
+static void stopChunkedUpload(UploadState state)
+{
+    /* A running session, which is dropped, will never finish. */
+    if ((UPLOAD_STATE_IDLE == state) && (UPLOAD_STATE_RUNNING == gUploadState))
+    {
+        ESP_LOGW(LOG_TAG, "Chunked upload dropped at offset %u.", gUploadOffset);
+        finishUpload(false);
+    }
+
+    delete[] gChunkBuffer;
+    gChunkBuffer = nullptr;
+    gChunkSize   = 0U;
+    gUploadState = state;
+
+    if (UPLOAD_STATE_IDLE == state)
+    {
+        gUploadOffset = 0U;
+        gUploadSize   = 0U;
+    }
+    else if (UPLOAD_STATE_FINISHED == state)
+    {
+        finishUpload(true);
+    }
+    else if (UPLOAD_STATE_FAILED == state)
+    {
+        finishUpload(false);
+    }
+    else
+    {
+        /* Upload continues. */
+    }
+}
+
+/**
+ * Parse the file size from a HTTP request header value.
+ *
+ * @param[in] value Header value
+ *
+ * @return File size in byte or UPDATE_SIZE_UNKNOWN, if not available.
+ */
+static size_t parseFileSize(const String& value)
+{
+    size_t fileSize = UPDATE_SIZE_UNKNOWN;
+
+    if (false == value.isEmpty())
+    {
+        int32_t headerXFileSizeValue = value.toInt();
+
+        if (0 < headerXFileSizeValue)
+        {
+            fileSize = static_cast<size_t>(headerXFileSizeValue);
+
+            ESP_LOGI(LOG_TAG, "File size from header: %u bytes", fileSize);
+        }
+    }
+
+    return fileSize;
+}
+
+/**
+ * Pass the expected image hash of the request to the OTA writer.
+ * It must be called right after the OTA writer began.
+ *
+ * @param[in] value Value of the image hash request header
+ *
+ * @return If the request contains no hash or a valid one, it will return true otherwise false.
+ */
+static bool setImageHash(const String& value)
+{
+    const size_t HASH_SIZE    = 32U;
+    bool         isSuccessful = true;
+
+    if (false == value.isEmpty())
+    {
+        uint8_t hash[HASH_SIZE];
+        size_t  idx = 0U;
+
+        isSuccessful = ((2U * HASH_SIZE) == value.length());
+
+        for (idx = 0U; (HASH_SIZE > idx) && (true == isSuccessful); ++idx)
+        {
+            char  byteString[3] = { value[2U * idx], value[(2U * idx) + 1U], '\0' };
+            char* end           = nullptr;
+
+            hash[idx]           = static_cast<uint8_t>(strtoul(byteString, &end, 16));
+
+            if (&byteString[2] != end)
+            {
+                isSuccessful = false;
+            }
+        }
+
+        if (false == isSuccessful)
+        {
+            ESP_LOGE(LOG_TAG, "Invalid %s header.", UploadHandler::IMAGE_HASH_HEADER);
+        }
+        else
+        {
+            isSuccessful = OtaWriter::setExpectedHash(hash);
+        }
+    }
+
+    return isSuccessful;
+}
+
+/**
+ * Pass image data to the OTA writer. The time it blocks, because all its
+ * buffers are in use, is spent waiting for the flash.
+ *
+ * @param[in] data  Image data
+ * @param[in] size  Image data size in byte
+ *
+ * @return If successful, it will return true otherwise false.
+ */
+static bool writeImage(const uint8_t* data, size_t size)
+{
+    uint32_t startTime    = micros();
+    bool     isSuccessful = OtaWriter::write(data, size);
+
+    UploadMetrics::addBufferWait(micros() - startTime);
+
+    return isSuccessful;
+}
+
+/**
+ * Start the metrics of a new upload and enter the update mode.
+ * The cached partition information gets invalid, because a partition is written.
+ */
+static void startUpload()
+{
+    UploadMetrics::begin();
+    UpdateMode::enter();
+    PartitionInfo::invalidate();
+}
+
+/**
+ * Finish the metrics of the current upload and leave the update mode.
+ *
+ * @param[in] isSuccessful  Is the upload successful?
+ */
+static void finishUpload(bool isSuccessful)
+{
+    UploadMetrics::end(isSuccessful);
+    UpdateMode::leave();
+    PartitionInfo::invalidate();
+}
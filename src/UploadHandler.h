@@ -0,0 +1,262 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   UploadHandler.h
+ * @brief  Upload handling, independent of the web server backend.
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef UPLOAD_HANDLER_H
+#define UPLOAD_HANDLER_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+
+#include "HttpStatus.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The upload handler contains the upload logic of the web server: plain
+ * form uploads, raw uploads, resumable chunked uploads and bundles. A web server
+ * backend passes the request headers and the received body data to it and
+ * sends the response it provides.
+ *
+ * Only one upload can be handled at a time. The functions are not thread
+ * safe, the backend has to serialize the calls.
+ */
+namespace UploadHandler
+{
+    /** Firmware binary size HTTP request header. */
+    static const char FIRMWARE_SIZE_HEADER[]   = "X-File-Size-Firmware";
+
+    /** Filesystem binary size HTTP request header.  */
+    static const char FILESYSTEM_SIZE_HEADER[] = "X-File-Size-Filesystem";
+
+    /** Content length HTTP request header, used as fallback for raw uploads. */
+    static const char CONTENT_LENGTH_HEADER[]  = "Content-Length";
+
+    /** Expected SHA-256 hash of the image HTTP request header, as 64 digit hex value. */
+    static const char IMAGE_HASH_HEADER[]      = "X-Image-SHA256";
+
+    /** Chunk offset HTTP request header. It marks a raw upload as chunk of a chunked upload. */
+    static const char CHUNK_OFFSET_HEADER[]    = "X-Chunk-Offset";
+
+    /** Chunk CRC32 HTTP request header, as 8 digit hex value. */
+    static const char CHUNK_CRC32_HEADER[]     = "X-Chunk-CRC32";
+
+    /** Pre-erase HTTP request header of the partition size check. With "1", an announced image is erased in the background. */
+    static const char PRE_ERASE_HEADER[]       = "X-Pre-Erase";
+
+    /** Upload offset HTTP response header with the number of committed bytes of a chunked upload. */
+    static const char UPLOAD_OFFSET_HEADER[]   = "X-Upload-Offset";
+
+    /** Raw upload command of a bundle, which contains firmware and filesystem images. */
+    static const int  CMD_BUNDLE               = -1;
+
+    /**
+     * Upload related HTTP request header values.
+     * A missing header is an empty string.
+     */
+    typedef struct
+    {
+        String firmwareSize;   /**< Value of FIRMWARE_SIZE_HEADER */
+        String filesystemSize; /**< Value of FILESYSTEM_SIZE_HEADER */
+        String contentLength;  /**< Value of CONTENT_LENGTH_HEADER */
+        String imageHash;      /**< Value of IMAGE_HASH_HEADER */
+        String chunkOffset;    /**< Value of CHUNK_OFFSET_HEADER */
+        String chunkCrc;       /**< Value of CHUNK_CRC32_HEADER */
+        String preErase;       /**< Value of PRE_ERASE_HEADER */
+
+    } Request;
+
+    /**
+     * Response of an upload request.
+     */
+    typedef struct
+    {
+        HTTPStatusCode statusCode;      /**< HTTP status code */
+        const char*    message;         /**< Plain text message */
+        bool           hasUploadOffset; /**< Shall the UPLOAD_OFFSET_HEADER be sent? */
+        size_t         uploadOffset;    /**< Value of the UPLOAD_OFFSET_HEADER */
+
+    } Response;
+
+    /**
+     * Initialize the upload handler. It must be called once, before any
+     * other function is called.
+     *
+     * @return If successful, it will return true otherwise false.
+     */
+    bool init();
+
+    /**
+     * Lock the upload handler. The functions are not thread safe, therefore
+     * callers in different tasks must lock around each call.
+     */
+    void lock();
+
+    /**
+     * Unlock the upload handler.
+     */
+    void unlock();
+
+    /**
+     * Begin a form upload (multipart/form-data) of a single file.
+     * The request must contain the firmware or the filesystem size header,
+     * which selects the target partition.
+     *
+     * @param[in] request   Request headers
+     * @param[in] fileName  Name of the uploaded file, only used for logging.
+     */
+    void beginForm(const Request& request, const char* fileName);
+
+    /**
+     * Begin a raw upload (application/octet-stream). If the request contains
+     * the chunk offset header, it is a chunk of a chunked upload.
+     *
+     * A bundle is split into its images, see BundleParser. It can't be
+     * uploaded in chunks.
+     *
+     * @param[in] request   Request headers
+     * @param[in] cmd       U_FLASH for firmware, U_SPIFFS for filesystem or CMD_BUNDLE.
+     */
+    void beginRaw(const Request& request, int cmd);
+
+    /**
+     * Write received upload data.
+     * An error is kept until the response is requested.
+     *
+     * @param[in] data  Received data
+     * @param[in] size  Data size in byte
+     */
+    void write(const uint8_t* data, size_t size);
+
+    /**
+     * End the upload after the whole request body was received.
+     */
+    void end();
+
+    /**
+     * Abort the upload, e.g. because the connection was lost.
+     * A chunked upload keeps its session, the chunk can be sent again.
+     */
+    void abort();
+
+    /**
+     * Get the response of the current upload request.
+     *
+     * @param[out] response Response
+     */
+    void getResponse(Response& response);
+
+    /**
+     * Get the upload status, which reports the state of the chunked upload
+     * and the committed offset, where a client shall resume.
+     *
+     * @param[out] json Upload status as JSON object
+     */
+    void getStatus(String& json);
+
+    /**
+     * Get the size of the partition, which is selected by the firmware or
+     * filesystem size header. If the pre-erase header requests it, an
+     * announced image, which fits, is erased in the background until its
+     * upload starts. The partition content is lost then, even if no upload
+     * follows, and unchanged sectors are not skipped.
+     *
+     * @param[in] request   Request headers
+     *
+     * @return Partition size in byte or 0, if the partition is not found.
+     */
+    uint32_t getPartitionSize(const Request& request);
+
+    /**
+     * Is a chunked upload in progress, which waits for the next chunk?
+     *
+     * @return If a chunked upload is running, it will return true otherwise false.
+     */
+    bool isChunkedUploadRunning();
+
+    /**
+     * Is an upload in progress? This is the case from the begin until the
+     * end of an upload or while a chunked upload waits for the next chunk.
+     *
+     * @return If an upload is running, it will return true otherwise false.
+     */
+    bool isUploadRunning();
+
+    /**
+     * Get the id of the current upload. It changes with every begin, so a
+     * caller can detect that its upload was replaced by another one.
+     *
+     * @return Upload id
+     */
+    uint32_t getUploadId();
+
+    /**
+     * Shall the device restart, after the response is sent? This is requested
+     * by a bundle, which activates app0.
+     *
+     * @return If a restart is requested, it will return true otherwise false.
+     */
+    bool isRestartRequested();
+
+    /**
+     * Process the upload handler periodically. A chunked upload session,
+     * which received no chunk for 10 minutes, is dropped.
+     * This leaves the update mode, if the client gave up.
+     */
+    void process();
+
+} /* namespace UploadHandler */
+
+#endif /* UPLOAD_HANDLER_H */
+
+/** @} */
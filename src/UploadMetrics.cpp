@@ -0,0 +1,492 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   UploadMetrics.cpp
+ * @brief  Upload throughput metrics
+ * @author Andreas Merkle <web@blue-andi.de>
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "UploadMetrics.h"
+#include <inttypes.h>
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+
+/******************************************************************************
+ * Compiler Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/**
+ * Get the number of elements in an array.
+ */
+#define ARRAY_ELEMENT_COUNT(_arr) (sizeof(_arr) / sizeof(_arr[0]))
+
+/******************************************************************************
+ * Types and classes
+ *****************************************************************************/
+
+/** Number of histogram buckets with an upper bound. The +Inf bucket is additional. */
+static const size_t HISTOGRAM_BOUND_COUNT = 5U;
+
+/**
+ * Histogram with fixed bucket bounds.
+ */
+typedef struct
+{
+    uint32_t counts[HISTOGRAM_BOUND_COUNT + 1U]; /**< Number of values per bucket, the last one is +Inf. */
+    uint32_t sum;                                /**< Sum of all values */
+    uint32_t count;                              /**< Number of values */
+
+} Histogram;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void addToHistogram(Histogram& histogram, const uint32_t* bounds, uint32_t value);
+static void appendHeader(String& text, const char* name, const char* type, const char* help);
+static void appendValue(String& text, const char* name, const char* type, const char* help, uint32_t value);
+static void appendSeconds(String& text, const char* name, const char* help, uint32_t time);
+static void appendHistogram(String& text, const char* name, const char* help, const Histogram& histogram, const uint32_t* bounds, bool isTime);
+static void formatValue(char* buffer, size_t size, uint32_t value, bool isTime);
+
+/******************************************************************************
+ * Local Variables
+ *****************************************************************************/
+
+/**
+ * Tag for logging purposes.
+ */
+static const char     LOG_TAG[]                                 = "UploadMetrics";
+
+/** Period in ms, in which the upload progress is logged at most once. */
+static const uint32_t PROGRESS_LOG_PERIOD_MS                    = 2000U;
+
+/** Upper bounds of the chunk size histogram in byte. 1460 is the TCP payload of an ethernet frame. */
+static const uint32_t CHUNK_SIZE_BOUNDS[HISTOGRAM_BOUND_COUNT]  = { 128U, 512U, 1460U, 4096U, 16384U };
+
+/** Upper bounds of the sector flush time histogram in us. */
+static const uint32_t SECTOR_TIME_BOUNDS[HISTOGRAM_BOUND_COUNT] = { 1000U, 5000U, 20000U, 50000U, 100000U };
+
+/** Number of started uploads since boot. */
+static uint32_t       gUploadCount                              = 0U;
+
+/** Number of failed uploads since boot. */
+static uint32_t       gFailedUploadCount                        = 0U;
+
+/** Is an upload running? */
+static bool           gIsRunning                                = false;
+
+/** Timestamp in us, when the upload started. */
+static uint32_t       gStartTime                                = 0U;
+
+/** Duration in us of the finished upload. */
+static uint32_t       gDuration                                 = 0U;
+
+/** Received size in byte. */
+static uint32_t       gReceivedSize                             = 0U;
+
+/** Time in us, which the receiving side waited for data. */
+static uint32_t       gReceiveWaitTime                          = 0U;
+
+/** Time in us, which the receiving side waited for free write buffers. */
+static uint32_t       gBufferWaitTime                           = 0U;
+
+/** Time in us to erase the flash. */
+static uint32_t       gEraseTime                                = 0U;
+
+/** Time in us to write the flash. */
+static uint32_t       gWriteTime                                = 0U;
+
+/** Size in byte, which is written to flash. */
+static uint32_t       gWrittenSize                              = 0U;
+
+/** Number of erased flash sectors. */
+static uint32_t       gErasedSectors                            = 0U;
+
+/** Number of flash sectors, which are unchanged and therefore not written. */
+static uint32_t       gUnchangedSectors                         = 0U;
+
+/** Lowest free heap size in byte during the upload. */
+static uint32_t       gHeapLowWaterMark                         = 0U;
+
+/** Sizes in byte of the received data. */
+static Histogram      gChunkSizes;
+
+/** Times in us to erase and write a flash sector. */
+static Histogram      gSectorTimes;
+
+/** Timestamp in ms of the last progress log. */
+static uint32_t       gLastLogTime                              = 0U;
+
+/** Received size in byte at the last progress log. */
+static uint32_t       gLastLogSize                              = 0U;
+
+/** Protects the flash metrics, which are updated by the writer task. */
+static portMUX_TYPE   gFlashMetricsMux                          = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ * Public Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Protected Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * Private Methods
+ *****************************************************************************/
+
+/******************************************************************************
+ * External Functions
+ *****************************************************************************/
+
+void UploadMetrics::begin()
+{
+    /* A running upload, which is replaced, failed. */
+    if (true == gIsRunning)
+    {
+        ++gFailedUploadCount;
+    }
+
+    ++gUploadCount;
+
+    gIsRunning        = true;
+    gStartTime        = micros();
+    gDuration         = 0U;
+    gReceivedSize     = 0U;
+    gReceiveWaitTime  = 0U;
+    gBufferWaitTime   = 0U;
+    gHeapLowWaterMark = ESP.getFreeHeap();
+    gChunkSizes       = {};
+    gLastLogTime      = millis();
+    gLastLogSize      = 0U;
+
+    /* The writer task of an aborted upload may still flush a sector. */
+    taskENTER_CRITICAL(&gFlashMetricsMux);
+    gEraseTime        = 0U;
+    gWriteTime        = 0U;
+    gWrittenSize      = 0U;
+    gErasedSectors    = 0U;
+    gUnchangedSectors = 0U;
+    gSectorTimes      = {};
+    taskEXIT_CRITICAL(&gFlashMetricsMux);
+}
+
+void UploadMetrics::addReceived(size_t size, uint32_t waitTime)
+{
+    /* Data of a failed upload is not considered. */
+    if (true == gIsRunning)
+    {
+        uint32_t freeHeap = ESP.getFreeHeap();
+        uint32_t now      = millis();
+        uint32_t period   = now - gLastLogTime;
+
+        gReceivedSize    += size;
+        gReceiveWaitTime += waitTime;
+
+        addToHistogram(gChunkSizes, CHUNK_SIZE_BOUNDS, size);
+
+        if (gHeapLowWaterMark > freeHeap)
+        {
+            gHeapLowWaterMark = freeHeap;
+        }
+
+        /* Logging every chunk would slow down the upload, especially with a low baudrate. */
+        if (PROGRESS_LOG_PERIOD_MS <= period)
+        {
+            uint32_t rate = ((gReceivedSize - gLastLogSize) / period) * 1000U / 1024U; /* KiB/s */
+
+            ESP_LOGI(LOG_TAG, "Upload progress: %" PRIu32 " bytes (%" PRIu32 " KiB/s)", gReceivedSize, rate);
+
+            gLastLogTime = now;
+            gLastLogSize = gReceivedSize;
+        }
+    }
+}
+
+void UploadMetrics::addBufferWait(uint32_t waitTime)
+{
+    if (true == gIsRunning)
+    {
+        gBufferWaitTime += waitTime;
+    }
+}
+
+void UploadMetrics::addSector(uint32_t eraseTime, uint32_t writeTime, size_t size)
+{
+    taskENTER_CRITICAL(&gFlashMetricsMux);
+
+    if (0U < eraseTime)
+    {
+        gEraseTime += eraseTime;
+        ++gErasedSectors;
+    }
+
+    if (0U == size)
+    {
+        ++gUnchangedSectors;
+    }
+    else
+    {
+        gWriteTime   += writeTime;
+        gWrittenSize += size;
+    }
+
+    addToHistogram(gSectorTimes, SECTOR_TIME_BOUNDS, eraseTime + writeTime);
+
+    taskEXIT_CRITICAL(&gFlashMetricsMux);
+}
+
+void UploadMetrics::end(bool isSuccessful)
+{
+    if (true == gIsRunning)
+    {
+        gDuration  = micros() - gStartTime;
+        gIsRunning = false;
+
+        if (false == isSuccessful)
+        {
+            ++gFailedUploadCount;
+        }
+
+        ESP_LOGI(LOG_TAG, "Upload of %" PRIu32 " bytes took %" PRIu32 " ms (receive wait: %" PRIu32 " ms, buffer wait: %" PRIu32 " ms, erase: %" PRIu32 " ms, write: %" PRIu32 " ms).",
+            gReceivedSize,
+            gDuration / 1000U,
+            gReceiveWaitTime / 1000U,
+            gBufferWaitTime / 1000U,
+            gEraseTime / 1000U,
+            gWriteTime / 1000U);
+    }
+}
+
+void UploadMetrics::getMetrics(String& text)
+{
+    /* A running upload reports its current duration. */
+    uint32_t  duration         = (true == gIsRunning) ? (micros() - gStartTime) : gDuration;
+    uint32_t  eraseTime        = 0U;
+    uint32_t  writeTime        = 0U;
+    uint32_t  writtenSize      = 0U;
+    uint32_t  erasedSectors    = 0U;
+    uint32_t  unchangedSectors = 0U;
+    Histogram sectorTimes;
+
+    /* Take a consistent snapshot, while the writer task flushes sectors. */
+    taskENTER_CRITICAL(&gFlashMetricsMux);
+    eraseTime        = gEraseTime;
+    writeTime        = gWriteTime;
+    writtenSize      = gWrittenSize;
+    erasedSectors    = gErasedSectors;
+    unchangedSectors = gUnchangedSectors;
+    sectorTimes      = gSectorTimes;
+    taskEXIT_CRITICAL(&gFlashMetricsMux);
+
+    text.clear();
+    (void)text.reserve(3072U);
+
+    appendValue(text, "updater_uploads_total", "counter", "Number of started uploads since boot.", gUploadCount);
+    appendValue(text, "updater_upload_failures_total", "counter", "Number of failed uploads since boot.", gFailedUploadCount);
+    appendValue(text, "updater_upload_running", "gauge", "Is an upload running?", (true == gIsRunning) ? 1U : 0U);
+    appendSeconds(text, "updater_upload_duration_seconds", "Duration of the last upload.", duration);
+    appendValue(text, "updater_upload_received_bytes", "gauge", "Received bytes of the last upload.", gReceivedSize);
+    appendSeconds(text, "updater_upload_receive_wait_seconds", "Time the last upload waited for data from the network.", gReceiveWaitTime);
+    appendSeconds(text, "updater_upload_buffer_wait_seconds", "Time the last upload waited for free write buffers, because the flash was busy.", gBufferWaitTime);
+    appendHistogram(text, "updater_upload_chunk_size_bytes", "Size of the received data chunks of the last upload.", gChunkSizes, CHUNK_SIZE_BOUNDS, false);
+    appendSeconds(text, "updater_flash_erase_seconds", "Time the last upload spent erasing the flash.", eraseTime);
+    appendSeconds(text, "updater_flash_write_seconds", "Time the last upload spent writing the flash.", writeTime);
+    appendValue(text, "updater_flash_written_bytes", "gauge", "Bytes the last upload wrote to flash.", writtenSize);
+    appendValue(text, "updater_flash_erased_sectors", "gauge", "Sectors the last upload erased.", erasedSectors);
+    appendValue(text, "updater_flash_unchanged_sectors", "gauge", "Sectors the last upload skipped, because they were unchanged.", unchangedSectors);
+    appendHistogram(text, "updater_flash_sector_seconds", "Time to erase and write a flash sector of the last upload.", sectorTimes, SECTOR_TIME_BOUNDS, true);
+    appendValue(text, "updater_upload_heap_min_free_bytes", "gauge", "Lowest free heap during the last upload.", gHeapLowWaterMark);
+    appendValue(text, "updater_heap_free_bytes", "gauge", "Free heap.", ESP.getFreeHeap());
+    appendValue(text, "updater_heap_min_free_bytes", "gauge", "Lowest free heap since boot.", ESP.getMinFreeHeap());
+}
+
+/******************************************************************************
+ * Local Functions
+ *****************************************************************************/
+
+/**
+ * Add a value to a histogram.
+ *
+ * @param[in,out]   histogram   Histogram
+ * @param[in]       bounds      Upper bounds of the buckets
+ * @param[in]       value       Value
+ */
+static void addToHistogram(Histogram& histogram, const uint32_t* bounds, uint32_t value)
+{
+    size_t idx = 0U;
+
+    while ((HISTOGRAM_BOUND_COUNT > idx) && (bounds[idx] < value))
+    {
+        ++idx;
+    }
+
+    ++histogram.counts[idx];
+    histogram.sum += value;
+    ++histogram.count;
+}
+
+/**
+ * Append the help and type lines of a metric.
+ *
+ * @param[in,out]   text    Metrics text
+ * @param[in]       name    Metric name
+ * @param[in]       type    Metric type
+ * @param[in]       help    Metric description
+ */
+static void appendHeader(String& text, const char* name, const char* type, const char* help)
+{
+    text += "# HELP ";
+    text += name;
+    text += " ";
+    text += help;
+    text += "\n# TYPE ";
+    text += name;
+    text += " ";
+    text += type;
+    text += "\n";
+}
+
+/**
+ * Append a metric with an integer value.
+ *
+ * @param[in,out]   text    Metrics text
+ * @param[in]       name    Metric name
+ * @param[in]       type    Metric type
+ * @param[in]       help    Metric description
+ * @param[in]       value   Value
+ */
+static void appendValue(String& text, const char* name, const char* type, const char* help, uint32_t value)
+{
+    appendHeader(text, name, type, help);
+
+    text += name;
+    text += " ";
+    text += value;
+    text += "\n";
+}
+
+/**
+ * Append a gauge metric with a time in seconds.
+ *
+ * @param[in,out]   text    Metrics text
+ * @param[in]       name    Metric name
+ * @param[in]       help    Metric description
+ * @param[in]       time    Time in us
+ */
+static void appendSeconds(String& text, const char* name, const char* help, uint32_t time)
+{
+    char value[16];
+
+    formatValue(value, sizeof(value), time, true);
+    appendHeader(text, name, "gauge", help);
+
+    text += name;
+    text += " ";
+    text += value;
+    text += "\n";
+}
+
+/**
+ * Append a histogram metric. The buckets are cumulative.
+ *
+ * @param[in,out]   text        Metrics text
+ * @param[in]       name        Metric name
+ * @param[in]       help        Metric description
+ * @param[in]       histogram   Histogram
+ * @param[in]       bounds      Upper bounds of the buckets
+ * @param[in]       isTime      Are the values times in us, which are shown in seconds?
+ */
+static void appendHistogram(String& text, const char* name, const char* help, const Histogram& histogram, const uint32_t* bounds, bool isTime)
+{
+    char     value[16];
+    uint32_t count = 0U;
+    size_t   idx   = 0U;
+
+    appendHeader(text, name, "histogram", help);
+
+    for (idx = 0U; ARRAY_ELEMENT_COUNT(histogram.counts) > idx; ++idx)
+    {
+        count += histogram.counts[idx];
+
+        if (HISTOGRAM_BOUND_COUNT > idx)
+        {
+            formatValue(value, sizeof(value), bounds[idx], isTime);
+        }
+        else
+        {
+            (void)strlcpy(value, "+Inf", sizeof(value));
+        }
+
+        text += name;
+        text += "_bucket{le=\"";
+        text += value;
+        text += "\"} ";
+        text += count;
+        text += "\n";
+    }
+
+    formatValue(value, sizeof(value), histogram.sum, isTime);
+
+    text += name;
+    text += "_sum ";
+    text += value;
+    text += "\n";
+    text += name;
+    text += "_count ";
+    text += histogram.count;
+    text += "\n";
+}
+
+/**
+ * Format a value. A time in us is formatted in seconds.
+ *
+ * @param[out]  buffer  Buffer for the formatted value
+ * @param[in]   size    Buffer size in byte
+ * @param[in]   value   Value
+ * @param[in]   isTime  Is the value a time in us?
+ */
+static void formatValue(char* buffer, size_t size, uint32_t value, bool isTime)
+{
+    if (true == isTime)
+    {
+        (void)snprintf(buffer, size, "%" PRIu32 ".%06" PRIu32, value / 1000000U, value % 1000000U);
+    }
+    else
+    {
+        (void)snprintf(buffer, size, "%" PRIu32, value);
+    }
+}
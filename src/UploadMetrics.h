@@ -0,0 +1,125 @@
+/* MIT License
+ *
+ * Copyright (c) 2019 - 2025 Andreas Merkle <web@blue-andi.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @file   UploadMetrics.h
+ * @brief  Upload throughput metrics
+ * @author Andreas Merkle <web@blue-andi.de>
+ *
+ * @addtogroup UTILITIES
+ *
+ * @{
+ */
+
+#ifndef UPLOAD_METRICS_H
+#define UPLOAD_METRICS_H
+
+/******************************************************************************
+ * Compile Switches
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <Arduino.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * The upload metrics show, whether the network or the flash limits the
+ * upload throughput. The receiving side reports the received data and the
+ * time it waited for it, the writer task reports the flash erase and write
+ * times. All values are related to the last upload, except the ones which
+ * are marked as total.
+ *
+ * The counters are written by the receiving side and by the writer task
+ * only. Reading them concurrently may provide slightly inconsistent, but
+ * no invalid values.
+ */
+namespace UploadMetrics
+{
+    /**
+     * Begin the metrics of a new upload. The previous ones are reset.
+     */
+    void begin();
+
+    /**
+     * Report received upload data. It logs the upload progress, but not
+     * more often than once per progress period.
+     *
+     * @param[in] size      Received data size in byte
+     * @param[in] waitTime  Time in us, which was waited for the data.
+     */
+    void addReceived(size_t size, uint32_t waitTime);
+
+    /**
+     * Report the time the receiving side was blocked, because all write
+     * buffers were in use.
+     *
+     * @param[in] waitTime  Time in us
+     */
+    void addBufferWait(uint32_t waitTime);
+
+    /**
+     * Report a flushed flash sector. It is called by the writer task.
+     *
+     * @param[in] eraseTime Time in us to erase the sector, 0 if not erased.
+     * @param[in] writeTime Time in us to write the sector, 0 if unchanged.
+     * @param[in] size      Written size in byte
+     */
+    void addSector(uint32_t eraseTime, uint32_t writeTime, size_t size);
+
+    /**
+     * Finish the metrics of the current upload.
+     *
+     * @param[in] isSuccessful  Is the upload successful?
+     */
+    void end(bool isSuccessful);
+
+    /**
+     * Get the metrics in the Prometheus text format.
+     *
+     * @param[out] text Metrics
+     */
+    void getMetrics(String& text);
+
+} /* namespace UploadMetrics */
+
+#endif /* UPLOAD_METRICS_H */
+
+/** @} */
@@ -37,11 +37,18 @@
 #include <Preferences.h>
 #include <WiFi.h>
 #include <DNSServer.h>
+#include <ESPmDNS.h>
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
 #include <Settings.h>
 
+#include "BootTrace.h"
 #include "MyWebServer.h"
 #include "MiniTerminal.h"
+#include "OtaWriter.h"
+#include "UploadHandler.h"
 
 /******************************************************************************
  * Macros
@@ -76,7 +83,16 @@ typedef enum
 
 static void appendDeviceUniqueId(String& deviceUniqueId);
 static void getChipId(String& chipId);
+static void onWiFiEvent(arduino_event_id_t event);
+static void onSerialReceive();
+#if !ARDUINO_USB_CDC_ON_BOOT
+static void setSerialBaudRate(uint32_t baudRate);
+#endif /* !ARDUINO_USB_CDC_ON_BOOT */
+static void waitForEvents(TickType_t ticks);
+static bool parseBSSID(const char* str, uint8_t* bssid);
+static void saveConnectionCache(bool isStaticIp);
 static void stateMachine();
+static const char* getStateName(State state);
 static void stateInit();
 static void stateStaSetup();
 static void stateStaConnecting();
@@ -92,9 +108,43 @@ static void stateError();
 /** Serial interface baudrate. */
 static const uint32_t SERIAL_BAUDRATE  = 115200U;
 
-/** Task period in ms of the loop() task. */
+/** mDNS service name, which is used by the host tools to discover updaters. */
+static const char MDNS_SERVICE[]       = "pixelix-updater";
+
+/** mDNS service protocol. */
+static const char MDNS_PROTOCOL[]      = "tcp";
+
+/** mDNS service port, which is the web server port. */
+static const uint16_t MDNS_PORT        = 80U;
+
+/**
+ * Serial receive buffer size in byte. It holds the frames of the binary
+ * upload, which are sent without waiting for an acknowledge.
+ */
+static const size_t SERIAL_RX_BUFFER_SIZE = 4096U;
+
+/**
+ * Max. time in ms the loop() task sleeps, if idle. It is woken up earlier
+ * by wifi events and received serial data.
+ */
 static const uint32_t LOOP_TASK_PERIOD = 10U;
 
+/**
+ * Duration in ms after the last web client activity, in which the loop() task
+ * sleeps only one tick. This keeps the latency of back-to-back requests low,
+ * e.g. during a chunked upload.
+ */
+static const uint32_t ACTIVE_PERIOD_MS = 1000U;
+
+/** Loop event: the wifi state changed. */
+static const EventBits_t LOOP_EVENT_WIFI   = (1U << 0U);
+
+/** Loop event: serial data received. */
+static const EventBits_t LOOP_EVENT_SERIAL = (1U << 1U);
+
+/** All loop events. */
+static const EventBits_t LOOP_EVENT_ALL    = LOOP_EVENT_WIFI | LOOP_EVENT_SERIAL;
+
 #if ARDUINO_USB_MODE
 #if ARDUINO_USB_CDC_ON_BOOT /* Serial used for USB CDC */
 
@@ -123,6 +173,53 @@ static const char OTA_PASSWORD[] = "maytheforcebewithyou";
  */
 static State gState              = STATE_INIT;
 
+/**
+ * State, which was recorded in the boot trace last.
+ */
+static State gTracedState        = STATE_INIT;
+
+/** Timeout in ms for connecting to the wifi network. */
+static const uint32_t CONNECT_TIMEOUT_MS      = 10000U;
+
+/**
+ * Timeout in ms for connecting directly to the cached access point (BSSID and channel).
+ * It is short, because without a scan the connection is established fast or not at all.
+ */
+static const uint32_t FAST_CONNECT_TIMEOUT_MS = 3000U;
+
+/** Length of a BSSID in bytes. */
+static const size_t   BSSID_LEN               = 6U;
+
+/**
+ * Is the station connected and has an ip-address?
+ * It is updated by the wifi event handler, which runs in the wifi task context.
+ */
+static volatile bool gIsStaConnected = false;
+
+/** Was the connection to the wifi network started in the connecting state? */
+static bool gIsConnectStarted        = false;
+
+/** Timestamp in ms, when the connection to the wifi network was started. */
+static uint32_t gConnectStartTime    = 0U;
+
+/** Events, which wake up the loop() task. */
+static EventGroupHandle_t gLoopEvents = nullptr;
+
+/** Timestamp in ms of the last web client activity. */
+static uint32_t gLastClientTime      = 0U;
+
+/** Timeout in ms of the current connection attempt. */
+static uint32_t gConnectTimeout      = CONNECT_TIMEOUT_MS;
+
+/** Is the current connection attempt directed to the cached access point? */
+static bool gIsFastConnect           = false;
+
+/** Did the directed connection attempt fail? If yes, a full scan is used. */
+static bool gIsFastConnectFailed     = false;
+
+/** Is the current connection attempt using the cached ip-address lease? */
+static bool gIsStaticIp              = false;
+
 /**
  * Set access point local address.
  *
@@ -168,7 +265,10 @@ void setup()
     Settings& settings = Settings::getInstance();
     String    hostname;
 
+    BootTrace::mark("Setup");
+
     /* Setup serial interface */
+    (void)Serial.setRxBufferSize(SERIAL_RX_BUFFER_SIZE);
     Serial.begin(SERIAL_BAUDRATE);
 
 #if ARDUINO_USB_MODE
@@ -183,6 +283,8 @@ void setup()
      */
     Serial.println("\n");
 
+    BootTrace::mark("Serial initialized");
+
     /* Set severity for esp logging system. */
     esp_log_level_set("*", CONFIG_ESP_LOG_SEVERITY);
 
@@ -198,6 +300,8 @@ void setup()
         settings.close();
     }
 
+    BootTrace::mark("Settings loaded");
+
     appendDeviceUniqueId(hostname);
 
     ESP_LOGI(LOG_TAG, "Target: %s", PIO_ENV);
@@ -205,10 +309,58 @@ void setup()
     ESP_LOGI(LOG_TAG, "Hostname: %s", hostname.c_str());
     ESP_LOGI(LOG_TAG, "Partition: Factory");
 
+    /* The loop() task sleeps until an event happens. */
+    gLoopEvents = xEventGroupCreate();
+
+    if (nullptr == gLoopEvents)
+    {
+        ESP_LOGW(LOG_TAG, "Failed to create loop events, fall back to polling.");
+    }
+
+#if !ARDUINO_USB_CDC_ON_BOOT
+    /* Wake up the loop() task on received serial data. */
+    Serial.onReceive(onSerialReceive);
+
+    /* The binary upload via terminal switches to a higher baudrate. */
+    gMiniTerminal.setBaudRateHandler(setSerialBaudRate, SERIAL_BAUDRATE);
+#endif /* !ARDUINO_USB_CDC_ON_BOOT */
+
+    /* Track the station connection, before wifi is started. */
+    (void)WiFi.onEvent(onWiFiEvent);
+
     /* Start wifi */
     (void)WiFi.mode(WIFI_STA);
 
+    BootTrace::mark("WiFi started");
+
+    /* Advertise the updater with its hostname, so the host tools find it without its ip-address. */
+    if (false == MDNS.begin(hostname.c_str()))
+    {
+        ESP_LOGW(LOG_TAG, "Failed to start mDNS.");
+    }
+    else
+    {
+        (void)MDNS.addService(MDNS_SERVICE, MDNS_PROTOCOL, MDNS_PORT);
+        (void)MDNS.addServiceTxt(MDNS_SERVICE, MDNS_PROTOCOL, "target", PIO_ENV);
+        (void)MDNS.addServiceTxt(MDNS_SERVICE, MDNS_PROTOCOL, "version", VERSION);
+    }
+
+    /* Start the flash writer task, before any upload can be received. */
+    if (false == OtaWriter::init())
+    {
+        ESP_LOGE(LOG_TAG, "Failed to initialize OTA writer.");
+    }
+
+    if (false == UploadHandler::init())
+    {
+        ESP_LOGE(LOG_TAG, "Failed to initialize upload handler.");
+    }
+
+    BootTrace::mark("Upload initialized");
+
     MyWebServer::begin();
+
+    BootTrace::mark("Web server started");
 }
 
 /**
@@ -216,10 +368,28 @@ void setup()
  */
 void loop()
 {
+    TickType_t waitTicks = pdMS_TO_TICKS(LOOP_TASK_PERIOD);
+
     stateMachine();
-    MyWebServer::handleClient();
+
+    if (true == MyWebServer::handleClient())
+    {
+        gLastClientTime = millis();
+    }
+
+    /* Drop a chunked upload session, which the client abandoned. */
+    UploadHandler::lock();
+    UploadHandler::process();
+    UploadHandler::unlock();
+
     gMiniTerminal.process();
 
+    /* Frames of a binary upload arrive back-to-back too. */
+    if (true == gMiniTerminal.isUploading())
+    {
+        gLastClientTime = millis();
+    }
+
     if (true == gMiniTerminal.isRestartRequested())
     {
         /* Give some time to send the response before restarting. */
@@ -240,8 +410,15 @@ void loop()
         ESP.restart();
     }
 
-    /* Schedule other tasks with same or lower priority. */
-    delay(LOOP_TASK_PERIOD);
+    /* A web client may send further data or requests soon, therefore don't sleep long.
+     * One tick sleep is kept, to schedule other tasks with same or lower priority.
+     */
+    if (ACTIVE_PERIOD_MS > (millis() - gLastClientTime))
+    {
+        waitTicks = 1U;
+    }
+
+    waitForEvents(waitTicks);
 }
 
 /******************************************************************************
@@ -283,6 +460,140 @@ static void getChipId(String& chipId)
     chipId = buffer;
 }
 
+/**
+ * Handle wifi events to track the station connection.
+ * It is called in the wifi task context.
+ *
+ * @param[in] event Wifi event
+ */
+static void onWiFiEvent(arduino_event_id_t event)
+{
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        gIsStaConnected = true;
+        break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        gIsStaConnected = false;
+        break;
+
+    default:
+        break;
+    }
+
+    if (nullptr != gLoopEvents)
+    {
+        (void)xEventGroupSetBits(gLoopEvents, LOOP_EVENT_WIFI);
+    }
+}
+
+/**
+ * Handle received serial data.
+ * It is called in the serial event task context.
+ */
+static void onSerialReceive()
+{
+    if (nullptr != gLoopEvents)
+    {
+        (void)xEventGroupSetBits(gLoopEvents, LOOP_EVENT_SERIAL);
+    }
+}
+
+#if !ARDUINO_USB_CDC_ON_BOOT
+
+/**
+ * Change the baudrate of the serial interface.
+ *
+ * @param[in] baudRate  Baudrate
+ */
+static void setSerialBaudRate(uint32_t baudRate)
+{
+    Serial.updateBaudRate(baudRate);
+}
+
+#endif /* !ARDUINO_USB_CDC_ON_BOOT */
+
+/**
+ * Sleep until a loop event happens or the timeout elapses.
+ *
+ * @param[in] ticks Max. sleep time in ticks
+ */
+static void waitForEvents(TickType_t ticks)
+{
+    if (nullptr == gLoopEvents)
+    {
+        vTaskDelay(ticks);
+    }
+    else
+    {
+        /* Which event woke up, doesn't matter, because all jobs are processed in every loop. */
+        (void)xEventGroupWaitBits(gLoopEvents, LOOP_EVENT_ALL, pdTRUE, pdFALSE, ticks);
+    }
+}
+
+/**
+ * Parse a BSSID string in the format "AA:BB:CC:DD:EE:FF".
+ *
+ * @param[in]   str     BSSID string
+ * @param[out]  bssid   BSSID with BSSID_LEN bytes
+ *
+ * @return If successful parsed, it will return true otherwise false.
+ */
+static bool parseBSSID(const char* str, uint8_t* bssid)
+{
+    bool         isSuccessful = false;
+    unsigned int value[BSSID_LEN];
+
+    if (static_cast<int>(BSSID_LEN) == sscanf(str, "%2x:%2x:%2x:%2x:%2x:%2x", &value[0], &value[1], &value[2], &value[3], &value[4], &value[5]))
+    {
+        size_t idx = 0U;
+
+        for (idx = 0U; idx < BSSID_LEN; ++idx)
+        {
+            bssid[idx] = static_cast<uint8_t>(value[idx]);
+        }
+
+        isSuccessful = true;
+    }
+
+    return isSuccessful;
+}
+
+/**
+ * Store the access point and the ip-address lease of the current connection,
+ * which are used for a fast connect next time. To limit the flash wear, the
+ * settings write only changed values.
+ *
+ * @param[in] isStaticIp    Is the cached ip-address lease in use?
+ */
+static void saveConnectionCache(bool isStaticIp)
+{
+    Settings& settings = Settings::getInstance();
+
+    if (false == settings.open(false))
+    {
+        ESP_LOGW(LOG_TAG, "Failed to store WiFi connection cache.");
+    }
+    else
+    {
+        settings.getWifiBSSID().setValue(WiFi.BSSIDstr());
+        settings.getWifiChannel().setValue(static_cast<uint8_t>(WiFi.channel()));
+
+        /* A lease is only stored if it was received via DHCP. */
+        if ((false == isStaticIp) && (true == settings.getWifiReuseIp().getValue()))
+        {
+            settings.getWifiIp().setValue(WiFi.localIP());
+            settings.getWifiGateway().setValue(WiFi.gatewayIP());
+            settings.getWifiSubnet().setValue(WiFi.subnetMask());
+            settings.getWifiDns().setValue(WiFi.dnsIP());
+        }
+
+        settings.close();
+    }
+}
+
 /**
  * State machine function to handle the current state of the application.
  * This function is called periodically in the loop() function.
@@ -323,6 +634,60 @@ static void stateMachine()
         ESP_LOGE(LOG_TAG, "Unknown state: %d", gState);
         break;
     }
+
+    if (gTracedState != gState)
+    {
+        BootTrace::mark(getStateName(gState));
+        gTracedState = gState;
+    }
+}
+
+/**
+ * Get the name of a state for the boot trace.
+ *
+ * @param[in] state State
+ *
+ * @return State name
+ */
+static const char* getStateName(State state)
+{
+    const char* name = "Unknown state";
+
+    switch (state)
+    {
+    case STATE_INIT:
+        name = "State: init";
+        break;
+
+    case STATE_STA_SETUP:
+        name = "State: station setup";
+        break;
+
+    case STATE_STA_CONNECTING:
+        name = "State: station connecting";
+        break;
+
+    case STATE_STA_CONNECTED:
+        name = "State: station connected";
+        break;
+
+    case STATE_AP_SETUP:
+        name = "State: access point setup";
+        break;
+
+    case STATE_AP_UP:
+        name = "State: access point up";
+        break;
+
+    case STATE_ERROR:
+        name = "State: error";
+        break;
+
+    default:
+        break;
+    }
+
+    return name;
 }
 
 /**
@@ -331,22 +696,22 @@ static void stateMachine()
  */
 static void stateInit()
 {
-    Settings& settings = Settings::getInstance();
-    String    wifiSSID;
+    Settings&   settings = Settings::getInstance();
+    const char* wifiSSID = nullptr;
 
     /* Load settings. */
     if (false == settings.open(true))
     {
-        wifiSSID = settings.getWifiSSID().getDefault();
+        wifiSSID = settings.getWifiSSID().getDefault().c_str();
     }
     else
     {
-        wifiSSID = settings.getWifiSSID().getValue();
+        wifiSSID = settings.getWifiSSID().getValue().c_str();
 
         settings.close();
     }
 
-    if (true == wifiSSID.isEmpty())
+    if ('\0' == wifiSSID[0])
     {
         ESP_LOGI(LOG_TAG, "No WiFi SSID configured, starting in Access Point mode.");
         gState = STATE_AP_SETUP;
@@ -379,56 +744,119 @@ static void stateStaSetup()
 
 /**
  * State machine function for the connecting state.
- * This state is entered when the wifi station was setup successfully.
+ * This state is entered when the wifi station was setup successfully or
+ * the connection was lost. It doesn't block, the connection result is
+ * reported by the wifi events.
  */
 static void stateStaConnecting()
 {
-    if (WL_CONNECTED != WiFi.status())
+    if (false == gIsConnectStarted)
     {
-        Settings&      settings                    = Settings::getInstance();
-        const uint32_t CONNECT_TIMEOUT_MS          = 10000U;
-        const uint32_t CHECK_CONNECTION_TIMEOUT_MS = 100U;
-        uint32_t       startTime                   = millis();
-        String         wifiSSID;
-        String         wifiPassphrase;
-
-        /* Load settings. */
+        Settings&   settings       = Settings::getInstance();
+        const char* wifiSSID       = nullptr;
+        const char* wifiPassphrase = nullptr;
+        const char* wifiBSSID      = "";
+        uint8_t     wifiChannel    = 0U;
+        bool        reuseIp        = false;
+        uint32_t    ip             = 0U;
+        uint32_t    gateway        = 0U;
+        uint32_t    subnet         = 0U;
+        uint32_t    dns            = 0U;
+        uint8_t     bssid[BSSID_LEN];
+
+        /* Load settings. The values refer to the settings cache, no copy is made. */
         if (false == settings.open(true))
         {
-            wifiSSID       = settings.getWifiSSID().getDefault();
-            wifiPassphrase = settings.getWifiPassphrase().getDefault();
+            wifiSSID       = settings.getWifiSSID().getDefault().c_str();
+            wifiPassphrase = settings.getWifiPassphrase().getDefault().c_str();
         }
         else
         {
-            wifiSSID       = settings.getWifiSSID().getValue();
-            wifiPassphrase = settings.getWifiPassphrase().getValue();
+            wifiSSID       = settings.getWifiSSID().getValue().c_str();
+            wifiPassphrase = settings.getWifiPassphrase().getValue().c_str();
+            wifiBSSID      = settings.getWifiBSSID().getValue().c_str();
+            wifiChannel    = settings.getWifiChannel().getValue();
+            reuseIp        = settings.getWifiReuseIp().getValue();
+            ip             = settings.getWifiIp().getValue();
+            gateway        = settings.getWifiGateway().getValue();
+            subnet         = settings.getWifiSubnet().getValue();
+            dns            = settings.getWifiDns().getValue();
 
             settings.close();
         }
 
-        /* Try to connect to the wifi network. */
-        (void)WiFi.begin(wifiSSID.c_str(), wifiPassphrase.c_str());
+        gIsStaConnected = false;
+        gIsFastConnect  = false;
+        gIsStaticIp     = false;
 
-        ESP_LOGI(LOG_TAG, "Connecting to WiFi '%s'...", wifiSSID.c_str());
+        /* Connect directly to the last access point, which avoids the scan. */
+        if ((false == gIsFastConnectFailed) &&
+            (0U != wifiChannel) &&
+            (true == parseBSSID(wifiBSSID, bssid)))
+        {
+            /* The cached lease avoids the DHCP handshake. It is only used on demand,
+             * because the ip-address could be assigned to another device meanwhile.
+             */
+            if ((true == reuseIp) && (0U != ip))
+            {
+                gIsStaticIp = WiFi.config(IPAddress(ip), IPAddress(gateway), IPAddress(subnet), IPAddress(dns));
+            }
 
-        /* Wait until connected. */
-        while ((WL_CONNECTED != WiFi.status()) && ((millis() - startTime) < CONNECT_TIMEOUT_MS))
+            (void)WiFi.begin(wifiSSID, wifiPassphrase, wifiChannel, bssid);
+
+            ESP_LOGI(LOG_TAG, "Connecting to WiFi '%s' (%s, channel %u)...", wifiSSID, wifiBSSID, wifiChannel);
+
+            gIsFastConnect  = true;
+            gConnectTimeout = FAST_CONNECT_TIMEOUT_MS;
+        }
+        else
         {
-            delay(CHECK_CONNECTION_TIMEOUT_MS);
+            /* Use DHCP. */
+            (void)WiFi.config(IPAddress(), IPAddress(), IPAddress());
+            (void)WiFi.begin(wifiSSID, wifiPassphrase);
+
+            ESP_LOGI(LOG_TAG, "Connecting to WiFi '%s'...", wifiSSID);
+
+            gConnectTimeout = CONNECT_TIMEOUT_MS;
         }
 
-        if (WL_CONNECTED != WiFi.status())
+        gConnectStartTime = millis();
+        gIsConnectStarted = true;
+    }
+    else if (true == gIsStaConnected)
+    {
+        ESP_LOGI(LOG_TAG, "Connected to WiFi '%s'", WiFi.SSID().c_str());
+        ESP_LOGI(LOG_TAG, "IP address: %s", WiFi.localIP().toString().c_str());
+
+        saveConnectionCache(gIsStaticIp);
+
+        gIsFastConnectFailed = false;
+        gIsConnectStarted    = false;
+        gState               = STATE_STA_CONNECTED;
+    }
+    else if (gConnectTimeout <= (millis() - gConnectStartTime))
+    {
+        gIsConnectStarted = false;
+
+        if (true == gIsFastConnect)
         {
-            ESP_LOGE(LOG_TAG, "Failed to connect to WiFi '%s'", wifiSSID.c_str());
-            ESP_LOGI(LOG_TAG, "Setup WiFi Access Point mode.");
-            gState = STATE_AP_SETUP;
+            ESP_LOGW(LOG_TAG, "Failed to connect to cached access point, retry with scan.");
+
+            (void)WiFi.disconnect();
+            gIsFastConnectFailed = true;
         }
         else
         {
-            ESP_LOGI(LOG_TAG, "Connected to WiFi '%s'", wifiSSID.c_str());
-            ESP_LOGI(LOG_TAG, "IP address: %s", WiFi.localIP().toString().c_str());
+            ESP_LOGE(LOG_TAG, "Failed to connect to WiFi.");
+            ESP_LOGI(LOG_TAG, "Setup WiFi Access Point mode.");
+
+            gState = STATE_AP_SETUP;
         }
     }
+    else
+    {
+        /* Wait for connection. */
+    }
 }
 
 /**
@@ -437,7 +865,7 @@ static void stateStaConnecting()
  */
 static void stateStaConnected()
 {
-    if (WL_CONNECTED != WiFi.status())
+    if (false == gIsStaConnected)
     {
         ESP_LOGE(LOG_TAG, "WiFi connection lost, switching to connecting state.");
         gState = STATE_STA_CONNECTING;
@@ -451,23 +879,23 @@ static void stateStaConnected()
  */
 static void stateApSetup()
 {
-    Settings& settings = Settings::getInstance();
-    String    hostname;
-    String    wifiApSSID;
-    String    wifiApPassphrase;
+    Settings&   settings         = Settings::getInstance();
+    String      hostname;
+    const char* wifiApSSID       = nullptr;
+    const char* wifiApPassphrase = nullptr;
 
-    /* Load settings. */
+    /* Load settings. The hostname is copied, because the unique id is appended. */
     if (false == settings.open(true))
     {
         hostname         = settings.getHostname().getDefault();
-        wifiApSSID       = settings.getWifiApSSID().getDefault();
-        wifiApPassphrase = settings.getWifiApPassphrase().getDefault();
+        wifiApSSID       = settings.getWifiApSSID().getDefault().c_str();
+        wifiApPassphrase = settings.getWifiApPassphrase().getDefault().c_str();
     }
     else
     {
         hostname         = settings.getHostname().getValue();
-        wifiApSSID       = settings.getWifiApSSID().getValue();
-        wifiApPassphrase = settings.getWifiApPassphrase().getValue();
+        wifiApSSID       = settings.getWifiApSSID().getValue().c_str();
+        wifiApPassphrase = settings.getWifiApPassphrase().getValue().c_str();
 
         settings.close();
     }
@@ -491,7 +919,7 @@ static void stateApSetup()
         gState = STATE_ERROR;
     }
     /* Setup wifi access point. */
-    else if (false == WiFi.softAP(wifiApSSID.c_str(), wifiApPassphrase.c_str()))
+    else if (false == WiFi.softAP(wifiApSSID, wifiApPassphrase))
     {
         ESP_LOGE(LOG_TAG, "Failed to setup Access Point.");
         gState = STATE_ERROR;